@@ -0,0 +1,170 @@
+#include "nonius.hpp"
+
+#include <cobalt/actor.hpp>
+#include <cobalt/prefab.hpp>
+
+using namespace cobalt;
+
+namespace bench {
+
+class node_component : public transform_component {
+	IMPLEMENT_OBJECT_TYPE(node_component)
+};
+
+class audio_component : public actor_component {
+	IMPLEMENT_OBJECT_TYPE(audio_component)
+};
+
+// Small hierarchy typical for characters, 1 + 4 + 4 * 3 nodes
+ref_ptr<actor> create_actor() {
+	auto a = make_ref<actor>();
+	auto root = new node_component();
+	for (int i = 0; i < 4; ++i) {
+		auto limb = new node_component();
+		for (int j = 0; j < 3; ++j)
+			limb->add_child(new node_component());
+		root->add_child(limb);
+	}
+	a->transform(root);
+	a->add_component(new audio_component());
+	return a;
+}
+
+struct motion {
+	vec3 velocity;
+	float drag;
+};
+
+} // namespace bench
+
+NONIUS_BENCHMARK("transform_component::traverse depth first", [](nonius::chronometer meter) {
+	auto a = bench::create_actor();
+	meter.measure([&] {
+		int count = 0;
+		a->transform()->traverse(traverse_order::depth_first, [&](transform_component*) { ++count; return true; });
+		return count;
+	});
+});
+
+NONIUS_BENCHMARK("transform_component::traverse breadth first", [](nonius::chronometer meter) {
+	auto a = bench::create_actor();
+	meter.measure([&] {
+		int count = 0;
+		a->transform()->traverse(traverse_order::breadth_first, [&](transform_component*) { ++count; return true; });
+		return count;
+	});
+});
+
+NONIUS_BENCHMARK("transform_component::visit", [](nonius::chronometer meter) {
+	auto a = bench::create_actor();
+	meter.measure([&] {
+		int depth = 0, max_depth = 0;
+		a->transform()->visit([&](transform_component*) { max_depth = std::max(max_depth, ++depth); return true; }, [&](transform_component*) { --depth; });
+		return max_depth;
+	});
+});
+
+NONIUS_BENCHMARK("actor::find_component", [](nonius::chronometer meter) {
+	auto a = bench::create_actor();
+	meter.measure([&] {
+		return a->find_component<bench::audio_component>();
+	});
+});
+
+NONIUS_BENCHMARK("level::update_transforms 1000 actors", [](nonius::chronometer meter) {
+	level l;
+	std::vector<ref_ptr<actor>> actors;
+	for (int i = 0; i < 1000; ++i) {
+		actors.push_back(bench::create_actor());
+		l.add_actor(actors.back().get());
+	}
+	l.update_transforms();
+	meter.measure([&](int i) {
+		// Every actor moves every frame
+		for (auto&& a : actors)
+			a->transform()->position({float(i), 0, 0});
+		l.update_transforms();
+	});
+	l.clear_actors();
+});
+
+NONIUS_BENCHMARK("object::create_instance actor", [](nonius::chronometer meter) {
+	object::freeze_types();
+	meter.measure([&] {
+		ref_ptr<actor> a = object::create_instance<actor>();
+		a->add_component(object::create_instance<bench::audio_component>());
+		return a->use_count();
+	});
+});
+
+NONIUS_BENCHMARK("object::create_instance actor, pooled", [](nonius::chronometer meter) {
+	object::freeze_types();
+	object_pool<actor>::capacity(64);
+	object_pool<bench::audio_component>::capacity(64);
+	meter.measure([&] {
+		ref_ptr<actor> a = object::create_instance<actor>();
+		a->add_component(object::create_instance<bench::audio_component>());
+		return a->use_count();
+	});
+	object_pool<actor>::capacity(0);
+	object_pool<bench::audio_component>::capacity(0);
+});
+
+NONIUS_BENCHMARK("spawn 1000 actors by factory", [](nonius::chronometer meter) {
+	object::freeze_types();
+	meter.measure([&] {
+		level l;
+		for (int i = 0; i < 1000; ++i) {
+			ref_ptr<actor> a = object::create_instance<actor>();
+			auto root = object::create_instance<bench::node_component>();
+			a->transform(root);
+			for (int j = 0; j < 4; ++j) {
+				auto limb = object::create_instance<bench::node_component>();
+				root->add_child(limb);
+				for (int k = 0; k < 3; ++k)
+					limb->add_child(object::create_instance<bench::node_component>());
+			}
+			a->add_component(object::create_instance<bench::audio_component>());
+			a->add_data<bench::motion>(bench::motion{ { 1, 0, 0 }, 0.5f });
+			l.add_actor(a.get());
+		}
+		return l.view<bench::motion>().size();
+	});
+});
+
+NONIUS_BENCHMARK("prefab::instantiate 1000 actors", [](nonius::chronometer meter) {
+	object::freeze_types();
+	auto source = bench::create_actor();
+	source->add_data<bench::motion>(bench::motion{ { 1, 0, 0 }, 0.5f });
+	prefab p(*source);
+	std::vector<actor*> actors;
+	meter.measure([&] {
+		level l;
+		actors.clear();
+		p.instantiate(l, 1000, actors);
+		return l.view<bench::motion>().size();
+	});
+});
+
+NONIUS_BENCHMARK("prefab::instantiate 1000 actors, pooled", [](nonius::chronometer meter) {
+	object::freeze_types();
+	object_pool<actor>::capacity(1000);
+	object_pool<bench::node_component>::capacity(17000);
+	object_pool<bench::audio_component>::capacity(1000);
+	auto source = bench::create_actor();
+	source->add_data<bench::motion>(bench::motion{ { 1, 0, 0 }, 0.5f });
+	prefab p(*source);
+	std::vector<actor*> actors;
+	meter.measure([&] {
+		level l;
+		actors.clear();
+		p.instantiate(l, 1000, actors);
+		return l.view<bench::motion>().size();
+	});
+	object_pool<actor>::capacity(0);
+	object_pool<bench::node_component>::capacity(0);
+	object_pool<bench::audio_component>::capacity(0);
+	object_pool<actor>::clear();
+	object_pool<bench::node_component>::clear();
+	object_pool<bench::audio_component>::clear();
+});
@@ -0,0 +1,154 @@
+#include "nonius.hpp"
+
+#include <cobalt/com.hpp>
+
+using namespace cobalt;
+
+namespace bench {
+
+#define DECLARE_BENCH_INTERFACE(n) \
+	DECLARE_INTERFACE(bench, interface##n) \
+	struct interface##n : com::any { virtual int value##n() noexcept = 0; }; \
+	struct interface##n##_impl : interface##n { virtual int value##n() noexcept override { return n; } };
+
+DECLARE_BENCH_INTERFACE(0)
+DECLARE_BENCH_INTERFACE(1)
+DECLARE_BENCH_INTERFACE(2)
+DECLARE_BENCH_INTERFACE(3)
+DECLARE_BENCH_INTERFACE(4)
+DECLARE_BENCH_INTERFACE(5)
+DECLARE_BENCH_INTERFACE(6)
+DECLARE_BENCH_INTERFACE(7)
+DECLARE_BENCH_INTERFACE(8)
+DECLARE_BENCH_INTERFACE(9)
+DECLARE_BENCH_INTERFACE(10)
+DECLARE_BENCH_INTERFACE(11)
+DECLARE_BENCH_INTERFACE(12)
+DECLARE_BENCH_INTERFACE(13)
+DECLARE_BENCH_INTERFACE(14)
+DECLARE_BENCH_INTERFACE(15)
+DECLARE_BENCH_INTERFACE(16)
+DECLARE_BENCH_INTERFACE(17)
+DECLARE_BENCH_INTERFACE(18)
+DECLARE_BENCH_INTERFACE(19)
+DECLARE_BENCH_INTERFACE(20)
+
+// Base class with the rest of interfaces, reachable through chain entry
+class big_object_base
+	: public com::object_base
+	, public interface10_impl, public interface11_impl, public interface12_impl, public interface13_impl, public interface14_impl
+	, public interface15_impl, public interface16_impl, public interface17_impl, public interface18_impl, public interface19_impl
+{
+public:
+	BEGIN_CAST_MAP(big_object_base)
+		CAST_ENTRY(interface10)
+		CAST_ENTRY(interface11)
+		CAST_ENTRY(interface12)
+		CAST_ENTRY(interface13)
+		CAST_ENTRY(interface14)
+		CAST_ENTRY(interface15)
+		CAST_ENTRY(interface16)
+		CAST_ENTRY(interface17)
+		CAST_ENTRY(interface18)
+		CAST_ENTRY(interface19)
+	END_CAST_MAP()
+};
+
+DECLARE_CLASS(bench, big_object)
+class big_object
+	: public big_object_base
+	, public interface0_impl, public interface1_impl, public interface2_impl, public interface3_impl, public interface4_impl
+	, public interface5_impl, public interface6_impl, public interface7_impl, public interface8_impl, public interface9_impl
+	, public com::coclass<big_object, UIDOF(big_object)>
+{
+public:
+	BEGIN_CAST_MAP(big_object)
+		CAST_ENTRY(interface0)
+		CAST_ENTRY(interface1)
+		CAST_ENTRY(interface2)
+		CAST_ENTRY(interface3)
+		CAST_ENTRY(interface4)
+		CAST_ENTRY(interface5)
+		CAST_ENTRY(interface6)
+		CAST_ENTRY(interface7)
+		CAST_ENTRY(interface8)
+		CAST_ENTRY(interface9)
+		CAST_ENTRY_CHAIN(big_object_base)
+	END_CAST_MAP()
+	
+	DECLARE_GET_OUTER_OBJECT()
+};
+
+// Small object with tear-off interface, allocated with given policy
+template <typename Allocation>
+class small_tear_off
+	: public com::tear_off_object_base<small_tear_off<Allocation>>
+	, public interface1_impl
+{
+public:
+	BEGIN_CAST_MAP(small_tear_off)
+		CAST_ENTRY(interface1)
+	END_CAST_MAP()
+	
+	DECLARE_GET_OUTER_OBJECT()
+	DECLARE_ALLOCATION(Allocation)
+};
+
+template <typename Allocation>
+class small_object
+	: public com::object_base
+	, public interface0_impl
+	, public com::coclass<small_object<Allocation>>
+{
+public:
+	BEGIN_CAST_MAP(small_object)
+		CAST_ENTRY(interface0)
+		CAST_ENTRY_TEAR_OFF(UIDOF(interface1), small_tear_off<Allocation>)
+	END_CAST_MAP()
+	
+	DECLARE_GET_OUTER_OBJECT()
+	DECLARE_ALLOCATION(Allocation)
+};
+
+} // namespace bench
+
+template <typename Q>
+static void measure_cast(nonius::chronometer meter) {
+	std::error_code ec;
+	auto object = bench::big_object::create_instance<com::any>(ec);
+	
+	meter.measure([&] {
+		int sum = 0;
+		for (int k = 0; k < 10; ++k)
+			sum += !!com::cast<Q>(object, ec);
+		return sum;
+	});
+}
+
+NONIUS_BENCHMARK("com::cast first interface", measure_cast<bench::interface0>)
+NONIUS_BENCHMARK("com::cast last interface", measure_cast<bench::interface9>)
+NONIUS_BENCHMARK("com::cast chained interface", measure_cast<bench::interface19>)
+NONIUS_BENCHMARK("com::cast missing interface", measure_cast<bench::interface20>)
+
+template <typename Allocation>
+static void measure_lifetime(nonius::chronometer meter) {
+	meter.measure([&] {
+		std::error_code ec;
+		int sum = 0;
+		for (int k = 0; k < 10; ++k) {
+			auto object = bench::small_object<Allocation>::template create_instance<bench::interface0>(ec);
+			if (auto tear_off = com::cast<bench::interface1>(object, ec))
+				sum += tear_off->value1();
+		}
+		return sum;
+	});
+}
+
+static void measure_arena_lifetime(nonius::chronometer meter) {
+	com::object_arena arena;
+	measure_lifetime<com::arena_allocation<>>(meter);
+}
+
+NONIUS_BENCHMARK("com create/cast/release heap", measure_lifetime<com::heap_allocation>)
+NONIUS_BENCHMARK("com create/cast/release pool", measure_lifetime<com::pool_allocation>)
+NONIUS_BENCHMARK("com create/cast/release arena", measure_arena_lifetime)
@@ -0,0 +1,67 @@
+#include "nonius.hpp"
+
+#include <cobalt/encoding.hpp>
+
+using namespace cobalt;
+
+namespace bench {
+
+DECLARE_CLASS(bench, player)
+class player
+	: public com::object_base
+	, public com::encodable
+	, public com::coclass<player, UIDOF(player)>
+{
+public:
+	BEGIN_CAST_MAP(player)
+		CAST_ENTRY(com::encodable)
+	END_CAST_MAP()
+	
+	DECLARE_GET_OUTER_OBJECT()
+	
+	virtual void encode(com::encoder* encoder, std::error_code& ec) const noexcept override {
+		auto self = const_cast<player*>(this);
+		encoder->encode("x", self->x, -1000.0f, 1000.0f, 0.01f);
+		encoder->encode("y", self->y, -1000.0f, 1000.0f, 0.01f);
+		encoder->encode("z", self->z, -1000.0f, 1000.0f, 0.01f);
+		encoder->encode("angle", self->angle, 0.0f, 360.0f, 0.1f);
+		encoder->encode("health", self->health, 0, 100);
+		encoder->encode("ammo", self->ammo, 0, 999);
+		encoder->encode("alive", self->alive);
+		ec.clear();
+	}
+	
+	float x = 1, y = 2, z = 3;
+	float angle = 45;
+	int health = 100;
+	int ammo = 50;
+	bool alive = true;
+};
+
+} // namespace bench
+
+template <bool Compiled>
+static void measure_encode(nonius::chronometer meter) {
+	std::error_code ec;
+	auto object = bench::player::create_instance<com::encodable>(ec);
+	auto&& player = static_cast<bench::player&>(*object);
+	
+	io::memory_stream stream(4096);
+	com::stack_object<io::bit_encoder> encoder;
+	
+	meter.measure([&] {
+		stream.seek(0, seek_origin::begin, ec);
+		io::bit_writer writer(stream);
+		encoder.begin(writer);
+		for (int k = 0; k < 100; ++k) {
+			if (Compiled)
+				encoder.encode(player, ec);
+			else
+				player.encode(&encoder, ec);
+		}
+		return encoder.snapshot().size();
+	});
+}
+
+NONIUS_BENCHMARK("bit_encoder keyed", measure_encode<false>)
+NONIUS_BENCHMARK("bit_encoder schema", measure_encode<true>)
@@ -0,0 +1,184 @@
+#include "nonius.hpp"
+
+#include <cobalt/fsm.hpp>
+
+using namespace cobalt;
+
+namespace bench {
+
+class agent {
+public:
+	virtual ~agent() = default;
+};
+
+struct event_next {};
+struct event_prev {};
+
+using dynamic_machine = fsm::state_machine<agent>;
+
+class idle : public dynamic_machine::state_type {
+public:
+	using dynamic_machine::state_type::state_type;
+	virtual void enter(state_base*) override { ++counter; }
+	virtual void leave(state_base*) override {}
+	int counter = 0;
+};
+
+class walk : public dynamic_machine::state_type {
+public:
+	using dynamic_machine::state_type::state_type;
+	virtual void enter(state_base*) override { ++counter; }
+	virtual void leave(state_base*) override {}
+	int counter = 0;
+};
+
+class attack : public dynamic_machine::state_type {
+public:
+	using dynamic_machine::state_type::state_type;
+	virtual void enter(state_base*) override { ++counter; }
+	virtual void leave(state_base*) override {}
+	int counter = 0;
+};
+
+struct static_idle : agent { void enter(agent*) { ++counter; } int counter = 0; };
+struct static_walk : agent { void enter(agent*) { ++counter; } int counter = 0; };
+struct static_attack : agent { void enter(agent*) { ++counter; } int counter = 0; };
+
+using static_machine = fsm::static_state_machine<agent,
+	fsm::states<static_idle, static_walk, static_attack>,
+	fsm::transitions<
+		fsm::row<static_idle, event_next, static_walk>,
+		fsm::row<static_walk, event_next, static_attack>,
+		fsm::row<static_attack, event_next, static_idle>,
+		fsm::row<static_walk, event_prev, static_idle>
+	>>;
+
+} // namespace bench
+
+NONIUS_BENCHMARK("fsm::state_machine::send", [](nonius::chronometer meter) {
+	using namespace bench;
+	dynamic_machine machine{
+		fsm::make_state<idle>({ fsm::make_transition<event_next, walk>() }),
+		fsm::make_state<walk>({ fsm::make_transition<event_next, attack>(), fsm::make_transition<event_prev, idle>() }),
+		fsm::make_state<attack>({ fsm::make_transition<event_next, idle>() })
+	};
+	machine.enter<idle>();
+	meter.measure([&] {
+		for (int k = 0; k < 10; ++k)
+			machine.send<event_next>();
+		return machine.send<event_prev>();
+	});
+})
+
+NONIUS_BENCHMARK("fsm::static_state_machine::send", [](nonius::chronometer meter) {
+	using namespace bench;
+	static_machine machine;
+	machine.enter<static_idle>();
+	meter.measure([&] {
+		for (int k = 0; k < 10; ++k)
+			machine.send<event_next>();
+		return machine.send<event_prev>();
+	});
+})
+
+namespace bench {
+
+struct nested_alive : agent {};
+struct nested_idle : agent { void enter(agent*) { ++counter; } int counter = 0; };
+struct nested_walk : agent { void enter(agent*) { ++counter; } int counter = 0; };
+struct nested_attack : agent { void enter(agent*) { ++counter; } int counter = 0; };
+
+// event_prev is handled by parent of all states
+using hierarchical_machine = fsm::hierarchical_state_machine<agent,
+	fsm::states<nested_alive, nested_idle, nested_walk, nested_attack>,
+	fsm::hierarchy<
+		fsm::substate<nested_idle, nested_alive>,
+		fsm::substate<nested_walk, nested_alive>,
+		fsm::substate<nested_attack, nested_alive>
+	>,
+	fsm::transitions<
+		fsm::row<nested_idle, event_next, nested_walk>,
+		fsm::row<nested_walk, event_next, nested_attack>,
+		fsm::row<nested_attack, event_next, nested_idle>,
+		fsm::row<nested_alive, event_prev, nested_alive>
+	>>;
+
+} // namespace bench
+
+NONIUS_BENCHMARK("fsm::hierarchical_state_machine::send", [](nonius::chronometer meter) {
+	using namespace bench;
+	hierarchical_machine machine;
+	machine.enter<nested_alive>();
+	meter.measure([&] {
+		for (int k = 0; k < 10; ++k)
+			machine.send<event_next>();
+		return machine.send<event_prev>();
+	});
+})
+
+namespace bench {
+
+struct batched_idle : agent {};
+struct batched_walk : agent {};
+struct batched_attack : agent {
+	void enter(fsm::instance_batch instances, agent*) { counter += instances.size(); }
+	size_t counter = 0;
+};
+
+using batched_machine = fsm::batched_state_machine<agent,
+	fsm::states<batched_idle, batched_walk, batched_attack>,
+	fsm::transitions<
+		fsm::row<batched_idle, event_next, batched_walk>,
+		fsm::row<batched_walk, event_next, batched_attack>,
+		fsm::row<batched_attack, event_next, batched_idle>,
+		fsm::row<batched_walk, event_prev, batched_idle>
+	>>;
+
+struct plain_idle : agent {};
+struct plain_walk : agent {};
+
+using plain_machine = fsm::batched_state_machine<agent,
+	fsm::states<plain_idle, plain_walk>,
+	fsm::transitions<
+		fsm::row<plain_idle, event_next, plain_walk>,
+		fsm::row<plain_walk, event_next, plain_idle>
+	>>;
+
+constexpr size_t agents = 10000;
+
+} // namespace bench
+
+NONIUS_BENCHMARK("fsm::static_state_machine::send 10000 agents", [](nonius::chronometer meter) {
+	using namespace bench;
+	std::vector<std::unique_ptr<static_machine>> machines;
+	for (size_t i = 0; i < agents; ++i) {
+		machines.push_back(std::make_unique<static_machine>());
+		machines.back()->enter<static_idle>();
+	}
+	meter.measure([&] {
+		size_t changed = 0;
+		for (auto&& machine : machines)
+			changed += machine->send<event_next>();
+		return changed;
+	});
+})
+
+NONIUS_BENCHMARK("fsm::batched_state_machine::send 10000 agents", [](nonius::chronometer meter) {
+	using namespace bench;
+	batched_machine machine;
+	machine.add(agents);
+	machine.enter<batched_idle>();
+	meter.measure([&] {
+		return machine.send<event_next>();
+	});
+})
+
+NONIUS_BENCHMARK("fsm::batched_state_machine::send 10000 agents, no hooks", [](nonius::chronometer meter) {
+	using namespace bench;
+	plain_machine machine;
+	machine.add(agents);
+	machine.enter<plain_idle>();
+	meter.measure([&] {
+		return machine.send<event_next>();
+	});
+})
@@ -0,0 +1,78 @@
+#include "nonius.hpp"
+
+#include <cobalt/spatial_index.hpp>
+
+#include <random>
+
+using namespace cobalt;
+
+namespace bench {
+
+// Objects of about 1 unit scattered over a square kilometer
+struct scene {
+	explicit scene(size_t count) {
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> pos(0, 1000), height(0, 20), ext(0.5f, 2);
+		for (size_t i = 0; i < count; ++i) {
+			vec3 min{ pos(rng), height(rng), pos(rng) };
+			boxes.push_back({ min, min + vec3(ext(rng), ext(rng), ext(rng)) });
+			proxies.push_back(tree.insert(boxes.back(), int(i)));
+		}
+	}
+	
+	// Neighborhood of 50 units around query point
+	aabb query_box(int i) const {
+		auto c = boxes[i % boxes.size()].center();
+		return { c - vec3(25, 25, 25), c + vec3(25, 25, 25) };
+	}
+	
+	aabb_tree<int> tree;
+	std::vector<aabb> boxes;
+	std::vector<aabb_tree<int>::proxy_id> proxies;
+	std::vector<int> result;
+};
+
+} // namespace bench
+
+#define SPATIAL_BENCHMARKS(count) \
+NONIUS_BENCHMARK("aabb_tree::query " #count, [](nonius::chronometer meter) { \
+	bench::scene s(count); \
+	meter.measure([&](int i) { \
+		s.result.clear(); \
+		return s.tree.query(s.query_box(i), s.result); \
+	}); \
+}) \
+\
+NONIUS_BENCHMARK("linear scan " #count, [](nonius::chronometer meter) { \
+	bench::scene s(count); \
+	meter.measure([&](int i) { \
+		s.result.clear(); \
+		auto box = s.query_box(i); \
+		for (size_t j = 0; j < s.boxes.size(); ++j) { \
+			if (s.boxes[j].intersects(box)) \
+				s.result.push_back(int(j)); \
+		} \
+		return s.result.size(); \
+	}); \
+}) \
+\
+NONIUS_BENCHMARK("aabb_tree::raycast " #count, [](nonius::chronometer meter) { \
+	bench::scene s(count); \
+	meter.measure([&](int i) { \
+		s.result.clear(); \
+		return s.tree.raycast({ s.boxes[i % count].center(), { 1, 0, 0.5f } }, 100, s.result); \
+	}); \
+}) \
+\
+NONIUS_BENCHMARK("aabb_tree::move " #count, [](nonius::chronometer meter) { \
+	bench::scene s(count); \
+	meter.measure([&](int i) { \
+		auto&& b = s.boxes[i % count]; \
+		auto offset = vec3(i % 2 ? 0.05f : -0.05f, 0, 0); \
+		b = { b.min + offset, b.max + offset }; \
+		return s.tree.move(s.proxies[i % count], b); \
+	}); \
+})
+
+SPATIAL_BENCHMARKS(10000)
+SPATIAL_BENCHMARKS(100000)
@@ -0,0 +1,314 @@
+#include "nonius.hpp"
+
+#include <cobalt/sprite_batch.hpp>
+
+#include <cstring>
+#include <random>
+
+using namespace cobalt;
+
+namespace bench {
+
+constexpr size_t sprites = 50000;
+
+// Graphics API without GPU, buffers are system memory and draws do nothing
+class null_device {
+public:
+	using buffer_type = uint32_t;
+	using fence_type = uint32_t;
+
+	explicit null_device(bool persistent) noexcept : _persistent(persistent) {}
+
+	bool persistent_mapping() const { return _persistent; }
+	buffer_type create_buffer(buffer_target, size_t size, buffer_storage) {
+		_buffers.emplace_back(size);
+		return static_cast<buffer_type>(_buffers.size() - 1);
+	}
+	void destroy_buffer(buffer_type) {}
+	void orphan_buffer(buffer_type, size_t) {}
+	void* map_buffer(buffer_type buffer, size_t offset, size_t, buffer_storage) { return _buffers[buffer].data() + offset; }
+	void unmap_buffer(buffer_type) {}
+	fence_type insert_fence() { return 0; }
+	void wait_fence(fence_type) {}
+	void delete_fence(fence_type) {}
+	void draw_sprites(buffer_type, buffer_type, size_t, size_t count, uint32_t, blend_mode) { drawn += count; }
+
+	size_t drawn = 0;
+
+private:
+	bool _persistent;
+	std::vector<std::vector<uint8_t>> _buffers;
+};
+
+struct sprite {
+	sprite_texture texture;
+	rectf dest;
+	float depth;
+};
+
+std::vector<sprite> make_sprites() {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> pos(0, 1920), depth(0, 1);
+	std::uniform_int_distribution<uint32_t> texture(1, 8);
+	std::vector<sprite> result;
+	for (size_t i = 0; i < sprites; ++i)
+		result.push_back({ { texture(rng), 256, 256 }, { pos(rng), pos(rng), 32, 32 }, depth(rng) });
+	return result;
+}
+
+// Queue of sprites copied into staging vertices and then into buffer per batch
+class copying_batch {
+public:
+	static constexpr size_t batch_size = 4096;
+
+	copying_batch() : _staging(batch_size * 4), _buffer(batch_size * 4) {}
+
+	void draw(const sprite& s) {
+		auto&& info = _sprites.emplace_back();
+		info.texture = s.texture.handle;
+		auto x1 = s.dest.x + s.dest.width, y1 = s.dest.y + s.dest.height;
+		info.quad[0] = { s.dest.x, s.dest.y, s.depth, 0xffffffff, 0, 0 };
+		info.quad[1] = { s.dest.x, y1, s.depth, 0xffffffff, 0, 1 };
+		info.quad[2] = { x1, y1, s.depth, 0xffffffff, 1, 1 };
+		info.quad[3] = { x1, s.dest.y, s.depth, 0xffffffff, 1, 0 };
+	}
+
+	size_t end() {
+		std::vector<const sprite_info*> sorted;
+		for (auto&& s : _sprites)
+			sorted.push_back(&s);
+		std::stable_sort(sorted.begin(), sorted.end(), [](const sprite_info* a, const sprite_info* b) { return a->texture < b->texture; });
+
+		size_t drawn = 0;
+		for (size_t first = 0; first < sorted.size(); first += batch_size) {
+			auto count = std::min(batch_size, sorted.size() - first);
+			for (size_t i = 0; i < count; ++i)
+				std::memcpy(&_staging[i * 4], sorted[first + i]->quad, sizeof(sprite_info::quad));
+			std::memcpy(_buffer.data(), _staging.data(), count * 4 * sizeof(sprite_vertex));
+			drawn += count;
+		}
+		_sprites.clear();
+		return drawn;
+	}
+
+private:
+	struct sprite_info {
+		sprite_vertex quad[4];
+		uint32_t texture;
+	};
+
+	std::vector<sprite_info> _sprites;
+	std::vector<sprite_vertex> _staging;
+	std::vector<sprite_vertex> _buffer;
+};
+
+} // namespace bench
+
+NONIUS_BENCHMARK("copying sprite batch 50000 sprites", [](nonius::chronometer meter) {
+	using namespace bench;
+	auto input = make_sprites();
+	copying_batch batch;
+	meter.measure([&] {
+		for (auto&& s : input)
+			batch.draw(s);
+		return batch.end();
+	});
+})
+
+NONIUS_BENCHMARK("sprite_batch 50000 sprites, orphaned", [](nonius::chronometer meter) {
+	using namespace bench;
+	auto input = make_sprites();
+	null_device device(false);
+	basic_sprite_batch<null_device> batch(device, sprites);
+	meter.measure([&] {
+		batch.begin(sprite_sort::texture);
+		for (auto&& s : input)
+			batch.draw(s.texture, blend_mode::modulate, { 0, 0, 256, 256 }, s.dest, 0xffffffff, s.depth);
+		batch.end();
+		return device.drawn;
+	});
+})
+
+NONIUS_BENCHMARK("sprite_batch 50000 sprites, persistent", [](nonius::chronometer meter) {
+	using namespace bench;
+	auto input = make_sprites();
+	null_device device(true);
+	basic_sprite_batch<null_device> batch(device, sprites);
+	meter.measure([&] {
+		batch.begin(sprite_sort::texture);
+		for (auto&& s : input)
+			batch.draw(s.texture, blend_mode::modulate, { 0, 0, 256, 256 }, s.dest, 0xffffffff, s.depth);
+		batch.end();
+		return device.drawn;
+	});
+})
+
+namespace bench {
+
+constexpr size_t sorted_sprites = 100000;
+
+// Sprites sorted through pointers, comparing fields of their textures
+struct texture_object {
+	uint32_t handle;
+	char data[60];
+};
+
+struct sprite_info {
+	sprite_vertex quad[4];
+	texture_object* texture;
+	blend_mode blend;
+};
+
+} // namespace bench
+
+NONIUS_BENCHMARK("std::sort sprite pointers by texture 100000", [](nonius::chronometer meter) {
+	using namespace bench;
+	std::mt19937 rng(1);
+	std::vector<texture_object> textures(64);
+	for (size_t i = 0; i < textures.size(); ++i)
+		textures[i].handle = uint32_t(i + 1);
+	std::vector<sprite_info> input(sorted_sprites);
+	for (auto&& s : input)
+		s.texture = &textures[rng() % textures.size()];
+	std::vector<const sprite_info*> sorted(sorted_sprites);
+	meter.measure([&] {
+		for (size_t i = 0; i < input.size(); ++i)
+			sorted[i] = &input[i];
+		std::sort(sorted.begin(), sorted.end(), [](const sprite_info* a, const sprite_info* b) {
+			return a->texture->handle < b->texture->handle;
+		});
+		return sorted.front();
+	});
+})
+
+NONIUS_BENCHMARK("std::sort sprite pointers by depth 100000", [](nonius::chronometer meter) {
+	using namespace bench;
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> depth(0, 1);
+	std::vector<sprite_info> input(sorted_sprites);
+	for (auto&& s : input)
+		s.quad[0].z = depth(rng);
+	std::vector<const sprite_info*> sorted(sorted_sprites);
+	meter.measure([&] {
+		for (size_t i = 0; i < input.size(); ++i)
+			sorted[i] = &input[i];
+		std::sort(sorted.begin(), sorted.end(), [](const sprite_info* a, const sprite_info* b) {
+			return a->quad[0].z < b->quad[0].z;
+		});
+		return sorted.front();
+	});
+})
+
+NONIUS_BENCHMARK("radix_sort keys by texture 100000", [](nonius::chronometer meter) {
+	using namespace bench;
+	std::mt19937 rng(1);
+	std::vector<uint64_t> input(sorted_sprites), keys(sorted_sprites), scratch(sorted_sprites);
+	for (size_t i = 0; i < input.size(); ++i)
+		input[i] = uint64_t(rng() % 64 + 1) << 40 | i;
+	meter.measure([&] {
+		keys = input;
+		radix_sort(keys.data(), scratch.data(), keys.size(), 32);
+		return keys.front();
+	});
+})
+
+NONIUS_BENCHMARK("radix_sort keys by depth 100000", [](nonius::chronometer meter) {
+	using namespace bench;
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> depth(0, 1);
+	std::vector<uint64_t> input(sorted_sprites), keys(sorted_sprites), scratch(sorted_sprites);
+	for (size_t i = 0; i < input.size(); ++i) {
+		auto z = depth(rng);
+		uint32_t bits;
+		std::memcpy(&bits, &z, sizeof(bits));
+		input[i] = uint64_t(bits ^ 0x80000000u) << 32 | i;
+	}
+	meter.measure([&] {
+		keys = input;
+		radix_sort(keys.data(), scratch.data(), keys.size(), 32);
+		return keys.front();
+	});
+})
+
+NONIUS_BENCHMARK("sprite_batch 100000 sprites, back to front", [](nonius::chronometer meter) {
+	using namespace bench;
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> pos(0, 1920), depth(0, 1);
+	std::vector<sprite> input;
+	for (size_t i = 0; i < sorted_sprites; ++i)
+		input.push_back({ { uint32_t(rng() % 64 + 1), 256, 256 }, { pos(rng), pos(rng), 32, 32 }, depth(rng) });
+	null_device device(true);
+	basic_sprite_batch<null_device> batch(device, sorted_sprites);
+	meter.measure([&] {
+		batch.begin(sprite_sort::back_to_front);
+		for (auto&& s : input)
+			batch.draw(s.texture, blend_mode::modulate, { 0, 0, 256, 256 }, s.dest, 0xffffffff, s.depth);
+		batch.end();
+		return device.drawn;
+	});
+})
+
+namespace bench {
+
+std::vector<sprite_desc> make_particles() {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> pos(0, 1920), depth(0, 1), angle(0, 6.28f);
+	std::vector<sprite_desc> result(sprites);
+	for (auto&& s : result) {
+		s.texture = { 1, 256, 256 };
+		s.src = { 0, 0, 32, 32 };
+		s.dest = { pos(rng), pos(rng), 16, 16 };
+		s.origin = { 0.5f, 0.5f };
+		s.rotation = angle(rng);
+		s.depth = depth(rng);
+	}
+	return result;
+}
+
+} // namespace bench
+
+NONIUS_BENCHMARK("sprite_batch 50000 sprites, draw", [](nonius::chronometer meter) {
+	using namespace bench;
+	auto input = make_particles();
+	for (auto&& s : input)
+		s.rotation = 0;
+	null_device device(true);
+	basic_sprite_batch<null_device> batch(device, sprites);
+	meter.measure([&] {
+		batch.begin();
+		for (auto&& s : input)
+			batch.draw(s.texture, s.blend, s.src, s.dest, s.color, s.depth);
+		batch.end();
+		return device.drawn;
+	});
+})
+
+NONIUS_BENCHMARK("sprite_batch 50000 sprites, draw_many", [](nonius::chronometer meter) {
+	using namespace bench;
+	auto input = make_particles();
+	for (auto&& s : input) {
+		s.rotation = 0;
+		s.origin = {};
+	}
+	null_device device(true);
+	basic_sprite_batch<null_device> batch(device, sprites);
+	meter.measure([&] {
+		batch.begin();
+		batch.draw_many(input.data(), input.size());
+		batch.end();
+		return device.drawn;
+	});
+})
+
+NONIUS_BENCHMARK("sprite_batch 50000 rotated sprites, draw_many", [](nonius::chronometer meter) {
+	using namespace bench;
+	auto input = make_particles();
+	null_device device(true);
+	basic_sprite_batch<null_device> batch(device, sprites);
+	meter.measure([&] {
+		batch.begin();
+		batch.draw_many(input.data(), input.size());
+		batch.end();
+		return device.drawn;
+	});
+})
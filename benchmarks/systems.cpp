@@ -0,0 +1,73 @@
+#include "nonius.hpp"
+
+#include <cobalt/systems.hpp>
+
+using namespace cobalt;
+
+namespace bench {
+
+struct position {
+	float x = 0, y = 0, z = 0;
+};
+
+struct velocity {
+	float x = 1, y = 0, z = 0;
+};
+
+struct lifetime {
+	float seconds = 100;
+};
+
+// Level of 50k actors with three independent update systems
+struct moving_level {
+	moving_level() {
+		for (int i = 0; i < 50000; ++i) {
+			auto a = make_ref<actor>();
+			l.add_actor(a.get());
+			a->add_data<position>();
+			a->add_data<velocity>();
+			a->add_data<lifetime>();
+			actors.push_back(a);
+		}
+	}
+	
+	~moving_level() {
+		l.clear_actors();
+	}
+	
+	void setup(level_update& update) {
+		update.add_system<velocity>(update_order::update, reads<velocity>{}, writes<position>{}, [](actor& a, const velocity& v) {
+			auto p = a.data<position>();
+			p->x += v.x * 0.016f;
+			p->y += v.y * 0.016f;
+			p->z += v.z * 0.016f;
+		});
+		update.add_system<lifetime>(update_order::update, reads<>{}, writes<lifetime>{}, [](actor&, lifetime& t) {
+			t.seconds -= 0.016f;
+		});
+		update.add_system<velocity>(update_order::post_update, reads<>{}, writes<velocity>{}, [](actor&, velocity& v) {
+			v.y -= 9.8f * 0.016f;
+		});
+	}
+	
+	level l;
+	std::vector<ref_ptr<actor>> actors;
+};
+
+} // namespace bench
+
+NONIUS_BENCHMARK("level_update 50k actors, serial", [](nonius::chronometer meter) {
+	bench::moving_level level;
+	thread_pool pool(0);
+	level_update update(pool);
+	level.setup(update);
+	meter.measure([&] { update.run(level.l); });
+});
+
+NONIUS_BENCHMARK("level_update 50k actors, all cores", [](nonius::chronometer meter) {
+	bench::moving_level level;
+	thread_pool pool;
+	level_update update(pool);
+	level.setup(update);
+	meter.measure([&] { update.run(level.l); });
+});
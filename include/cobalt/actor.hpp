@@ -6,20 +6,31 @@
 // Classes in this file:
 //     actor_component
 //     transform_component
+//     component_range
 //     actor
 //     level
 //
 // Functions in this file:
 //
 
+#include <cobalt/component_storage.hpp>
+#include <cobalt/geometry.hpp>
 #include <cobalt/object.hpp>
+#include <cobalt/spatial_index.hpp>
 #include <cobalt/utility/intrusive.hpp>
 #include <cobalt/utility/type_index.hpp>
 #include <cobalt/utility/identifier.hpp>
 
+#include <boost/container/small_vector.hpp>
+
+#include <algorithm>
+#include <iterator>
 #include <string_view>
+#include <system_error>
+#include <tuple>
 #include <type_traits>
-#include <deque>
+#include <memory>
+#include <vector>
 
 enum class traverse_order {
 	depth_first,
@@ -40,6 +51,18 @@ class actor_component : public object, public intrusive_list_base<basic_list_tag
 public:
 	virtual class actor* actor() const noexcept { return _actor; }
 	
+	/// Copies state of component of the same type, used to instantiate prefabs
+	///
+	/// Components opt in by overriding it and calling `assign_base`, owner and links are not copied.
+	/// Components which don't can't be copied, so they aren't silently captured without their state.
+	virtual void assign(const actor_component&) {
+		throw std::system_error(std::make_error_code(std::errc::not_supported), "component doesn't implement assign");
+	}
+	
+protected:
+	/// Copies state common to all components
+	void assign_base(const actor_component& other) { name(other.name()); }
+	
 private:
 	friend class actor;
 	class actor* _actor = nullptr;
@@ -66,19 +89,150 @@ public:
 	
 	void clear_children() noexcept;
 	
+	transform_component* first_child() noexcept;
+	transform_component* next_sibling() noexcept;
+	
+	/// Calls `handler(node)` for this and all descendants until it returns false
+	///
+	/// Hierarchy must not be changed during traversal. Depth first traversal walks
+	/// parent and sibling links, breadth first one uses per thread reusable queue.
 	template <typename Handler>
 	bool traverse(traverse_order order, Handler handler) noexcept;
 	
+	/// Depth first walk calling `enter(node)` before and `leave(node)` after descendants of node
+	///
+	/// Descendants are skipped if `enter` returns false, `leave` is called anyway.
+	template <typename Enter, typename Leave>
+	void visit(Enter enter, Leave leave) noexcept;
+	
 	void attach_to(transform_component* parent) noexcept;
 	void detach_from_parent() noexcept;
 	
+	const vec3& position() const noexcept { return _position; }
+	void position(const vec3& position) noexcept { _position = position; mark_dirty(); }
+	
+	const quat& rotation() const noexcept { return _rotation; }
+	void rotation(const quat& rotation) noexcept { _rotation = rotation; mark_dirty(); }
+	
+	const vec3& scale() const noexcept { return _scale; }
+	void scale(const vec3& scale) noexcept { _scale = scale; mark_dirty(); }
+	
+	mat4 local_matrix() const noexcept { return mat4::compose(_position, _rotation, _scale); }
+	
+	/// Local to world transform
+	///
+	/// Cached, recomputed only after local transform of this node or its ancestors
+	/// has changed. `level::update_transforms` refreshes all of them at once.
+	const mat4& world_matrix() noexcept;
+	
+	bool dirty() const noexcept { return _dirty; }
+	
+	/// Marks world transform of this node and its descendants outdated
+	void mark_dirty() noexcept;
+	
+	/// Copies local transform, hierarchy is not copied
+	virtual void assign(const actor_component& other) override;
+	
+	virtual void reset() noexcept override;
+	
 private:
+	void hierarchy_changed() const noexcept;
+	
 	transform_component* _parent = nullptr;
 	children_type _children;
+	vec3 _position;
+	quat _rotation;
+	vec3 _scale{1, 1, 1};
+	mat4 _world;
+	bool _dirty = false;
 };
 
 class level;
 
+///
+/// Range of actor components of the same type
+///
+/// Valid until components or transform hierarchy of the actor are changed.
+///
+template <typename T>
+class component_range {
+public:
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T*;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T* const*;
+		using reference = T*;
+		
+		iterator() noexcept = default;
+		explicit iterator(actor_component* const* p) noexcept : _p(p) {}
+		
+		T* operator*() const noexcept { return static_cast<T*>(*_p); }
+		iterator& operator++() noexcept { ++_p; return *this; }
+		iterator operator++(int) noexcept { auto it = *this; ++_p; return it; }
+		
+		friend bool operator==(const iterator& lhs, const iterator& rhs) noexcept { return lhs._p == rhs._p; }
+		friend bool operator!=(const iterator& lhs, const iterator& rhs) noexcept { return lhs._p != rhs._p; }
+		
+	private:
+		actor_component* const* _p = nullptr;
+	};
+	
+	component_range() noexcept = default;
+	component_range(actor_component* const* first, actor_component* const* last) noexcept : _first(first), _last(last) {}
+	
+	iterator begin() const noexcept { return iterator(_first); }
+	iterator end() const noexcept { return iterator(_last); }
+	
+	size_t size() const noexcept { return _last - _first; }
+	bool empty() const noexcept { return _first == _last; }
+	
+	T* operator[](size_t i) const noexcept { BOOST_ASSERT(i < size()); return static_cast<T*>(_first[i]); }
+	
+private:
+	actor_component* const* _first = nullptr;
+	actor_component* const* _last = nullptr;
+};
+
+namespace detail {
+
+///
+/// Components of actor grouped by exact type
+///
+/// Index is rebuilt as a whole on first lookup after a change, so it is just an
+/// open addressing table keyed by type over a single array of components.
+///
+class component_index {
+public:
+	bool valid() const noexcept { return _valid; }
+	void invalidate() noexcept { _valid = false; }
+	
+	/// Rebuilds index from components visited by `traverse(visitor)`, keeping the visiting order within each type
+	template <typename Traverse>
+	void rebuild(Traverse traverse);
+	
+	std::pair<actor_component* const*, actor_component* const*> find(const type_index& type) const noexcept;
+	
+private:
+	struct bucket {
+		const void* key = nullptr;
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+	
+	static const void* key(const type_index& type) noexcept { return &type.type_info(); }
+	
+	bucket* lookup(const void* key) noexcept;
+	
+	std::vector<actor_component*> _components;
+	std::vector<actor_component*> _scratch;
+	std::vector<bucket> _buckets;
+	bool _valid = false;
+};
+
+} // namespace detail
+
 ///
 /// Actor is a container for components
 ///
@@ -110,21 +264,65 @@ public:
 	T* find_component(traverse_order order = traverse_order::depth_first) noexcept;
 	template <typename T, typename OutputIterator>
 	size_t find_components(OutputIterator components, traverse_order order = traverse_order::depth_first) noexcept;
+	/// Components of exact type T in depth first order
+	template <typename T>
+	component_range<T> find_components() noexcept;
+	
+	/// Adds data component, which is stored contiguously with components of the same type in level storage
+	///
+	/// References to data stay valid until components of the same type are added or removed
+	/// in the storage, of detached actors only under `component_storage::lock_if_detached`
+	/// if other threads change detached data.
+	template <typename T, typename... Args>
+	T& add_data(Args&&... args);
+	template <typename T>
+	T* data() noexcept;
+	template <typename T>
+	component_handle data_handle() const noexcept;
+	template <typename T>
+	void remove_data() noexcept;
+	
+	void clear_data() noexcept;
+	
+	/// Storage of data components, detached storage if actor is not attached to level
+	component_storage& storage() const noexcept;
+	
+	/// World space bounds, actors with empty bounds are not included in level spatial index
+	const aabb& bounds() const noexcept { return _bounds; }
+	void bounds(const aabb& bounds);
 	
 	level* level() const noexcept { return _level; }
 
-	void attach_to(class level* level) noexcept;
-	void detach_from_level() noexcept;
+	void attach_to(class level* level);
+	void detach_from_level();
 	
 	void active(bool active) noexcept { _active = active; }
 	bool active_self() const noexcept { return _active; }
 	//bool active_in_hierarchy() const noexcept;
+	
+	virtual void reset() noexcept override;
 
 private:
+	struct data_entry {
+		uint32_t type;
+		component_handle handle;
+	};
+	
+	data_entry* find_data(uint32_t type) noexcept;
+	void move_data(component_storage& from, component_storage& to);
+	
+	std::pair<actor_component* const*, actor_component* const*> indexed_components(const type_index& type) noexcept;
+	
 	friend class level;
+	friend class transform_component;
+	friend class prefab;
 	class level* _level = nullptr;
 	ref_ptr<transform_component> _transform;
 	components_type _components;
+	boost::container::small_vector<data_entry, 4> _data;
+	detail::component_index _index;
+	aabb _bounds;
+	aabb_tree<actor*>::proxy_id _proxy = aabb_tree<actor*>::null;
 	bool _active = true;
 };
 
@@ -141,13 +339,49 @@ public:
 	
 	const actors_type& actors() const noexcept { return _actors; }
 	
-	void add_actor(actor* actor) noexcept;
-	void remove_actor(actor* actor) noexcept;
+	/// Adds actor moving its data components to level storage, actor stays detached if it throws
+	void add_actor(actor* actor);
+	/// Removes actor moving its data components to detached storage, actor stays in level if it throws
+	void remove_actor(actor* actor);
+	
+	void clear_actors();
 	
-	void clear_actors() noexcept;
+	component_storage& storage() noexcept { return _storage; }
+	
+	/// All data components of type T in the level
+	template <typename T>
+	component_view<T> view() noexcept { return _storage.view<T>(); }
+	
+	/// Calls `function(actor&, T&, Ts&...)` for every actor having all listed data components
+	///
+	/// Components must not be added or removed during iteration.
+	template <typename T, typename... Ts, typename Function>
+	void each(Function function);
+	
+	/// Recomputes outdated world transforms of all actors, parents before children
+	void update_transforms();
+	
+	/// Index of actor bounds
+	const aabb_tree<actor*>& spatial_index() const noexcept { return _spatial_index; }
+	
+	/// Appends actors which bounds intersect box, returns number of them
+	size_t query(const aabb& box, std::vector<actor*>& result) const { return _spatial_index.query(box, result); }
+	/// Appends actors which bounds intersect frustum, returns number of them
+	size_t query(const frustum& f, std::vector<actor*>& result) const { return _spatial_index.query(f, result); }
+	/// Appends actors which bounds are hit by ray, returns number of them
+	size_t raycast(const ray& r, float max_distance, std::vector<actor*>& result) const { return _spatial_index.raycast(r, max_distance, result); }
 	
 private:
+	friend class actor;
+	friend class transform_component;
+	
+	void detach(actor* actor);
+	
 	actors_type _actors;
+	component_storage _storage;
+	std::vector<transform_component*> _transforms;   ///< All transforms in pre-order
+	bool _transforms_valid = false;
+	aabb_tree<actor*> _spatial_index;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -180,46 +414,108 @@ inline void transform_component::add_child(transform_component* child) noexcept
 		retain(child);
 	_children.push_back(*child);
 	child->_parent = this;
+	child->mark_dirty();
+	hierarchy_changed();
 }
 
 inline void transform_component::remove_child(transform_component* child) noexcept {
 	BOOST_ASSERT(!!child);
+	hierarchy_changed();
 	_children.erase_and_dispose(_children.iterator_to(*child), [](transform_component* child) {
 		child->_parent = nullptr;
+		child->mark_dirty();
 		release(child);
 	});
 }
 
 inline void transform_component::clear_children() noexcept {
+	hierarchy_changed();
 	_children.clear_and_dispose([](transform_component* child) {
 		child->_parent = nullptr;
+		child->mark_dirty();
 		release(child);
 	});
 }
 
-namespace detail {
-
-struct lifo {
-	void push(transform_component* comp) { _deque.push_back(comp); }
-	transform_component* pop() { auto comp = _deque.back(); _deque.pop_back(); return comp; }
-	bool empty() const { return _deque.empty(); }
+inline transform_component* transform_component::first_child() noexcept {
+	return _children.empty() ? nullptr : &_children.front();
+}
 
-private:
-	std::deque<transform_component*> _deque;
-};
+inline transform_component* transform_component::next_sibling() noexcept {
+	if (!_parent)
+		return nullptr;
+	auto next = std::next(_parent->_children.iterator_to(*this));
+	return next != _parent->_children.end() ? &*next : nullptr;
+}
 
-struct fifo {
-	void push(transform_component* comp) { _deque.push_front(comp); }
-	transform_component* pop() { auto comp = _deque.back(); _deque.pop_back(); return comp; }
-	bool empty() const { return _deque.empty(); }
+namespace detail {
 
+/// Queue of nodes for breadth first traversal
+///
+/// Buffers are kept per thread and reused, so traversal doesn't allocate once they
+/// have grown. Every nested traversal takes its own buffer.
+class traverse_frontier {
+public:
+	traverse_frontier() : _buffer(acquire()) {}
+	~traverse_frontier() { _buffer.clear(); --cache().depth; }
+	
+	traverse_frontier(const traverse_frontier&) = delete;
+	traverse_frontier& operator=(const traverse_frontier&) = delete;
+	
+	void push(transform_component* node) { _buffer.push_back(node); }
+	transform_component* pop() noexcept { return _buffer[_head++]; }
+	bool empty() const noexcept { return _head == _buffer.size(); }
+	
 private:
-	std::deque<transform_component*> _deque;
+	struct buffer_cache {
+		std::vector<std::unique_ptr<std::vector<transform_component*>>> buffers;
+		size_t depth = 0;
+	};
+	
+	static buffer_cache& cache() noexcept {
+		static thread_local buffer_cache cache;
+		return cache;
+	}
+	
+	static std::vector<transform_component*>& acquire() {
+		auto&& c = cache();
+		if (c.depth == c.buffers.size())
+			c.buffers.push_back(std::make_unique<std::vector<transform_component*>>());
+		return *c.buffers[c.depth++];
+	}
+	
+	std::vector<transform_component*>& _buffer;
+	size_t _head = 0;
 };
 
-template <typename Frontier, typename Handler>
-static bool traverse(transform_component* root, Handler handler) {
-	Frontier frontier;
+/// Stackless pre-order walk over parent and sibling links
+template <typename Handler>
+static bool dfs(transform_component* root, Handler handler) {
+	auto node = root;
+	for (;;) {
+		if (!handler(node))
+			return false;
+		
+		if (auto child = node->first_child()) {
+			node = child;
+			continue;
+		}
+		
+		for (;;) {
+			if (node == root)
+				return true;
+			if (auto sibling = node->next_sibling()) {
+				node = sibling;
+				break;
+			}
+			node = node->parent();
+		}
+	}
+}
+
+template <typename Handler>
+static bool bfs(transform_component* root, Handler handler) {
+	traverse_frontier frontier;
 	
 	frontier.push(root);
 	
@@ -236,16 +532,6 @@ static bool traverse(transform_component* root, Handler handler) {
 	return true;
 }
 
-template <typename Handler>
-static bool dfs(transform_component* root, Handler handler) {
-	return traverse<lifo>(root, handler);
-}
-
-template <typename Handler>
-static bool bfs(transform_component* root, Handler handler) {
-	return traverse<fifo>(root, handler);
-}
-
 } // namespace detail
 
 template <typename Handler>
@@ -256,6 +542,31 @@ inline bool transform_component::traverse(traverse_order order, Handler handler)
 	case traverse_order::breadth_first:
 		return detail::bfs(this, handler);
 	};
+	return false;
+}
+
+template <typename Enter, typename Leave>
+inline void transform_component::visit(Enter enter, Leave leave) noexcept {
+	auto node = this;
+	for (;;) {
+		if (enter(node)) {
+			if (auto child = node->first_child()) {
+				node = child;
+				continue;
+			}
+		}
+		
+		for (;;) {
+			leave(node);
+			if (node == this)
+				return;
+			if (auto sibling = node->next_sibling()) {
+				node = sibling;
+				break;
+			}
+			node = node->parent();
+		}
+	}
 }
 
 inline void transform_component::attach_to(transform_component* parent) noexcept {
@@ -267,13 +578,132 @@ inline void transform_component::detach_from_parent() noexcept {
 	if (_parent)
 		_parent->remove_child(this);
 }
+
+inline const mat4& transform_component::world_matrix() noexcept {
+	if (_dirty) {
+		_world = _parent ? _parent->world_matrix() * local_matrix() : local_matrix();
+		_dirty = false;
+	}
+	return _world;
+}
+
+inline void transform_component::mark_dirty() noexcept {
+	// Descendants of dirty node are always dirty, so such subtrees are skipped
+	visit([](transform_component* node) {
+		if (node->_dirty)
+			return false;
+		node->_dirty = true;
+		return true;
+	}, [](transform_component*) {});
+}
+
+inline void transform_component::assign(const actor_component& other) {
+	BOOST_ASSERT(other.object_type() == object_type());
+	auto&& t = static_cast<const transform_component&>(other);
+	_position = t._position;
+	_rotation = t._rotation;
+	_scale = t._scale;
+	mark_dirty();
+	assign_base(other);
+}
+
+inline void transform_component::reset() noexcept {
+	clear_children();
+	_position = {};
+	_rotation = {};
+	_scale = { 1, 1, 1 };
+	_world = {};
+	_dirty = false;
+	actor_component::reset();
+}
+
+inline void transform_component::hierarchy_changed() const noexcept {
+	// Node belongs to transforms of all actors above it, not only the nearest one
+	for (auto node = this; node; node = node->_parent) {
+		if (auto a = node->actor_component::actor()) {
+			a->_index.invalidate();
+			if (a->_level)
+				a->_level->_transforms_valid = false;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// component_index
+//
+
+namespace detail {
+
+template <typename Traverse>
+inline void component_index::rebuild(Traverse traverse) {
+	_scratch.clear();
+	traverse([this](actor_component* component) -> bool {
+		_scratch.push_back(component);
+		return true;
+	});
+	
+	// At least twice as many buckets as there can be types
+	size_t size = 8;
+	while (size < 2 * _scratch.size())
+		size *= 2;
+	_buckets.assign(size, bucket());
+	
+	for (auto component : _scratch)
+		++lookup(key(component->object_type()))->count;
+	
+	uint32_t first = 0;
+	for (auto&& b : _buckets) {
+		b.first = first;
+		first += b.count;
+		b.count = 0;
+	}
+	
+	_components.resize(_scratch.size());
+	for (auto component : _scratch) {
+		auto b = lookup(key(component->object_type()));
+		_components[b->first + b->count++] = component;
+	}
+	
+	_valid = true;
+}
+
+inline component_index::bucket* component_index::lookup(const void* key) noexcept {
+	auto mask = _buckets.size() - 1;
+	auto i = (reinterpret_cast<uintptr_t>(key) >> 4) & mask;
+	while (_buckets[i].key != key && _buckets[i].key)
+		i = (i + 1) & mask;
+	_buckets[i].key = key;
+	return &_buckets[i];
+}
+
+inline std::pair<actor_component* const*, actor_component* const*> component_index::find(const type_index& type) const noexcept {
+	BOOST_ASSERT(_valid);
+	if (_buckets.empty())
+		return {};
+	
+	auto k = key(type);
+	auto mask = _buckets.size() - 1;
+	for (auto i = (reinterpret_cast<uintptr_t>(k) >> 4) & mask; _buckets[i].key; i = (i + 1) & mask) {
+		if (_buckets[i].key == k) {
+			auto first = _components.data() + _buckets[i].first;
+			return { first, first + _buckets[i].count };
+		}
+	}
+	return {};
+}
+
+} // namespace detail
 	
 ////////////////////////////////////////////////////////////////////////////////
 // actor
 //
 
 inline actor::~actor() {
+	// Transform may outlive actor as a child of another transform
+	if (_transform)
+		_transform->_actor = nullptr;
 	clear_components();
+	clear_data();
 }
 
 inline void actor::add_component(actor_component* component) noexcept {
@@ -282,10 +712,12 @@ inline void actor::add_component(actor_component* component) noexcept {
 		retain(component);
 	_components.push_back(*component);
 	component->_actor = this;
+	_index.invalidate();
 }
 
 inline void actor::remove_component(actor_component* component) noexcept {
 	BOOST_ASSERT(!!component);
+	_index.invalidate();
 	_components.erase_and_dispose(_components.iterator_to(*component), [](actor_component* c) {
 		c->_actor = nullptr;
 		release(c);
@@ -293,6 +725,7 @@ inline void actor::remove_component(actor_component* component) noexcept {
 }
 
 inline void actor::clear_components() noexcept {
+	_index.invalidate();
 	_components.clear_and_dispose([](actor_component* component) {
 		component->_actor = nullptr;
 		release(component);
@@ -310,7 +743,21 @@ inline void actor::traverse_components(traverse_order order, Handler handler) no
 	}
 }
 
+inline std::pair<actor_component* const*, actor_component* const*> actor::indexed_components(const type_index& type) noexcept {
+	if (!_index.valid()) {
+		_index.rebuild([this](auto visitor) {
+			traverse_components(traverse_order::depth_first, visitor);
+		});
+	}
+	return _index.find(type);
+}
+
 inline actor_component* actor::find_component_by_type(const type_index& type, traverse_order order) noexcept {
+	if (order == traverse_order::depth_first) {
+		auto range = indexed_components(type);
+		return range.first != range.second ? *range.first : nullptr;
+	}
+	
 	actor_component* result = nullptr;
 	
 	traverse_components(order, [&](actor_component* component) -> bool {
@@ -325,6 +772,12 @@ inline actor_component* actor::find_component_by_type(const type_index& type, tr
 }
 
 inline size_t actor::find_components_by_type(const type_index& type, std::vector<actor_component*>& components, traverse_order order) noexcept {
+	if (order == traverse_order::depth_first) {
+		auto range = indexed_components(type);
+		components.insert(components.end(), range.first, range.second);
+		return range.second - range.first;
+	}
+	
 	size_t initial_size = components.size();
 	
 	traverse_components(order, [&](actor_component* component) -> bool {
@@ -343,6 +796,12 @@ inline T* actor::find_component(traverse_order order) noexcept {
 
 template <typename T, typename OutputIterator>
 inline size_t actor::find_components(OutputIterator components, traverse_order order) noexcept {
+	if (order == traverse_order::depth_first) {
+		auto range = find_components<T>();
+		std::copy(range.begin(), range.end(), components);
+		return range.size();
+	}
+	
 	size_t count = 0;
 	
 	traverse_components(order, [&](actor_component* component) -> bool {
@@ -356,17 +815,117 @@ inline size_t actor::find_components(OutputIterator components, traverse_order o
 	return count;
 }
 
-inline void actor::attach_to(class level* level) noexcept {
+template <typename T>
+inline component_range<T> actor::find_components() noexcept {
+	auto range = indexed_components(T::class_type());
+	return { range.first, range.second };
+}
+
+template <typename T, typename... Args>
+inline T& actor::add_data(Args&&... args) {
+	auto&& s = storage();
+	auto lock = component_storage::lock_if_detached(s);
+	auto&& pool = s.pool<T>();
+	if (auto entry = find_data(component_type_id<T>())) {
+		BOOST_ASSERT(!"data component already exists");
+		pool.destroy(entry->handle);
+		entry->handle = pool.create(this, std::forward<Args>(args)...);
+		return *pool.get(entry->handle);
+	}
+	
+	auto handle = pool.create(this, std::forward<Args>(args)...);
+	try {
+		_data.push_back({ component_type_id<T>(), handle });
+	} catch (...) {
+		pool.destroy(handle);
+		throw;
+	}
+	return *pool.get(handle);
+}
+
+template <typename T>
+inline T* actor::data() noexcept {
+	if (auto entry = find_data(component_type_id<T>())) {
+		auto&& s = storage();
+		auto lock = component_storage::lock_if_detached(s);
+		return s.find_pool<T>()->get(entry->handle);
+	}
+	return nullptr;
+}
+
+template <typename T>
+inline component_handle actor::data_handle() const noexcept {
+	for (auto&& entry : _data) {
+		if (entry.type == component_type_id<T>())
+			return entry.handle;
+	}
+	return {};
+}
+
+template <typename T>
+inline void actor::remove_data() noexcept {
+	if (auto entry = find_data(component_type_id<T>())) {
+		auto&& s = storage();
+		auto lock = component_storage::lock_if_detached(s);
+		s.find_pool<T>()->destroy(entry->handle);
+		_data.erase(_data.begin() + (entry - _data.data()));
+	}
+}
+
+inline void actor::clear_data() noexcept {
+	auto&& s = storage();
+	auto lock = component_storage::lock_if_detached(s);
+	for (auto&& entry : _data)
+		s.find_pool(entry.type)->destroy(entry.handle);
+	_data.clear();
+}
+
+inline actor::data_entry* actor::find_data(uint32_t type) noexcept {
+	for (auto&& entry : _data) {
+		if (entry.type == type)
+			return &entry;
+	}
+	return nullptr;
+}
+
+inline void actor::move_data(component_storage& from, component_storage& to) {
+	if (&from == &to)
+		return;
+	
+	auto lock_from = component_storage::lock_if_detached(from);
+	auto lock_to = component_storage::lock_if_detached(to);
+	size_t moved = 0;
+	try {
+		for (; moved < _data.size(); ++moved) {
+			auto&& entry = _data[moved];
+			auto source = from.find_pool(entry.type);
+			BOOST_ASSERT(source);
+			entry.handle = source->move_to(entry.handle, to.pool(entry.type, *source));
+		}
+	} catch (...) {
+		// Moving back only refills slots freed above, so it doesn't allocate
+		while (moved--) {
+			auto&& entry = _data[moved];
+			entry.handle = to.find_pool(entry.type)->move_to(entry.handle, *from.find_pool(entry.type));
+		}
+		throw;
+	}
+}
+
+inline void actor::attach_to(class level* level) {
 	BOOST_ASSERT(!!level);
 	level->add_actor(this);
 }
 
-inline void actor::detach_from_level() noexcept {
+inline void actor::detach_from_level() {
 	if (_level)
 		_level->remove_actor(this);
 }
 
 inline void actor::transform(transform_component* transform) noexcept {
+	_index.invalidate();
+	if (_level)
+		_level->_transforms_valid = false;
 	if (_transform)
 		_transform->_actor = nullptr;
 
@@ -374,35 +933,144 @@ inline void actor::transform(transform_component* transform) noexcept {
 		_transform->_actor = this;
 }
 
+inline void actor::reset() noexcept {
+	BOOST_ASSERT(!_level);
+	clear_components();
+	clear_data();
+	transform(nullptr);
+	_bounds = {};
+	_active = true;
+	object::reset();
+}
+
+inline component_storage& actor::storage() const noexcept {
+	return _level ? _level->storage() : component_storage::detached();
+}
+
+inline void actor::bounds(const aabb& bounds) {
+	_bounds = bounds;
+	if (!_level)
+		return;
+	
+	auto&& index = _level->_spatial_index;
+	if (_proxy == index.null) {
+		if (!bounds.empty())
+			_proxy = index.insert(bounds, this);
+	} else if (bounds.empty()) {
+		index.remove(_proxy);
+		_proxy = index.null;
+	} else {
+		index.move(_proxy, bounds);
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // level
 //
 
 inline level::~level() {
+	// Actors referenced elsewhere move their data out, running out of memory here terminates
 	clear_actors();
 }
 
-inline void level::add_actor(actor* actor) noexcept {
+inline void level::add_actor(actor* actor) {
 	BOOST_ASSERT(!!actor);
+	// Allocating steps go first, nothing is changed if they throw
+	auto proxy = _spatial_index.null;
+	if (!actor->_bounds.empty())
+		proxy = _spatial_index.insert(actor->_bounds, actor);
+	try {
+		actor->move_data(actor->storage(), _storage);
+	} catch (...) {
+		if (proxy != _spatial_index.null)
+			_spatial_index.remove(proxy);
+		throw;
+	}
+	
 	if (!actor->is_linked())
 		retain(actor);
+	actor->_proxy = proxy;
 	_actors.push_back(*actor);
 	actor->_level = this;
+	_transforms_valid = false;
 }
 
-inline void level::remove_actor(actor* actor) noexcept {
-	BOOST_ASSERT(!!actor);
-	_actors.erase_and_dispose(_actors.iterator_to(*actor), [](class actor* actor) {
-		actor->_level = nullptr;
-		release(actor);
-	});
+inline void level::remove_actor(actor* actor) {
+	BOOST_ASSERT(!!actor && actor->_level == this);
+	detach(actor);
+	_actors.erase(_actors.iterator_to(*actor));
+	release(actor);
 }
 
-inline void level::clear_actors() noexcept {
-	_actors.clear_and_dispose([](actor* actor) {
-		actor->_level = nullptr;
-		release(actor);
-	});
+inline void level::clear_actors() {
+	while (!_actors.empty())
+		remove_actor(&_actors.front());
+}
+
+inline void level::detach(actor* actor) {
+	// Actor that is about to be destroyed doesn't need its data moved, moving is the only step that may throw
+	if (actor->use_count() == 1)
+		actor->clear_data();
+	else
+		actor->move_data(_storage, component_storage::detached());
+	
+	_transforms_valid = false;
+	if (actor->_proxy != _spatial_index.null) {
+		_spatial_index.remove(actor->_proxy);
+		actor->_proxy = _spatial_index.null;
+	}
+	actor->_level = nullptr;
+}
+
+inline void level::update_transforms() {
+	if (!_transforms_valid) {
+		// Transforms of actors nested below transforms of other actors of this level are walked with them
+		auto nested = [this](transform_component* root) {
+			for (auto p = root->parent(); p; p = p->parent()) {
+				auto owner = p->actor_component::actor();
+				if (owner && owner->_level == this)
+					return true;
+			}
+			return false;
+		};
+		
+		_transforms.clear();
+		for (auto&& a : _actors) {
+			auto root = a.transform();
+			if (root && !nested(root)) {
+				root->traverse(traverse_order::depth_first, [this](transform_component* node) {
+					_transforms.push_back(node);
+					return true;
+				});
+			}
+		}
+		_transforms_valid = true;
+	}
+	
+	// Parent is already up to date when its child is visited, so every world matrix is computed once
+	for (auto node : _transforms) {
+		if (node->dirty())
+			node->world_matrix();
+	}
+}
+
+template <typename T, typename... Ts, typename Function>
+inline void level::each(Function function) {
+	auto pool = _storage.find_pool<T>();
+	if (!pool)
+		return;
+	
+	auto data = pool->data();
+	auto owners = pool->owners();
+	for (size_t i = 0, size = pool->size(); i < size; ++i) {
+		if constexpr (sizeof...(Ts) == 0) {
+			function(*owners[i], data[i]);
+		} else {
+			auto others = std::make_tuple(owners[i]->template data<Ts>()...);
+			if (std::apply([](auto... p) { return (... && p); }, others))
+				std::apply([&](auto... p) { function(*owners[i], data[i], *p...); }, others);
+		}
+	}
 }
 
 //inline bool actor::active_in_hierarchy() const noexcept {
@@ -7,6 +7,7 @@
 #include <cobalt/com/error.hpp>
 #include <cobalt/com/utility.hpp>
 #include <cobalt/com/std.hpp>
+#include <cobalt/com/allocator.hpp>
 #include <cobalt/com/base.hpp>
 
 #endif // COBALT_COM_HPP_INCLUDED
@@ -0,0 +1,308 @@
+#ifndef COBALT_COM_ALLOCATOR_HPP_INCLUDED
+#define COBALT_COM_ALLOCATOR_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     heap_allocation
+//     pool_allocation
+//     object_arena
+//     arena_allocation
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace cobalt {
+namespace com {
+
+// Allocation policies decide where heap object instances live. Object class selects
+// policy with DECLARE_ALLOCATION family of macros, and instance wrappers (`object`,
+// `aggregated_object`, `tear_off_object` etc.) route their `new` and `delete` to it.
+// Policy provides `allocate<T>()` and `deallocate<T>(p)` static functions.
+
+/// Allocates every instance with global new.
+struct heap_allocation {
+	template <typename T>
+	static void* allocate() noexcept {
+		static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned objects are not supported");
+		return ::operator new(sizeof(T), std::nothrow);
+	}
+
+	template <typename T>
+	static void deallocate(void* p) noexcept {
+		::operator delete(p);
+	}
+};
+
+namespace detail {
+
+/// Free list of fixed size blocks
+///
+/// Blocks are carved from chunks, which are never returned to the system, so
+/// instances stay valid even if they are released after pool is gone. Every
+/// thread keeps its own free list and exchanges batches of blocks with the
+/// shared list only when its own list runs empty or grows too large.
+/// Blocks may be released on any thread.
+template <size_t Size, size_t Align>
+class fixed_pool {
+	struct block {
+		block* next;
+	};
+
+	static constexpr size_t kAlign = std::max(Align, alignof(block));
+	static constexpr size_t kBlockSize = (std::max(Size, sizeof(block)) + kAlign - 1) & ~(kAlign - 1);
+	static constexpr size_t kBatchSize = std::max<size_t>(16, 16384 / kBlockSize);
+
+public:
+	static fixed_pool& instance() noexcept {
+		// Intentionally leaked, thread caches may spill into it after static destruction
+		static fixed_pool* pool = new fixed_pool;
+		return *pool;
+	}
+
+	void* allocate() noexcept {
+		auto&& cache = local();
+		if (!cache.head && !refill(cache))
+			return nullptr;
+
+		auto p = cache.head;
+		cache.head = p->next;
+		--cache.count;
+		return p;
+	}
+
+	void deallocate(void* p) noexcept {
+		BOOST_ASSERT(p);
+		auto&& cache = local();
+		auto b = static_cast<block*>(p);
+		b->next = cache.head;
+		cache.head = b;
+		if (++cache.count >= 2 * kBatchSize)
+			spill(cache, kBatchSize);
+	}
+
+	/// Number of blocks carved so far
+	size_t capacity() const noexcept { return _capacity.load(std::memory_order_relaxed); }
+
+private:
+	struct thread_cache {
+		~thread_cache() { instance().spill(*this, count); }
+
+		block* head = nullptr;
+		size_t count = 0;
+	};
+
+	fixed_pool() noexcept = default;
+
+	static thread_cache& local() noexcept {
+		static thread_local thread_cache cache;
+		return cache;
+	}
+
+	bool refill(thread_cache& cache) noexcept {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_head) {
+				// Take whole batch if there is one, it is put back the same way
+				auto last = _head;
+				size_t count = 1;
+				for (; count < kBatchSize && last->next; ++count)
+					last = last->next;
+				cache.head = _head;
+				cache.count = count;
+				_head = last->next;
+				last->next = nullptr;
+				return true;
+			}
+		}
+
+		auto chunk = static_cast<char*>(::operator new(kBlockSize * kBatchSize, std::align_val_t(kAlign), std::nothrow));
+		if (!chunk)
+			return false;
+
+		for (size_t i = kBatchSize; i--; ) {
+			auto b = reinterpret_cast<block*>(chunk + i * kBlockSize);
+			b->next = cache.head;
+			cache.head = b;
+		}
+		cache.count = kBatchSize;
+		_capacity.fetch_add(kBatchSize, std::memory_order_relaxed);
+		return true;
+	}
+
+	void spill(thread_cache& cache, size_t count) noexcept {
+		if (!count)
+			return;
+
+		auto first = cache.head;
+		auto last = first;
+		for (size_t i = 1; i < count; ++i)
+			last = last->next;
+		cache.head = last->next;
+		cache.count -= count;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		last->next = _head;
+		_head = first;
+	}
+
+	std::mutex _mutex;
+	block* _head = nullptr;
+	std::atomic<size_t> _capacity = 0;
+};
+
+} // namespace detail
+
+/// Allocates instances from fixed size block pools
+///
+/// Classes of the same size and alignment share a pool.
+struct pool_allocation {
+	template <typename T>
+	static void* allocate() noexcept { return pool<T>().allocate(); }
+
+	template <typename T>
+	static void deallocate(void* p) noexcept { pool<T>().deallocate(p); }
+
+	template <typename T>
+	static detail::fixed_pool<sizeof(T), alignof(T)>& pool() noexcept {
+		return detail::fixed_pool<sizeof(T), alignof(T)>::instance();
+	}
+};
+
+/// Scope for temporary objects
+///
+/// While arena is alive, classes with `arena_allocation` policy created on the
+/// same thread are placed into it. Releasing such object doesn't free memory,
+/// arena frees all of it at once when the scope ends. Objects must not outlive
+/// the arena. Arenas can be nested, the innermost one is used.
+class object_arena {
+public:
+	explicit object_arena(size_t chunk_size = 16384) noexcept
+		: _chunk_size(chunk_size)
+		, _previous(top())
+	{
+		top() = this;
+	}
+
+	~object_arena() {
+		BOOST_ASSERT(top() == this);
+		BOOST_ASSERT(!_live.load(std::memory_order_relaxed));
+		top() = _previous;
+		while (_chunks) {
+			auto next = _chunks->next;
+			::operator delete(_chunks);
+			_chunks = next;
+		}
+	}
+
+	object_arena(const object_arena&) = delete;
+	object_arena& operator=(const object_arena&) = delete;
+
+	/// Innermost arena of the current thread
+	static object_arena* current() noexcept { return top(); }
+
+	void* allocate(size_t size, size_t align) noexcept {
+		BOOST_ASSERT(align <= alignof(std::max_align_t));
+		auto p = (_ptr + align - 1) & ~(align - 1);
+		if (p + size > _end) {
+			auto chunk_size = std::max(_chunk_size, size + sizeof(chunk));
+			auto c = static_cast<chunk*>(::operator new(chunk_size, std::nothrow));
+			if (!c)
+				return nullptr;
+			c->next = _chunks;
+			_chunks = c;
+			_ptr = reinterpret_cast<size_t>(c + 1);
+			_end = reinterpret_cast<size_t>(c) + chunk_size;
+			p = (_ptr + align - 1) & ~(align - 1);
+		}
+		_ptr = p + size;
+		_live.fetch_add(1, std::memory_order_relaxed);
+		return reinterpret_cast<void*>(p);
+	}
+
+	void deallocate(void* p) noexcept {
+		BOOST_ASSERT(_live.load(std::memory_order_relaxed));
+		_live.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	/// Number of objects not released yet
+	size_t live() const noexcept { return _live.load(std::memory_order_relaxed); }
+
+private:
+	struct alignas(std::max_align_t) chunk {
+		chunk* next;
+	};
+
+	static object_arena*& top() noexcept {
+		static thread_local object_arena* top = nullptr;
+		return top;
+	}
+
+	size_t _chunk_size;
+	object_arena* _previous;
+	chunk* _chunks = nullptr;
+	size_t _ptr = 0;
+	size_t _end = 0;
+	std::atomic<size_t> _live = 0;
+};
+
+/// Allocates instances from current `object_arena` or using `Fallback` policy outside of arena scope.
+template <typename Fallback = heap_allocation>
+struct arena_allocation {
+	template <typename T>
+	static void* allocate() noexcept {
+		using block_type = block<T>;
+		void* p = nullptr;
+		auto arena = object_arena::current();
+		if (arena)
+			p = arena->allocate(sizeof(block_type), alignof(block_type));
+		else
+			p = Fallback::template allocate<block_type>();
+		if (!p)
+			return nullptr;
+		auto b = static_cast<block_type*>(p);
+		b->arena = arena;
+		return b->storage;
+	}
+
+	template <typename T>
+	static void deallocate(void* p) noexcept {
+		using block_type = block<T>;
+		auto b = reinterpret_cast<block_type*>(static_cast<char*>(p) - offsetof(block_type, storage));
+		if (b->arena)
+			b->arena->deallocate(b);
+		else
+			Fallback::template deallocate<block_type>(b);
+	}
+
+private:
+	// Instance prefixed with arena it belongs to
+	template <typename T>
+	struct block {
+		object_arena* arena;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+};
+
+#define DECLARE_ALLOCATION(allocation) \
+public: \
+	using allocation_type = allocation;
+
+#define DECLARE_HEAP_ALLOCATION() \
+	DECLARE_ALLOCATION(::cobalt::com::heap_allocation)
+
+#define DECLARE_POOL_ALLOCATION() \
+	DECLARE_ALLOCATION(::cobalt::com::pool_allocation)
+
+#define DECLARE_ARENA_ALLOCATION() \
+	DECLARE_ALLOCATION(::cobalt::com::arena_allocation<::cobalt::com::pool_allocation>)
+
+} // namespace com
+} // namespace cobalt
+
+#endif // COBALT_COM_ALLOCATOR_HPP_INCLUDED
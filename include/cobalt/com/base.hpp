@@ -4,6 +4,12 @@
 #pragma once
 
 // Classes in this file:
+//     cast_table
+//     single_thread_model
+//     multi_thread_model
+//     biased_thread_model
+//     object_root_base
+//     object_base_ex
 //     object_base
 //     tear_off_object_base
 //     stack_object
@@ -17,31 +23,42 @@
 //     module_base
 //     module
 
+#include <cobalt/com/allocator.hpp>
 #include <cobalt/com/core.hpp>
 #include <cobalt/com/utility.hpp>
 
 #include <boost/assert.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace cobalt {
 namespace com {
 namespace detail {
 
+// Any suitably aligned non-null address works, null pointer would stay null after conversion to base
+constexpr uintptr_t kFakeObjectAddress = 0x1000;
+
 template <typename Base, typename Derived, typename = std::enable_if_t<std::is_base_of_v<Base, Derived>>>
-constexpr size_t offset_from_class() noexcept {
-	constexpr Derived* const derived = nullptr;
+inline size_t offset_from_class() noexcept {
+	const auto derived = reinterpret_cast<Derived*>(kFakeObjectAddress);
 	return
-		static_cast<const char*>(static_cast<const void*>(derived)) -
-		static_cast<const char*>(static_cast<const void*>(static_cast<Base*>(derived)));
+		static_cast<const char*>(static_cast<const void*>(static_cast<Base*>(derived))) -
+		static_cast<const char*>(static_cast<const void*>(derived));
 }
 
 template <typename Base, typename Base2, typename Derived, typename = std::enable_if_t<std::is_base_of_v<Base, Base2> && std::is_base_of_v<Base2, Derived>>>
-constexpr size_t offset_from_class() noexcept {
-	constexpr Derived* const derived = nullptr;
+inline size_t offset_from_class() noexcept {
+	const auto derived = reinterpret_cast<Derived*>(kFakeObjectAddress);
 	return
-		static_cast<const char*>(static_cast<const void*>(derived)) -
-		static_cast<const char*>(static_cast<const void*>(static_cast<Base*>(static_cast<Base2*>(derived))));
+		static_cast<const char*>(static_cast<const void*>(static_cast<Base*>(static_cast<Base2*>(derived)))) -
+		static_cast<const char*>(static_cast<const void*>(derived));
 }
 
 template <typename Parent, typename Member>
@@ -65,6 +82,77 @@ struct cast_entry {
 	cast_fn func;
 };
 
+/// Lookup table built once from cast map entries.
+///
+/// Simple entries which can't be shadowed by preceding entries go to hash table
+/// keyed by uid address, the rest of the entries are kept in the original order.
+class cast_table {
+public:
+	explicit cast_table(const cast_entry* entries) : _entries(entries) {
+		BOOST_ASSERT(entries);
+		
+		size_t count = 0;
+		while (entries[count].func)
+			++count;
+		
+		while (_mask + 1 < count * 2)
+			_mask = (_mask << 1) | 1;
+		_slots = std::make_unique<const cast_entry*[]>(_mask + 1);
+		
+		bool shadowed = false;
+		for (auto entry = entries; entry->func; ++entry) {
+			if (entry->func == kSimpleCastEntry && !shadowed && !find(*entry->iid) && !has_thunk(*entry->iid)) {
+				for (size_t i = slot_index(*entry->iid); ; ++i) {
+					if (!_slots[i & _mask]) {
+						_slots[i & _mask] = entry;
+						break;
+					}
+				}
+				continue;
+			}
+			// Blind entries may handle any interface, so everything after them must go in order
+			shadowed = shadowed || !entry->iid;
+			_thunks.push_back(entry);
+		}
+		_thunks.push_back(&entries[count]);
+	}
+	
+	cast_table(const cast_table&) = delete;
+	cast_table& operator=(const cast_table&) = delete;
+	
+	const cast_entry* entries() const noexcept { return _entries; }
+	
+	/// @return Simple entry for iid or nullptr if iid must be resolved with `thunks()`
+	const cast_entry* find(const uid& iid) const noexcept {
+		for (size_t i = slot_index(iid); ; ++i) {
+			auto entry = _slots[i & _mask];
+			if (!entry || entry->iid == &iid)
+				return entry;
+		}
+	}
+	
+	/// Entries which are not in hash table, terminated with empty entry
+	const cast_entry* const* thunks() const noexcept { return _thunks.data(); }
+	
+private:
+	size_t slot_index(const uid& iid) const noexcept {
+		return static_cast<size_t>((reinterpret_cast<uintptr_t>(&iid) >> 3) * 0x9e3779b97f4a7c15ull >> 32);
+	}
+	
+	bool has_thunk(const uid& iid) const noexcept {
+		for (auto thunk : _thunks) {
+			if (thunk->iid == &iid)
+				return true;
+		}
+		return false;
+	}
+	
+	const cast_entry* _entries = nullptr;
+	size_t _mask = 7;
+	std::unique_ptr<const cast_entry*[]> _slots;
+	std::vector<const cast_entry*> _thunks;
+};
+
 struct creator_data {
 	create_fn func;
 };
@@ -85,19 +173,283 @@ struct cache_thunk {
 };
 
 struct chain_data {
-	size_t offset;
-	const cast_entry* (*get_cast_entries)() noexcept;
+	size_t (*offset)() noexcept;
+	const cast_table& (*get_cast_table)() noexcept;
 };
 
 template <typename Base, typename Derived>
 struct chain_thunk {
-	inline static const chain_data data{detail::offset_from_class<Base, Derived>(), Base::get_cast_entries};
+	static size_t offset() noexcept { return detail::offset_from_class<Base, Derived>(); }
+	
+	inline static constexpr chain_data data{offset, Base::get_cast_table};
+};
+
+/// Thread model of objects used by a single thread.
+struct single_thread_model {
+	using counter_type = int_fast32_t;
+	
+	static void initialize(counter_type& counter) noexcept { counter = 0; }
+	static int_fast32_t value(const counter_type& counter) noexcept { return counter; }
+	
+	static uint32_t increment(counter_type& counter) noexcept { return ++counter; }
+	static uint32_t decrement(counter_type& counter, any*) noexcept { return --counter; }
 };
 
-/// Base class for regular objects.
-class object_base {
+/// Thread model of objects shared between threads.
+struct multi_thread_model {
+	using counter_type = std::atomic<int_fast32_t>;
+	
+	static void initialize(counter_type& counter) noexcept { counter.store(0, std::memory_order_relaxed); }
+	static int_fast32_t value(const counter_type& counter) noexcept { return counter.load(std::memory_order_relaxed); }
+	
+	static uint32_t increment(counter_type& counter) noexcept {
+		return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+	
+	static uint32_t decrement(counter_type& counter, any*) noexcept {
+		auto count = counter.fetch_sub(1, std::memory_order_release) - 1;
+		if (!count)
+			std::atomic_thread_fence(std::memory_order_acquire);
+		return static_cast<uint32_t>(count);
+	}
+};
+
+/// Thread model of objects mostly used by the thread which created them.
+///
+/// Owner thread counts its references without atomic read-modify-write, other
+/// threads use signed atomic counter. Once owner releases all its references
+/// the counters are merged and the last release from any thread destroys the
+/// object. Reference acquired by owner and released by another thread, which
+/// would make shared counter negative, is queued and released by owner thread
+/// in `release_queued()`, so owner should call it regularly. Queue is also
+/// released when owner thread exits, references released by other threads later
+/// merge the counters themselves.
+struct biased_thread_model {
+	class release_queue;
+	
+	struct counter_type {
+		// References of the owner thread, only written by owner
+		std::atomic<int32_t> biased;
+		// References of other threads shifted left by one, lowest bit is set when merged
+		std::atomic<int32_t> shared;
+		// Number of references queued for release by owner
+		std::atomic<int32_t> queued;
+		release_queue* owner;
+		// Links of release queue, written with queue locked
+		any* self;
+		counter_type* next;
+	};
+	
+	static void initialize(counter_type& counter) noexcept {
+		counter.owner = release_queue::current();
+		counter.biased.store(0, std::memory_order_relaxed);
+		// Objects created without owner queue are shared from the start
+		counter.shared.store(counter.owner ? 0 : kMerged, std::memory_order_relaxed);
+		counter.queued.store(0, std::memory_order_relaxed);
+		counter.self = nullptr;
+		counter.next = nullptr;
+	}
+	
+	static int_fast32_t value(const counter_type& counter) noexcept {
+		return counter.biased.load(std::memory_order_relaxed) + (counter.shared.load(std::memory_order_relaxed) >> 1);
+	}
+	
+	static uint32_t increment(counter_type& counter) noexcept {
+		if (owned(counter)) {
+			auto biased = counter.biased.load(std::memory_order_relaxed) + 1;
+			counter.biased.store(biased, std::memory_order_relaxed);
+			return biased;
+		}
+		return (counter.shared.fetch_add(2, std::memory_order_relaxed) >> 1) + 1;
+	}
+	
+	/// `self` is the object released by owner if reference has to be queued
+	static uint32_t decrement(counter_type& counter, any* self) noexcept {
+		if (owned(counter)) {
+			auto biased = counter.biased.load(std::memory_order_relaxed) - 1;
+			BOOST_ASSERT(biased >= 0);
+			counter.biased.store(biased, std::memory_order_relaxed);
+			if (biased)
+				return biased;
+			// Nobody else can hold a reference, counters stay unmerged for reuse during initialization
+			if (!counter.shared.load(std::memory_order_acquire))
+				return 0;
+			// Merge counters, object is destroyed if other threads have released their references meanwhile
+			return counter.shared.fetch_or(kMerged, std::memory_order_acq_rel) >> 1;
+		}
+		
+		auto shared = counter.shared.load(std::memory_order_relaxed);
+		for (;;) {
+			if (shared & kMerged) {
+				auto count = (counter.shared.fetch_sub(2, std::memory_order_acq_rel) >> 1) - 1;
+				BOOST_ASSERT(count >= 0);
+				return count;
+			}
+			if (shared < 2) {
+				// Reference counted by owner, which still holds it until the queued release
+				return counter.owner->push(counter, self);
+			}
+			// Owner holds at least one reference
+			if (counter.shared.compare_exchange_weak(shared, shared - 2, std::memory_order_release, std::memory_order_relaxed))
+				return shared >> 1;
+		}
+	}
+	
+	/// Releases references queued for calling thread by other threads
+	static void release_queued() noexcept {
+		if (auto queue = local().queue)
+			queue->drain();
+	}
+	
+	/// Queue of releases passed to owner thread
+	///
+	/// Queues are recycled by new threads once their owners exit, objects may still
+	/// point to them. They are intentionally leaked for the same reason.
+	class release_queue {
+	public:
+		/// Queue of calling thread, null if thread is exiting
+		static release_queue* current() noexcept {
+			auto&& state = local();
+			if (!state.queue && !state.exited) {
+				static thread_local exit_guard guard;
+				state.queue = acquire();
+			}
+			return state.queue;
+		}
+		
+		/// Queues release of reference counted by owner
+		///
+		/// If owner has exited, counters are merged and released here instead.
+		/// @return Number of references left
+		uint32_t push(counter_type& counter, any* self) noexcept {
+			// Object is already in queue unless this is the first queued reference
+			if (counter.queued.fetch_add(1, std::memory_order_acq_rel))
+				return 1;
+			
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (!_closed) {
+				counter.self = self;
+				counter.next = _head;
+				_head = &counter;
+				return 1;
+			}
+			
+			// Owner is gone and doesn't write its counter anymore
+			auto queued = counter.queued.exchange(0, std::memory_order_acq_rel);
+			if (!(counter.shared.load(std::memory_order_relaxed) & kMerged)) {
+				auto biased = counter.biased.load(std::memory_order_relaxed);
+				counter.biased.store(0, std::memory_order_relaxed);
+				counter.shared.fetch_add(biased * 2 + kMerged, std::memory_order_acq_rel);
+			}
+			auto count = (counter.shared.fetch_sub(queued * 2, std::memory_order_acq_rel) >> 1) - queued;
+			BOOST_ASSERT(count >= 0);
+			return count;
+		}
+		
+		/// Releases queued references, must be called by owner
+		void drain() noexcept {
+			for (;;) {
+				counter_type* head;
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					head = std::exchange(_head, nullptr);
+				}
+				if (!head)
+					return;
+				
+				while (head) {
+					// Links are read before releases, which may destroy object or queue it again
+					auto next = head->next;
+					auto self = head->self;
+					auto queued = head->queued.exchange(0, std::memory_order_acq_rel);
+					while (queued--)
+						intrusive_ptr_release(self);
+					head = next;
+				}
+			}
+		}
+		
+	private:
+		struct exit_guard {
+			~exit_guard() {
+				auto&& state = local();
+				auto queue = state.queue;
+				state.exited = true;
+				if (!queue)
+					return;
+				do
+					queue->drain();
+				while (!queue->close());
+				state.queue = nullptr;
+				
+				auto&& f = free_list();
+				std::lock_guard<std::mutex> lock(f.mutex);
+				queue->_next_free = f.head;
+				f.head = queue;
+			}
+		};
+		
+		struct queue_list {
+			std::mutex mutex;
+			release_queue* head = nullptr;
+		};
+		
+		static queue_list& free_list() noexcept {
+			static queue_list* list = new queue_list;
+			return *list;
+		}
+		
+		static release_queue* acquire() noexcept {
+			auto&& f = free_list();
+			{
+				std::lock_guard<std::mutex> lock(f.mutex);
+				if (auto queue = f.head) {
+					f.head = queue->_next_free;
+					std::lock_guard<std::mutex> queue_lock(queue->_mutex);
+					queue->_closed = false;
+					return queue;
+				}
+			}
+			return new(std::nothrow) release_queue;
+		}
+		
+		bool close() noexcept {
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_head)
+				return false;
+			_closed = true;
+			return true;
+		}
+		
+		std::mutex _mutex;
+		counter_type* _head = nullptr;
+		bool _closed = false;
+		release_queue* _next_free = nullptr;
+	};
+	
+private:
+	static constexpr int32_t kMerged = 1;
+	
+	struct thread_state {
+		release_queue* queue = nullptr;
+		bool exited = false;
+	};
+	
+	static thread_state& local() noexcept {
+		static thread_local thread_state state;
+		return state;
+	}
+	
+	static bool owned(const counter_type& counter) noexcept {
+		// Merged flag is only set by owner thread, so relaxed load is enough here
+		return counter.owner == local().queue && !(counter.shared.load(std::memory_order_relaxed) & kMerged);
+	}
+};
+
+/// Common part of all objects, cast map helpers.
+class object_root_base {
 public:
-	object_base() noexcept = default;
+	using allocation_type = heap_allocation;
 	
 	static void class_initialize() noexcept {}
 	static void class_shutdown() noexcept {}
@@ -106,23 +458,11 @@ public:
 	void shutdown() noexcept {}
 	
 protected:
-	void internal_initialize_retain() noexcept {}
-	void internal_initialize_release() noexcept { BOOST_ASSERT(_ref_count == 0); }
-	
-private:
-	template <typename T> friend struct creator;
-	template <typename T> friend struct internal_creator;
-	
-	void set_param(void* pv) noexcept {}
-
-protected:
-	uint32_t internal_retain() noexcept { BOOST_ASSERT(_ref_count != -1); return ++_ref_count; }
-	uint32_t internal_release() noexcept { BOOST_ASSERT(_ref_count != 0); return --_ref_count; }
-	
-	static ref<any> s_internal_cast(void* pv, const cast_entry* entries, const uid& iid, std::error_code& ec) noexcept {
+	static ref<any> s_internal_cast(void* pv, const cast_table& table, const uid& iid, std::error_code& ec) noexcept {
+		auto entries = table.entries();
+		
 		BOOST_ASSERT(pv);
-		BOOST_ASSERT(entries);
-		if (!pv || !entries) {
+		if (!pv) {
 			ec = make_error_code(std::errc::invalid_argument);
 			return nullptr;
 		}
@@ -138,7 +478,13 @@ protected:
 			return reinterpret_cast<any*>(reinterpret_cast<size_t>(pv) + entries[0].data);
 		}
 		
-		for (auto entry = entries; entry->func; ++entry) {
+		if (auto entry = table.find(iid)) {
+			ec = make_error_code(errc::success);
+			return reinterpret_cast<any*>(reinterpret_cast<size_t>(pv) + entry->data);
+		}
+		
+		for (auto thunk = table.thunks(); (*thunk)->func; ++thunk) {
+			auto entry = *thunk;
 			bool blind = !entry->iid;
 			if (blind || *entry->iid == iid) {
 				if (entry->func == kSimpleCastEntry) {
@@ -202,22 +548,47 @@ protected:
 	
 	static ref<any> s_chain(void* pv, const uid& iid, size_t data, std::error_code& ec) noexcept {
 		auto cd = reinterpret_cast<chain_data*>(data);
-		auto p = reinterpret_cast<void*>((reinterpret_cast<size_t>(pv) + cd->offset));
-		return s_internal_cast(p, cd->get_cast_entries(), iid, ec);
+		auto p = reinterpret_cast<void*>((reinterpret_cast<size_t>(pv) + cd->offset()));
+		return s_internal_cast(p, cd->get_cast_table(), iid, ec);
 	}
 	
+};
+
+/// Base class for regular objects with reference counting of the thread model.
+template <typename ThreadModel>
+class object_base_ex : public object_root_base {
+public:
+	using thread_model = ThreadModel;
+	
+	object_base_ex() noexcept { thread_model::initialize(_ref_count); }
+	
+protected:
+	void internal_initialize_retain() noexcept {}
+	void internal_initialize_release() noexcept { BOOST_ASSERT(thread_model::value(_ref_count) == 0); }
+	
+private:
+	template <typename T> friend struct creator;
+	template <typename T> friend struct internal_creator;
+	
+	void set_param(void* pv) noexcept {}
+
 protected:
+	uint32_t internal_retain() noexcept { BOOST_ASSERT(thread_model::value(_ref_count) != -1); return thread_model::increment(_ref_count); }
+	uint32_t internal_release(any* self) noexcept { BOOST_ASSERT(thread_model::value(_ref_count) != 0); return thread_model::decrement(_ref_count, self); }
+	
 	union {
 		// Object reference counter if regular object
-		int_fast32_t _ref_count;
+		typename thread_model::counter_type _ref_count;
 		// Outer owning object if aggregated object
-		any* _outer = nullptr;
+		any* _outer;
 	};
 };
 
+using object_base = object_base_ex<single_thread_model>;
+
 /// Base class for tear-off implementations.
-template <typename Owner>
-class tear_off_object_base : public object_base {
+template <typename Owner, typename ThreadModel = single_thread_model>
+class tear_off_object_base : public object_base_ex<ThreadModel> {
 public:
 	using owner_type = Owner;
 	
@@ -232,7 +603,7 @@ private:
 #define DECLARE_PROTECT_INITIALIZE() \
 public: \
 	void internal_initialize_retain() noexcept { this->internal_retain(); } \
-	void internal_initialize_release() noexcept { this->internal_release(); }
+	void internal_initialize_release() noexcept { this->internal_release(this->identity()); }
 	
 #define DECLARE_GET_OUTER_OBJECT() \
 public: \
@@ -247,7 +618,7 @@ public: \
 		return reinterpret_cast<::cobalt::com::any*>(reinterpret_cast<size_t>(this) + get_cast_entries()->data); \
 	} \
 	::cobalt::com::ref<::cobalt::com::any> internal_cast(const ::cobalt::uid& iid, std::error_code& ec) noexcept { \
-		return s_internal_cast(this, get_cast_entries(), iid, ec); \
+		return ::cobalt::com::object_root_base::s_internal_cast(this, get_cast_table(), iid, ec); \
 	} \
 	static const ::cobalt::com::cast_entry* get_cast_entries() noexcept { \
 		using namespace ::cobalt::com; \
@@ -267,16 +638,16 @@ public: \
 			{ nullptr, data, func }
 
 #define CAST_ENTRY(x) \
-			{ &UIDOF(x), detail::offset_from_class<x, self>(), kSimpleCastEntry },
+			{ &UIDOF(x), ::cobalt::com::detail::offset_from_class<x, self>(), kSimpleCastEntry },
 	
 #define CAST_ENTRY_IID(iid, x) \
-			{ &iid, detail::offset_from_class<x, self>(), kSimpleCastEntry },
+			{ &iid, ::cobalt::com::detail::offset_from_class<x, self>(), kSimpleCastEntry },
 
 #define CAST_ENTRY2(x, x2) \
-			{ &UIDOF(x), detail::offset_from_class<x, x2, self>(), kSimpleCastEntry },
+			{ &UIDOF(x), ::cobalt::com::detail::offset_from_class<x, x2, self>(), kSimpleCastEntry },
 
 #define CAST_ENTRY2_IID(iid, x, x2) \
-			{ &iid, detail::offset_from_class<x, x2, self>(), kSimpleCastEntry },
+			{ &iid, ::cobalt::com::detail::offset_from_class<x, x2, self>(), kSimpleCastEntry },
 	
 #define CAST_ENTRY_TEAR_OFF(iid, x) \
 			{ &iid, reinterpret_cast<size_t>(&creator_thunk<internal_creator<tear_off_object<x>>>::data), s_create },
@@ -285,10 +656,10 @@ public: \
 			{ &iid, reinterpret_cast<size_t>(&cache_thunk<creator<cached_tear_off_object<x>>, offsetof(self, pid)>::data), s_cache },
 	
 #define CAST_ENTRY_AGGREGATE(iid, pid) \
-			{ &iid, detail::offset_from_member_ptr<self>(&self::pid), s_delegate },
+			{ &iid, ::cobalt::com::detail::offset_from_member_ptr<self>(&self::pid), s_delegate },
 	
 #define CAST_ENTRY_AGGREGATE_BLIND(pid) \
-			{ nullptr, detail::offset_from_member_ptr<self>(&self::pid), s_delegate },
+			{ nullptr, ::cobalt::com::detail::offset_from_member_ptr<self>(&self::pid), s_delegate },
 	
 #define CAST_ENTRY_AUTOAGGREGATE(iid, pid, clsid) \
 			{ &iid, reinterpret_cast<size_t>(&cache_thunk<aggregate_creator<self, clsid>, offsetof(self, pid)>::data), s_cache },
@@ -310,6 +681,10 @@ public: \
 		}; \
 		return entries; \
 	} \
+	static const ::cobalt::com::cast_table& get_cast_table() noexcept { \
+		static const ::cobalt::com::cast_table table(get_cast_entries()); \
+		return table; \
+	} \
 	virtual uint32_t retain() noexcept override = 0; \
 	virtual uint32_t release() noexcept override = 0; \
 	virtual ::cobalt::com::ref<::cobalt::com::any> cast(const uid& iid, std::error_code& ec) noexcept override = 0;
@@ -324,7 +699,7 @@ public:
 	}
 	~stack_object() {
 		this->shutdown();
-		BOOST_ASSERT(this->_ref_count == 0);
+		BOOST_ASSERT(Base::thread_model::value(this->_ref_count) == 0);
 	}
 	
 	const std::error_code& error() const noexcept { return _ec; }
@@ -340,7 +715,7 @@ public:
 #ifdef BOOST_ASSERT_IS_VOID
 		return 0;
 #else
-		return this->internal_release();
+		return this->internal_release(this->identity());
 #endif
 	}
 	
@@ -358,9 +733,15 @@ public:
 	explicit object(void* pv) noexcept {}
 	~object() { this->shutdown(); }
 	
+	using allocation_type = typename Base::allocation_type;
+	
+	static void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocation_type::template allocate<object>(); }
+	static void operator delete(void* p) noexcept { allocation_type::template deallocate<object>(p); }
+	static void operator delete(void* p, const std::nothrow_t&) noexcept { allocation_type::template deallocate<object>(p); }
+	
 	virtual uint32_t retain() noexcept override { return this->internal_retain(); }
 	virtual uint32_t release() noexcept override {
-		auto ref_count = this->internal_release();
+		auto ref_count = this->internal_release(this->identity());
 		if (!ref_count)
 			delete this;
 		return ref_count;
@@ -415,17 +796,23 @@ private:
 
 /// Object instance on heap aggregated inside another object.
 template <typename Contained>
-class aggregated_object final : public any, public object_base {
+class aggregated_object final : public any, public object_base_ex<typename Contained::thread_model> {
 public:
 	explicit aggregated_object(void* pv) noexcept : _contained(pv) {}
 	aggregated_object() { this->shutdown(); }
 	
-	void initialize(std::error_code& ec) noexcept { object_base::initialize(ec); if (!ec) _contained.initialize(ec); }
-	void shutdown() noexcept { object_base::shutdown(); _contained.shutdown(); }
+	void initialize(std::error_code& ec) noexcept { object_root_base::initialize(ec); if (!ec) _contained.initialize(ec); }
+	void shutdown() noexcept { object_root_base::shutdown(); _contained.shutdown(); }
+	
+	using allocation_type = typename Contained::allocation_type;
+	
+	static void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocation_type::template allocate<aggregated_object>(); }
+	static void operator delete(void* p) noexcept { allocation_type::template deallocate<aggregated_object>(p); }
+	static void operator delete(void* p, const std::nothrow_t&) noexcept { allocation_type::template deallocate<aggregated_object>(p); }
 	
 	virtual uint32_t retain() noexcept override { return this->internal_retain(); }
 	virtual uint32_t release() noexcept override {
-		auto ref_count = this->internal_release();
+		auto ref_count = this->internal_release(this);
 		if (!ref_count)
 			delete this;
 		return ref_count;
@@ -467,17 +854,23 @@ private:
 
 /// Object instance on heap, either aggregated or not.
 template <typename Contained>
-class maybe_aggregated_object final : public any, public object_base {
+class maybe_aggregated_object final : public any, public object_base_ex<typename Contained::thread_model> {
 public:
 	explicit maybe_aggregated_object(void* pv) noexcept : _contained(pv ? pv : this) {}
 	maybe_aggregated_object() { this->shutdown(); }
 	
-	void initialize(std::error_code& ec) noexcept { object_base::initialize(ec); if (!ec) _contained.initialize(ec); }
-	void shutdown() noexcept { object_base::shutdown(); _contained.shutdown(); }
+	void initialize(std::error_code& ec) noexcept { object_root_base::initialize(ec); if (!ec) _contained.initialize(ec); }
+	void shutdown() noexcept { object_root_base::shutdown(); _contained.shutdown(); }
+	
+	using allocation_type = typename Contained::allocation_type;
+	
+	static void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocation_type::template allocate<maybe_aggregated_object>(); }
+	static void operator delete(void* p) noexcept { allocation_type::template deallocate<maybe_aggregated_object>(p); }
+	static void operator delete(void* p, const std::nothrow_t&) noexcept { allocation_type::template deallocate<maybe_aggregated_object>(p); }
 	
 	virtual uint32_t retain() noexcept override { return this->internal_retain(); }
 	virtual uint32_t release() noexcept override {
-		auto ref_count = this->internal_release();
+		auto ref_count = this->internal_release(this);
 		if (!ref_count)
 			delete this;
 		return ref_count;
@@ -527,9 +920,15 @@ public:
 		this->owner()->release();
 	}
 	
+	using allocation_type = typename Base::allocation_type;
+	
+	static void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocation_type::template allocate<tear_off_object>(); }
+	static void operator delete(void* p) noexcept { allocation_type::template deallocate<tear_off_object>(p); }
+	static void operator delete(void* p, const std::nothrow_t&) noexcept { allocation_type::template deallocate<tear_off_object>(p); }
+	
 	virtual uint32_t retain() noexcept override { return this->internal_retain(); }
 	virtual uint32_t release() noexcept override {
-		auto ref_count = this->internal_release();
+		auto ref_count = this->internal_release(this->identity());
 		if (!ref_count)
 			delete this;
 		return ref_count;
@@ -539,7 +938,7 @@ public:
 
 /// Object instance on heap  as of cached tear-off implementation.
 template <typename Contained>
-class cached_tear_off_object final : public any, public object_base {
+class cached_tear_off_object final : public any, public object_base_ex<typename Contained::thread_model> {
 public:
 	explicit cached_tear_off_object(void* pv) noexcept
 		: _contained(static_cast<typename Contained::owner_type*>(pv)->get_outer_object())
@@ -550,12 +949,18 @@ public:
 	}
 	~cached_tear_off_object() { this->shutdown(); }
 	
-	void initialize(std::error_code& ec) noexcept { object_base::initialize(ec); if (!ec) _contained.initialize(ec); }
-	void shutdown() noexcept { object_base::shutdown(); _contained.shutdown(); }
+	void initialize(std::error_code& ec) noexcept { object_root_base::initialize(ec); if (!ec) _contained.initialize(ec); }
+	void shutdown() noexcept { object_root_base::shutdown(); _contained.shutdown(); }
+	
+	using allocation_type = typename Contained::allocation_type;
+	
+	static void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocation_type::template allocate<cached_tear_off_object>(); }
+	static void operator delete(void* p) noexcept { allocation_type::template deallocate<cached_tear_off_object>(p); }
+	static void operator delete(void* p, const std::nothrow_t&) noexcept { allocation_type::template deallocate<cached_tear_off_object>(p); }
 	
 	virtual uint32_t retain() noexcept override { return this->internal_retain(); }
 	virtual uint32_t release() noexcept override {
-		auto ref_count = this->internal_release();
+		auto ref_count = this->internal_release(this);
 		if (!ref_count)
 			delete this;
 		return ref_count;
@@ -668,7 +1073,7 @@ public: \
 public: \
 	using creator_type = ::cobalt::com::creator<::cobalt::com::maybe_aggregated_object<x>>;
 
-class class_factory_impl : public object_base, public class_factory {
+class class_factory_impl : public object_base_ex<multi_thread_model>, public class_factory {
 public:
 	BEGIN_CAST_MAP(class_factory_impl)
 		CAST_ENTRY(class_factory)
@@ -695,7 +1100,7 @@ private:
 };
 
 template <typename T>
-class class_factory_singleton_impl : public object_base, public class_factory {
+class class_factory_singleton_impl : public object_base_ex<multi_thread_model>, public class_factory {
 public:
 	BEGIN_CAST_MAP(class_factory_singleton_impl)
 		CAST_ENTRY(class_factory)
@@ -760,7 +1165,7 @@ struct object_entry {
 	const uid* clsid;
 	create_fn get_class_object;
 	create_fn create_instance;
-	mutable class_factory* factory;
+	mutable std::atomic<class_factory*> factory;
 	void (*class_initialize)();
 	void (*class_shutdown)();
 };
@@ -792,10 +1197,15 @@ public: \
 		return entries; \
 	}
 
+/// Base class of modules
+///
+/// Every module registers its creatable classes in a process-wide table keyed by
+/// class id, so global `get_class_object` and `create_instance` don't walk modules.
+/// When several modules export the same class, the most recently loaded one wins.
 class module_base {
 public:
-	module_base() noexcept { _next = head(); head() = this; }
-	virtual ~module_base() { head() = nullptr; }
+	module_base() noexcept = default;
+	virtual ~module_base() { s_unregister(this); }
 	
 	virtual ref<class_factory> get_class_object(const uid& clsid, std::error_code& ec) noexcept = 0;
 	virtual ref<any> create_instance(any* outer, const uid& clsid, const uid& iid, std::error_code& ec) noexcept = 0;
@@ -811,58 +1221,146 @@ protected:
 		for (auto entry = entries; entry->clsid; ++entry) {
 			entry->class_shutdown();
 			// Release factory
-			if (entry->factory) {
-				ref<any> adopt(entry->factory, false);
-				entry->factory = nullptr;
+			if (auto factory = entry->factory.exchange(nullptr, std::memory_order_acq_rel)) {
+				ref<any> adopt(factory, false);
 			}
 		}
 	}
 	
-	static class_factory* s_get_class_object(std::mutex& mutex, const object_entry* entries, const uid& clsid, std::error_code& ec) noexcept {
+	static class_factory* s_get_class_object(const object_entry* entries, const uid& clsid, std::error_code& ec) noexcept {
 		for (auto entry = entries; entry->clsid; ++entry) {
-			if (entry->get_class_object && *entry->clsid == clsid) {
-				if (!entry->factory) {
-					std::lock_guard<std::mutex> lock(mutex);
-				 	if (!entry->factory) {
-				 		auto pv = reinterpret_cast<any*>(entry->create_instance);
-				 		if (auto rcf = boost::static_pointer_cast<class_factory>(entry->get_class_object(pv, UIDOF(any), ec))) {
-				 			entry->factory = rcf.detach();
-						}
-					}
-				}
-				BOOST_ASSERT(entry->factory);
-				ec = make_error_code(entry->factory ? errc::success : errc::failure);
-				return entry->factory;
-			}
+			if (entry->get_class_object && *entry->clsid == clsid)
+				return s_get_class_object(entry, ec);
 		}
 		
 		ec = make_error_code(errc::no_such_class);
 		return nullptr;
 	}
 	
+	static class_factory* s_get_class_object(const object_entry* entry, std::error_code& ec) noexcept {
+		auto factory = entry->factory.load(std::memory_order_acquire);
+		if (!factory) {
+			// Racing threads may create several factories, only the first one is published
+			auto pv = reinterpret_cast<any*>(entry->create_instance);
+			if (auto rcf = boost::static_pointer_cast<class_factory>(entry->get_class_object(pv, UIDOF(any), ec))) {
+				if (entry->factory.compare_exchange_strong(factory, rcf.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+					factory = rcf.detach();
+			}
+		}
+		BOOST_ASSERT(factory);
+		ec = make_error_code(factory ? errc::success : errc::failure);
+		return factory;
+	}
+	
+	/// Adds module classes to the global class table
+	static void s_register(module_base* module, const object_entry* entries) {
+		auto&& reg = registry();
+		std::unique_lock<std::shared_mutex> lock(reg.mutex);
+		module->_entries = entries;
+		try {
+			reg.add(module);
+		} catch (...) {
+			reg.remove(module, reg.head);
+			module->_entries = nullptr;
+			throw;
+		}
+		module->_next = reg.head;
+		reg.head = module;
+	}
+	
+	/// Removes module classes from the global class table
+	///
+	/// Classes shadowed by this module become visible again.
+	static void s_unregister(module_base* module) noexcept {
+		auto&& reg = registry();
+		std::unique_lock<std::shared_mutex> lock(reg.mutex);
+		for (auto link = &reg.head; *link; link = &(*link)->_next) {
+			if (*link == module) {
+				*link = module->_next;
+				reg.remove(module, module->_next);
+				module->_next = nullptr;
+				module->_entries = nullptr;
+				return;
+			}
+		}
+	}
+	
 private:
-	static module_base*& head() noexcept {
-		static module_base* head = nullptr;
-		return head;
+	struct class_registration {
+		module_base* module;
+		const object_entry* entry;
+	};
+	
+	struct class_registry {
+		void add(module_base* module) {
+			for (auto entry = module->_entries; entry->clsid; ++entry) {
+				if (entry->get_class_object)
+					classes.insert_or_assign(entry->clsid, class_registration{ module, entry });
+			}
+		}
+		
+		/// Removes classes registered by module, classes of `older` modules it shadowed take their place
+		///
+		/// Registrations are replaced or erased in place, so it doesn't allocate.
+		void remove(module_base* module, module_base* older) noexcept {
+			for (auto entry = module->_entries; entry->clsid; ++entry) {
+				auto it = classes.find(entry->clsid);
+				if (it == classes.end() || it->second.module != module)
+					continue;
+				
+				if (auto shadowed = find(older, entry->clsid))
+					it->second = *shadowed;
+				else
+					classes.erase(it);
+			}
+		}
+		
+		/// Newest registration of class starting from `module`
+		static std::optional<class_registration> find(module_base* module, const uid* clsid) noexcept {
+			for (; module; module = module->_next) {
+				for (auto entry = module->_entries; entry->clsid; ++entry) {
+					if (entry->get_class_object && entry->clsid == clsid)
+						return class_registration{ module, entry };
+				}
+			}
+			return std::nullopt;
+		}
+		
+		std::shared_mutex mutex;
+		std::unordered_map<const uid*, class_registration> classes;
+		module_base* head = nullptr;
+	};
+	
+	static class_registry& registry() noexcept {
+		static class_registry registry;
+		return registry;
+	}
+	
+	static const object_entry* s_find_class(const uid& clsid) noexcept {
+		auto&& reg = registry();
+		std::shared_lock<std::shared_mutex> lock(reg.mutex);
+		auto it = reg.classes.find(&clsid);
+		return it != reg.classes.end() ? it->second.entry : nullptr;
 	}
 	
+	const object_entry* _entries = nullptr;
 	module_base* _next = nullptr;
 	
 	// Global functions
 	
 	friend ref<class_factory> get_class_object(const uid& clsid, std::error_code& ec) noexcept {
-		for (auto&& module = head(); module; module = module->_next) {
-			if (auto p = module->get_class_object(clsid, ec))
-				return p;
-		}
+		if (auto entry = s_find_class(clsid))
+			return s_get_class_object(entry, ec);
 		ec = make_error_code(errc::no_such_class);
 		return nullptr;
 	}
 
 	friend ref<any> create_instance(any* outer, const uid& clsid, const uid& iid, std::error_code& ec) noexcept {
-		for (auto&& module = head(); module; module = module->_next) {
-			if (auto p = module->create_instance(outer, clsid, iid, ec))
-				return p;
+		if (auto entry = s_find_class(clsid)) {
+			// Factory is owned by its entry until module shutdown, no need to retain it here
+			if (auto factory = s_get_class_object(entry, ec))
+				return factory->create_instance(outer, iid, ec);
+			return nullptr;
 		}
 		ec = make_error_code(errc::no_such_class);
 		return nullptr;
@@ -872,16 +1370,18 @@ private:
 template <typename T>
 class module : public module_base {
 public:
-	module() noexcept {
+	module() {
 		s_initialize(derived().get_entries());
+		s_register(this, derived().get_entries());
 	}
 	
 	~module() {
+		s_unregister(this);
 		s_shutdown(derived().get_entries());
 	}
 
 	virtual ref<class_factory> get_class_object(const uid& clsid, std::error_code& ec) noexcept override {
-		return s_get_class_object(_mutex, derived().get_entries(), clsid, ec);
+		return s_get_class_object(derived().get_entries(), clsid, ec);
 	}
 	
 	virtual ref<any> create_instance(any* outer, const uid& clsid, const uid& iid, std::error_code& ec) noexcept override {
@@ -903,9 +1403,6 @@ public:
 	
 private:
 	T& derived() noexcept { return static_cast<T&>(*this); }
-	
-private:
-	std::mutex _mutex;
 };
 
 } // namespace com
@@ -0,0 +1,177 @@
+#ifndef COBALT_COMMAND_BUFFER_HPP_INCLUDED
+#define COBALT_COMMAND_BUFFER_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     command_buffer
+
+#include <cobalt/actor.hpp>
+
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace cobalt {
+
+///
+/// Deferred structural changes of level
+///
+/// Records spawns, destroys, reparenting and component changes, which may be done
+/// from concurrently running systems, and applies them later at a sync point.
+/// Recorded objects are retained by the buffer, so objects removed while applying
+/// are released in bulk after all commands are done and their destructors never
+/// run in the middle of structural changes.
+///
+class command_buffer {
+public:
+	command_buffer() = default;
+
+	command_buffer(const command_buffer&) = delete;
+	command_buffer& operator=(const command_buffer&) = delete;
+
+	/// Adds actor to level
+	void spawn(actor* a) { record(command_type::spawn, a, nullptr); }
+	/// Removes actor from level
+	void destroy(actor* a) { record(command_type::destroy, a, nullptr); }
+	/// Moves transform under new parent, or detaches it from parent if `parent` is null
+	void reparent(transform_component* child, transform_component* parent) { record(command_type::reparent, child, parent); }
+
+	void add_component(actor* a, actor_component* component) { record(command_type::add_component, a, component); }
+	void remove_component(actor* a, actor_component* component) { record(command_type::remove_component, a, component); }
+
+	size_t size() const;
+	bool empty() const { return !size(); }
+
+	/// Applies commands in the order they were recorded
+	///
+	/// Commands recorded while applying are kept for the next call. If a command
+	/// throws, it and the commands after it are put back ahead of commands recorded
+	/// meanwhile, so the next call retries them.
+	void apply(level& level);
+
+	void clear();
+
+private:
+	enum class command_type : uint8_t {
+		spawn,
+		destroy,
+		reparent,
+		add_component,
+		remove_component
+	};
+
+	struct command {
+		command_type type;
+		ref_ptr<object> target;
+		ref_ptr<object> argument;
+	};
+
+	void record(command_type type, object* target, object* argument);
+	static void execute(const command& c, level& level);
+
+	mutable std::mutex _mutex;
+	std::vector<command> _commands;
+	bool _applying = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// command_buffer
+//
+
+inline size_t command_buffer::size() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _commands.size();
+}
+
+inline void command_buffer::clear() {
+	std::vector<command> commands;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		commands.swap(_commands);
+	}
+}
+
+inline void command_buffer::record(command_type type, object* target, object* argument) {
+	BOOST_ASSERT(!!target);
+	std::lock_guard<std::mutex> lock(_mutex);
+	_commands.push_back({ type, target, argument });
+}
+
+inline void command_buffer::apply(level& level) {
+	std::vector<command> batch;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		BOOST_ASSERT_MSG(!_applying, "command buffer is already being applied");
+		_applying = true;
+		batch.swap(_commands);
+	}
+
+	size_t done = 0;
+	try {
+		for (; done < batch.size(); ++done)
+			execute(batch[done], level);
+	} catch (...) {
+		// Processed commands are released outside of the lock, their objects may record commands
+		batch.erase(batch.begin(), batch.begin() + done);
+		std::lock_guard<std::mutex> lock(_mutex);
+		_applying = false;
+		if (_commands.empty())
+			_commands.swap(batch);
+		else // Failing to allocate here drops the remaining commands
+			_commands.insert(_commands.begin(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+		throw;
+	}
+
+	// Bulk release, the last references to removed objects go away here
+	batch.clear();
+	std::lock_guard<std::mutex> lock(_mutex);
+	_applying = false;
+	// Reuse capacity of the batch for the next one
+	if (_commands.empty())
+		_commands.swap(batch);
+}
+
+inline void command_buffer::execute(const command& c, level& level) {
+	switch (c.type) {
+	case command_type::spawn: {
+		auto a = static_cast<actor*>(c.target.get());
+		if (!a->level())
+			level.add_actor(a);
+		break;
+	}
+	case command_type::destroy: {
+		// Actor may have been destroyed already
+		auto a = static_cast<actor*>(c.target.get());
+		if (a->level() == &level)
+			level.remove_actor(a);
+		break;
+	}
+	case command_type::reparent: {
+		auto child = static_cast<transform_component*>(c.target.get());
+		auto parent = static_cast<transform_component*>(c.argument.get());
+		if (child->parent() == parent)
+			break;
+		child->detach_from_parent();
+		if (parent)
+			parent->add_child(child);
+		break;
+	}
+	case command_type::add_component: {
+		auto component = static_cast<actor_component*>(c.argument.get());
+		if (!component->actor())
+			static_cast<actor*>(c.target.get())->add_component(component);
+		break;
+	}
+	case command_type::remove_component: {
+		auto component = static_cast<actor_component*>(c.argument.get());
+		if (component->actor() == c.target.get())
+			static_cast<actor*>(c.target.get())->remove_component(component);
+		break;
+	}
+	}
+}
+
+} // namespace cobalt
+
+#endif // COBALT_COMMAND_BUFFER_HPP_INCLUDED
@@ -0,0 +1,343 @@
+#ifndef COBALT_COMPONENT_STORAGE_HPP_INCLUDED
+#define COBALT_COMPONENT_STORAGE_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     component_handle
+//     component_pool
+//     component_view
+//     component_storage
+//
+// Functions in this file:
+//     component_type_id
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cobalt {
+
+class actor;
+
+///
+/// Stable reference to a component in `component_pool`
+///
+/// Components move in memory when other components of the same type are destroyed,
+/// handle stays valid until the component itself is destroyed. Slot generation is
+/// bumped on destruction, so stale handles never resolve to a reused slot.
+///
+struct component_handle {
+	static constexpr uint32_t npos = ~0u;
+
+	uint32_t index = npos;
+	uint32_t generation = 0;
+
+	explicit operator bool() const noexcept { return index != npos; }
+
+	friend bool operator==(const component_handle& lhs, const component_handle& rhs) noexcept {
+		return lhs.index == rhs.index && lhs.generation == rhs.generation;
+	}
+	friend bool operator!=(const component_handle& lhs, const component_handle& rhs) noexcept { return !(lhs == rhs); }
+};
+
+namespace detail {
+
+inline std::atomic<uint32_t>& component_type_counter() noexcept {
+	static std::atomic<uint32_t> counter{0};
+	return counter;
+}
+
+} // namespace detail
+
+/// Dense sequential id of component type, used to index per-type pools
+template <typename T>
+inline uint32_t component_type_id() noexcept {
+	static const uint32_t id = detail::component_type_counter().fetch_add(1, std::memory_order_relaxed);
+	return id;
+}
+
+namespace detail {
+
+class component_pool_base {
+public:
+	virtual ~component_pool_base() = default;
+
+	virtual size_t size() const noexcept = 0;
+	virtual void destroy(component_handle handle) noexcept = 0;
+	/// Moves component to the pool of the same type, returns handle in target pool
+	virtual component_handle move_to(component_handle handle, component_pool_base& target) = 0;
+	/// Creates copies of component owned by `owners` in the pool of the same type, writes their handles,
+	/// creates none if it throws
+	virtual void copy_to(component_handle handle, actor* const* owners, size_t count, component_pool_base& target, component_handle* handles) const = 0;
+	/// Creates empty pool of the same type
+	virtual std::unique_ptr<component_pool_base> create_empty() const = 0;
+};
+
+} // namespace detail
+
+///
+/// Contiguous storage of components of the same type
+///
+/// Components are kept densely packed along with their owners, so systems iterate
+/// them linearly. Pointers are invalidated by creation and destruction of components
+/// in the pool, handles are not.
+///
+template <typename T>
+class component_pool final : public detail::component_pool_base {
+	// Destruction compacts the pool by moving the last component, which must not fail
+	static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>, "data component must be nothrow movable");
+
+public:
+	using value_type = T;
+	using iterator = T*;
+	using const_iterator = const T*;
+
+	template <typename... Args>
+	component_handle create(actor* owner, Args&&... args) {
+		// Make sure nothing throws after the component is constructed
+		grow(_data);
+		grow(_owners);
+		grow(_dense_to_slot);
+		if (_free == component_handle::npos)
+			grow(_slots);
+
+		_data.emplace_back(std::forward<Args>(args)...);
+		_owners.push_back(owner);
+
+		auto index = _free;
+		if (index == component_handle::npos) {
+			index = static_cast<uint32_t>(_slots.size());
+			_slots.push_back({ 0, 0 });
+		} else {
+			_free = _slots[index].dense;
+		}
+		_dense_to_slot.push_back(index);
+
+		auto&& slot = _slots[index];
+		slot.dense = static_cast<uint32_t>(_data.size() - 1);
+		return { index, slot.generation };
+	}
+
+	virtual void destroy(component_handle handle) noexcept override {
+		BOOST_ASSERT(contains(handle));
+		if (!contains(handle))
+			return;
+
+		auto&& slot = _slots[handle.index];
+		auto dense = slot.dense;
+		auto last = static_cast<uint32_t>(_data.size() - 1);
+
+		// Keep array dense by moving the last component into the hole
+		if (dense != last) {
+			_data[dense] = std::move(_data[last]);
+			_owners[dense] = _owners[last];
+			_dense_to_slot[dense] = _dense_to_slot[last];
+			_slots[_dense_to_slot[dense]].dense = dense;
+		}
+		_data.pop_back();
+		_owners.pop_back();
+		_dense_to_slot.pop_back();
+
+		++slot.generation;
+		slot.dense = _free;
+		_free = handle.index;
+	}
+
+	virtual component_handle move_to(component_handle handle, detail::component_pool_base& target) override {
+		BOOST_ASSERT(contains(handle));
+		auto&& pool = static_cast<component_pool&>(target);
+		auto dense = _slots[handle.index].dense;
+		auto moved = pool.create(_owners[dense], std::move(_data[dense]));
+		destroy(handle);
+		return moved;
+	}
+
+	virtual void copy_to(component_handle handle, actor* const* owners, size_t count, detail::component_pool_base& target, component_handle* handles) const override {
+		BOOST_ASSERT(contains(handle));
+		if constexpr (std::is_copy_constructible_v<T>) {
+			auto&& pool = static_cast<component_pool&>(target);
+			// Grow geometrically, copying few components at a time must stay amortized constant
+			auto required = pool.size() + count;
+			if (required > pool._data.capacity())
+				pool.reserve(std::max(required, pool._data.capacity() * 2));
+			// Prototype may live in the target pool and move when it grows
+			const T prototype = _data[_slots[handle.index].dense];
+			size_t i = 0;
+			try {
+				for (; i < count; ++i)
+					handles[i] = pool.create(owners[i], prototype);
+			} catch (...) {
+				while (i--)
+					pool.destroy(handles[i]);
+				throw;
+			}
+		} else {
+			throw std::system_error(std::make_error_code(std::errc::not_supported), "component is not copyable");
+		}
+	}
+
+	virtual std::unique_ptr<detail::component_pool_base> create_empty() const override {
+		return std::make_unique<component_pool>();
+	}
+
+	bool contains(component_handle handle) const noexcept {
+		return handle.index < _slots.size() && _slots[handle.index].generation == handle.generation;
+	}
+
+	T* get(component_handle handle) noexcept { return contains(handle) ? &_data[_slots[handle.index].dense] : nullptr; }
+	const T* get(component_handle handle) const noexcept { return contains(handle) ? &_data[_slots[handle.index].dense] : nullptr; }
+
+	actor* owner(component_handle handle) const noexcept { return contains(handle) ? _owners[_slots[handle.index].dense] : nullptr; }
+
+	/// Handle of component at position in dense array
+	component_handle handle(size_t position) const noexcept {
+		BOOST_ASSERT(position < _data.size());
+		auto index = _dense_to_slot[position];
+		return { index, _slots[index].generation };
+	}
+
+	virtual size_t size() const noexcept override { return _data.size(); }
+	bool empty() const noexcept { return _data.empty(); }
+
+	/// Preallocates storage, creating components up to `capacity` doesn't allocate
+	void reserve(size_t capacity) {
+		_data.reserve(capacity);
+		_owners.reserve(capacity);
+		_dense_to_slot.reserve(capacity);
+		_slots.reserve(capacity);
+	}
+
+	T* data() noexcept { return _data.data(); }
+	const T* data() const noexcept { return _data.data(); }
+	actor* const* owners() const noexcept { return _owners.data(); }
+
+	iterator begin() noexcept { return _data.data(); }
+	iterator end() noexcept { return _data.data() + _data.size(); }
+	const_iterator begin() const noexcept { return _data.data(); }
+	const_iterator end() const noexcept { return _data.data() + _data.size(); }
+
+private:
+	struct slot {
+		uint32_t dense;         ///< Position in dense arrays or next free slot
+		uint32_t generation;
+	};
+
+	template <typename Vector>
+	static void grow(Vector& v) {
+		if (v.size() == v.capacity())
+			v.reserve(std::max<size_t>(16, v.capacity() * 2));
+	}
+
+	std::vector<T> _data;
+	std::vector<actor*> _owners;
+	std::vector<uint32_t> _dense_to_slot;
+	std::vector<slot> _slots;
+	uint32_t _free = component_handle::npos;
+};
+
+///
+/// Range of all components of a type with their owners
+///
+template <typename T>
+class component_view {
+public:
+	component_view() noexcept = default;
+	explicit component_view(component_pool<T>* pool) noexcept : _pool(pool) {}
+
+	T* begin() const noexcept { return _pool ? _pool->begin() : nullptr; }
+	T* end() const noexcept { return _pool ? _pool->end() : nullptr; }
+
+	size_t size() const noexcept { return _pool ? _pool->size() : 0; }
+	bool empty() const noexcept { return !size(); }
+
+	T& operator[](size_t i) const noexcept { BOOST_ASSERT(i < size()); return _pool->data()[i]; }
+	actor* owner(size_t i) const noexcept { BOOST_ASSERT(i < size()); return _pool->owners()[i]; }
+
+private:
+	component_pool<T>* _pool = nullptr;
+};
+
+///
+/// Set of component pools indexed by component type id
+///
+class component_storage {
+public:
+	component_storage() = default;
+
+	component_storage(const component_storage&) = delete;
+	component_storage& operator=(const component_storage&) = delete;
+
+	template <typename T>
+	component_pool<T>& pool() {
+		auto id = component_type_id<T>();
+		if (auto p = find_pool(id))
+			return static_cast<component_pool<T>&>(*p);
+		return static_cast<component_pool<T>&>(insert(id, std::make_unique<component_pool<T>>()));
+	}
+
+	template <typename T>
+	component_pool<T>* find_pool() noexcept {
+		return static_cast<component_pool<T>*>(find_pool(component_type_id<T>()));
+	}
+
+	detail::component_pool_base* find_pool(uint32_t type) noexcept {
+		return type < _pools.size() ? _pools[type].get() : nullptr;
+	}
+	const detail::component_pool_base* find_pool(uint32_t type) const noexcept {
+		return type < _pools.size() ? _pools[type].get() : nullptr;
+	}
+
+	/// Finds pool of type or creates it with the same type as `prototype`
+	detail::component_pool_base& pool(uint32_t type, const detail::component_pool_base& prototype) {
+		if (auto p = find_pool(type))
+			return *p;
+		return insert(type, prototype.create_empty());
+	}
+
+	template <typename T>
+	component_view<T> view() noexcept { return component_view<T>(find_pool<T>()); }
+
+	/// Storage of components which owners are not attached to any level
+	///
+	/// Shared by all threads. Actor functions changing data lock it by themselves, but
+	/// pointers they return move when other threads change components of the same type,
+	/// so threads using data of detached actors keep `lock_if_detached` held meanwhile.
+	static component_storage& detached() noexcept {
+		// Intentionally leaked, actors may outlive static objects
+		static component_storage* storage = new component_storage;
+		return *storage;
+	}
+	
+	/// Locks detached storage if `storage` is the one, level storage is guarded by level owner
+	///
+	/// The lock is recursive, actor functions may be called under it.
+	static std::unique_lock<std::recursive_mutex> lock_if_detached(const component_storage& storage) {
+		if (&storage != &detached())
+			return {};
+		static std::recursive_mutex* mutex = new std::recursive_mutex;
+		return std::unique_lock<std::recursive_mutex>(*mutex);
+	}
+
+private:
+	detail::component_pool_base& insert(uint32_t type, std::unique_ptr<detail::component_pool_base> pool) {
+		if (type >= _pools.size())
+			_pools.resize(type + 1);
+		_pools[type] = std::move(pool);
+		return *_pools[type];
+	}
+
+	std::vector<std::unique_ptr<detail::component_pool_base>> _pools;
+};
+
+} // namespace cobalt
+
+#endif // COBALT_COMPONENT_STORAGE_HPP_INCLUDED
@@ -0,0 +1,525 @@
+#ifndef COBALT_ENCODING_HPP_INCLUDED
+#define COBALT_ENCODING_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     schema
+//     bit_encoder
+//     bit_decoder
+
+#include <cobalt/com.hpp>
+#include <cobalt/io.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace cobalt {
+namespace io {
+
+/// Quantized field values of an encoded object
+///
+/// Encoder and decoder record one value per field (raw data takes one value per
+/// 4 bytes). Snapshot of a previous state of the same object serves as a baseline
+/// for delta encoding.
+using bit_snapshot = std::vector<uint32_t>;
+
+namespace detail {
+
+inline uint32_t float_steps(float min, float max, float resolution) noexcept {
+	BOOST_ASSERT(min <= max && resolution > 0);
+	return static_cast<uint32_t>(std::ceil((max - min) / resolution));
+}
+
+inline uint32_t quantize(float value, float min, float max, float resolution, uint32_t steps) noexcept {
+	auto q = std::lround((std::clamp(value, min, max) - min) / resolution);
+	return std::min(static_cast<uint32_t>(q), steps);
+}
+
+inline float dequantize(uint32_t value, float min, float max, float resolution) noexcept {
+	return std::min(min + value * resolution, max);
+}
+
+} // namespace detail
+
+enum class schema_field_type : uint8_t {
+	boolean,
+	integer,
+	ranged_integer,
+	real,
+	ranged_real,
+	data
+};
+
+struct schema_field {
+	const char* key;
+	schema_field_type type;
+	int bits;                ///< Bits per value for ranged fields
+	size_t offset;           ///< Offset from the beginning of object
+	size_t size;             ///< Size of raw data
+	int min_int, max_int;
+	float min, max, resolution;
+	uint32_t steps;          ///< Number of quantization steps of ranged float
+};
+
+namespace detail {
+
+/// Encoder recording fields instead of encoding them
+class schema_recorder
+	: public com::object_base
+	, public com::encoder
+{
+public:
+	BEGIN_CAST_MAP(schema_recorder)
+		CAST_ENTRY(com::encoder)
+	END_CAST_MAP()
+
+	void begin(const void* object, size_t size, std::vector<schema_field>* fields) noexcept {
+		_base = static_cast<const char*>(object);
+		_size = size;
+		_fields = fields;
+		_valid = true;
+	}
+
+	bool valid() const noexcept { return _valid; }
+
+	virtual void encode(const char* key, bool& value) noexcept override {
+		add(key, schema_field_type::boolean, &value, sizeof(value), 1);
+	}
+
+	virtual void encode(const char* key, int& value) noexcept override {
+		add(key, schema_field_type::integer, &value, sizeof(value), 32);
+	}
+
+	virtual void encode(const char* key, int& value, int min, int max) noexcept override {
+		if (auto field = add(key, schema_field_type::ranged_integer, &value, sizeof(value), bits_required_for(min, max))) {
+			field->min_int = min;
+			field->max_int = max;
+		}
+	}
+
+	virtual void encode(const char* key, float& value) noexcept override {
+		add(key, schema_field_type::real, &value, sizeof(value), 32);
+	}
+
+	virtual void encode(const char* key, float& value, float min, float max, float resolution) noexcept override {
+		auto steps = float_steps(min, max, resolution);
+		if (auto field = add(key, schema_field_type::ranged_real, &value, sizeof(value), bits_required_for(0, steps))) {
+			field->min = min;
+			field->max = max;
+			field->resolution = resolution;
+			field->steps = steps;
+		}
+	}
+
+	virtual void encode(const char* key, void* data, size_t size) noexcept override {
+		add(key, schema_field_type::data, data, size, 0);
+	}
+
+private:
+	schema_field* add(const char* key, schema_field_type type, const void* value, size_t size, int bits) noexcept {
+		auto p = static_cast<const char*>(value);
+		// Values outside of the object can't be addressed by offset
+		if (!_valid || p < _base || p + size > _base + _size) {
+			_valid = false;
+			return nullptr;
+		}
+		try {
+			_fields->push_back({ key, type, bits, static_cast<size_t>(p - _base), size, 0, 0, 0, 0, 0, 0 });
+		} catch (const std::bad_alloc&) {
+			_valid = false;
+			return nullptr;
+		}
+		return &_fields->back();
+	}
+
+	const char* _base = nullptr;
+	size_t _size = 0;
+	std::vector<schema_field>* _fields = nullptr;
+	bool _valid = false;
+};
+
+} // namespace detail
+
+/// Compiled field list of encodable type
+///
+/// Schema is recorded once by running `encode` of an object with an encoder which
+/// stores field offsets, types and ranges. Binary encoders then process whole
+/// objects in a loop without virtual calls or keys. Recording fails if `encode`
+/// passes values which are not members of the object, in that case callers fall
+/// back to the keyed interface. `encode` must produce the same field list for all
+/// objects of the type, which is checked on every encode and decode in debug builds.
+class schema {
+public:
+	schema(const com::encodable& object, const void* base, size_t size) noexcept {
+		com::stack_object<detail::schema_recorder> recorder;
+		recorder.begin(base, size, &_fields);
+		std::error_code ec;
+		object.encode(&recorder, ec);
+		_valid = !ec && recorder.valid();
+		if (!_valid)
+			_fields.clear();
+	}
+
+	/// Schema of type T, compiled at the first call
+	/// @return nullptr if the type can't be compiled
+	template <typename T>
+	static const schema* of(const T& object) noexcept {
+		static_assert(std::is_base_of_v<com::encodable, T>);
+		static const schema compiled(object, &object, sizeof(T));
+		return compiled.valid() ? &compiled : nullptr;
+	}
+
+	/// Whether `object` produces the same field list, fields encoded conditionally break it
+	template <typename T>
+	bool matches(const T& object) const noexcept {
+		schema recorded(object, &object, sizeof(T));
+		return recorded._valid == _valid && std::equal(_fields.begin(), _fields.end(),
+			recorded._fields.begin(), recorded._fields.end(), same_field);
+	}
+
+	bool valid() const noexcept { return _valid; }
+	const std::vector<schema_field>& fields() const noexcept { return _fields; }
+
+private:
+	static bool same_field(const schema_field& lhs, const schema_field& rhs) noexcept {
+		return std::strcmp(lhs.key ? lhs.key : "", rhs.key ? rhs.key : "") == 0
+			&& lhs.type == rhs.type && lhs.bits == rhs.bits && lhs.offset == rhs.offset && lhs.size == rhs.size
+			&& lhs.min_int == rhs.min_int && lhs.max_int == rhs.max_int
+			&& lhs.min == rhs.min && lhs.max == rhs.max && lhs.resolution == rhs.resolution;
+	}
+
+	std::vector<schema_field> _fields;
+	bool _valid = false;
+};
+
+/// Bit packed encoder
+///
+/// Writes ranged values with the minimal number of bits and floats quantized to
+/// the given resolution. Keys are not written, so the decoder must read fields in
+/// the same order. In delta mode every field is prefixed with a "changed" bit
+/// and only changed fields are written; single bit fields are always written as is.
+DECLARE_CLASS(io, bit_encoder)
+class bit_encoder
+	: public com::object_base
+	, public com::encoder
+	, public com::coclass<bit_encoder, UIDOF(bit_encoder)>
+{
+public:
+	BEGIN_CAST_MAP(bit_encoder)
+		CAST_ENTRY(com::encoder)
+	END_CAST_MAP()
+
+	DECLARE_GET_OUTER_OBJECT()
+
+	/// Starts encoding to `writer`, as delta against `baseline` if provided
+	void begin(bit_writer& writer, const bit_snapshot* baseline = nullptr) noexcept {
+		_writer = &writer;
+		_baseline = baseline;
+		_snapshot.clear();
+		_ec.clear();
+	}
+
+	/// Values encoded since `begin`
+	const bit_snapshot& snapshot() const noexcept { return _snapshot; }
+	/// First error since `begin`
+	const std::error_code& error() const noexcept { return _ec; }
+
+	virtual void encode(const char* key, bool& value) noexcept override {
+		write(value ? 1 : 0, 1);
+	}
+
+	virtual void encode(const char* key, int& value) noexcept override {
+		write(static_cast<uint32_t>(value), 32);
+	}
+
+	virtual void encode(const char* key, int& value, int min, int max) noexcept override {
+		write_ranged(value, min, max, bits_required_for(min, max));
+	}
+
+	virtual void encode(const char* key, float& value) noexcept override {
+		write_float(value);
+	}
+
+	virtual void encode(const char* key, float& value, float min, float max, float resolution) noexcept override {
+		auto steps = detail::float_steps(min, max, resolution);
+		write(detail::quantize(value, min, max, resolution, steps), bits_required_for(0, steps));
+	}
+
+	virtual void encode(const char* key, void* data, size_t size) noexcept override {
+		write_data(data, size);
+	}
+
+	/// Encodes all fields of `object` described by `schema`
+	void encode(const schema& schema, const void* object) noexcept {
+		auto base = static_cast<const char*>(object);
+		for (auto&& field : schema.fields()) {
+			auto p = base + field.offset;
+			switch (field.type) {
+			case schema_field_type::boolean:
+				write(*reinterpret_cast<const bool*>(p) ? 1 : 0, 1);
+				break;
+			case schema_field_type::integer:
+				write(static_cast<uint32_t>(*reinterpret_cast<const int*>(p)), 32);
+				break;
+			case schema_field_type::ranged_integer:
+				write_ranged(*reinterpret_cast<const int*>(p), field.min_int, field.max_int, field.bits);
+				break;
+			case schema_field_type::real:
+				write_float(*reinterpret_cast<const float*>(p));
+				break;
+			case schema_field_type::ranged_real:
+				write(detail::quantize(*reinterpret_cast<const float*>(p), field.min, field.max, field.resolution, field.steps), field.bits);
+				break;
+			case schema_field_type::data:
+				write_data(p, field.size);
+				break;
+			}
+		}
+	}
+
+	/// Encodes object with compiled schema if possible or with keyed interface otherwise
+	template <typename T>
+	void encode(const T& object, std::error_code& ec) noexcept {
+		if (auto compiled = schema::of(object)) {
+			BOOST_ASSERT_MSG(compiled->matches(object), "encode produces fields which differ from compiled schema");
+			encode(*compiled, &object);
+			ec = _ec;
+		} else {
+			object.encode(this, ec);
+			if (!ec)
+				ec = _ec;
+		}
+	}
+
+private:
+	void write(uint32_t value, int bits) noexcept {
+		BOOST_ASSERT(_writer);
+		if (_ec || !_writer)
+			return;
+
+		auto index = _snapshot.size();
+		try {
+			_snapshot.push_back(value);
+		} catch (const std::bad_alloc&) {
+			_ec = std::make_error_code(std::errc::not_enough_memory);
+			return;
+		}
+
+		if (_baseline && bits > 1) {
+			bool changed = index >= _baseline->size() || (*_baseline)[index] != value;
+			_writer->write_bits(changed ? 1 : 0, 1, _ec);
+			if (!changed || _ec)
+				return;
+		}
+
+		_writer->write_bits(value, bits, _ec);
+	}
+
+	void write_ranged(int value, int min, int max, int bits) noexcept {
+		BOOST_ASSERT(min <= max);
+		BOOST_ASSERT(value >= min && value <= max);
+		auto clamped = static_cast<int64_t>(std::clamp(value, min, max));
+		write(static_cast<uint32_t>(clamped - min), bits);
+	}
+
+	void write_float(float value) noexcept {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		write(bits, 32);
+	}
+
+	void write_data(const void* data, size_t size) noexcept {
+		auto bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i += 4) {
+			auto count = std::min<size_t>(4, size - i);
+			uint32_t word = 0;
+			for (size_t k = 0; k < count; ++k)
+				word |= static_cast<uint32_t>(bytes[i + k]) << (k * 8);
+			write(word, static_cast<int>(count * 8));
+		}
+	}
+
+	bit_writer* _writer = nullptr;
+	const bit_snapshot* _baseline = nullptr;
+	bit_snapshot _snapshot;
+	std::error_code _ec;
+};
+
+/// Bit packed decoder
+///
+/// Reads data written by `bit_encoder`, delta encoded data requires the same baseline.
+DECLARE_CLASS(io, bit_decoder)
+class bit_decoder
+	: public com::object_base
+	, public com::decoder
+	, public com::coclass<bit_decoder, UIDOF(bit_decoder)>
+{
+public:
+	BEGIN_CAST_MAP(bit_decoder)
+		CAST_ENTRY(com::decoder)
+	END_CAST_MAP()
+
+	DECLARE_GET_OUTER_OBJECT()
+
+	/// Starts decoding from `reader`, as delta against `baseline` if provided
+	void begin(bit_reader& reader, const bit_snapshot* baseline = nullptr) noexcept {
+		_reader = &reader;
+		_baseline = baseline;
+		_snapshot.clear();
+		_ec.clear();
+	}
+
+	/// Values decoded since `begin`
+	const bit_snapshot& snapshot() const noexcept { return _snapshot; }
+	/// First error since `begin`
+	const std::error_code& error() const noexcept { return _ec; }
+
+	virtual void decode(const char* key, bool& value) noexcept override {
+		value = read(1) != 0;
+	}
+
+	virtual void decode(const char* key, int& value) noexcept override {
+		value = static_cast<int>(read(32));
+	}
+
+	virtual void decode(const char* key, int& value, int min, int max) noexcept override {
+		value = read_ranged(min, max, bits_required_for(min, max));
+	}
+
+	virtual void decode(const char* key, float& value) noexcept override {
+		value = read_float();
+	}
+
+	virtual void decode(const char* key, float& value, float min, float max, float resolution) noexcept override {
+		auto q = read(bits_required_for(0, detail::float_steps(min, max, resolution)));
+		value = detail::dequantize(q, min, max, resolution);
+	}
+
+	virtual void decode(const char* key, void* data, size_t size) noexcept override {
+		read_data(data, size);
+	}
+
+	/// Decodes all fields of `object` described by `schema`
+	void decode(const schema& schema, void* object) noexcept {
+		auto base = static_cast<char*>(object);
+		for (auto&& field : schema.fields()) {
+			auto p = base + field.offset;
+			switch (field.type) {
+			case schema_field_type::boolean:
+				*reinterpret_cast<bool*>(p) = read(1) != 0;
+				break;
+			case schema_field_type::integer:
+				*reinterpret_cast<int*>(p) = static_cast<int>(read(32));
+				break;
+			case schema_field_type::ranged_integer:
+				*reinterpret_cast<int*>(p) = read_ranged(field.min_int, field.max_int, field.bits);
+				break;
+			case schema_field_type::real:
+				*reinterpret_cast<float*>(p) = read_float();
+				break;
+			case schema_field_type::ranged_real:
+				*reinterpret_cast<float*>(p) = detail::dequantize(read(field.bits), field.min, field.max, field.resolution);
+				break;
+			case schema_field_type::data:
+				read_data(p, field.size);
+				break;
+			}
+		}
+	}
+
+	/// Decodes object with compiled schema if possible or with keyed interface otherwise
+	template <typename T>
+	void decode(T& object, std::error_code& ec) noexcept {
+		if (auto compiled = schema::of(object)) {
+			decode(*compiled, &object);
+			ec = _ec;
+			// Decoded values select fields of conditional encode, so they are checked afterwards
+			BOOST_ASSERT_MSG(ec || compiled->matches(object), "encode produces fields which differ from compiled schema");
+		} else {
+			object.init(this, ec);
+			if (!ec)
+				ec = _ec;
+		}
+	}
+
+private:
+	uint32_t read(int bits) noexcept {
+		BOOST_ASSERT(_reader);
+		if (_ec || !_reader)
+			return 0;
+
+		auto index = _snapshot.size();
+		uint32_t value = 0;
+
+		bool changed = true;
+		if (_baseline && bits > 1) {
+			changed = _reader->read_bits(1, _ec) != 0;
+			if (!changed) {
+				if (index >= _baseline->size()) {
+					set_error(std::make_error_code(std::errc::illegal_byte_sequence));
+					return 0;
+				}
+				value = (*_baseline)[index];
+			}
+		}
+
+		if (changed && !_ec)
+			value = _reader->read_bits(bits, _ec);
+		if (_ec)
+			return 0;
+
+		try {
+			_snapshot.push_back(value);
+		} catch (const std::bad_alloc&) {
+			_ec = std::make_error_code(std::errc::not_enough_memory);
+			return 0;
+		}
+		return value;
+	}
+
+	int read_ranged(int min, int max, int bits) noexcept {
+		BOOST_ASSERT(min <= max);
+		auto q = read(bits);
+		if (q > static_cast<uint64_t>(static_cast<int64_t>(max) - min)) {
+			set_error(std::make_error_code(std::errc::result_out_of_range));
+			q = 0;
+		}
+		return static_cast<int>(min + static_cast<int64_t>(q));
+	}
+
+	float read_float() noexcept {
+		auto bits = read(32);
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	void read_data(void* data, size_t size) noexcept {
+		auto bytes = static_cast<uint8_t*>(data);
+		for (size_t i = 0; i < size; i += 4) {
+			auto count = std::min<size_t>(4, size - i);
+			auto word = read(static_cast<int>(count * 8));
+			for (size_t k = 0; k < count; ++k)
+				bytes[i + k] = static_cast<uint8_t>(word >> (k * 8));
+		}
+	}
+
+	void set_error(std::error_code ec) noexcept {
+		if (!_ec)
+			_ec = ec;
+	}
+
+	bit_reader* _reader = nullptr;
+	const bit_snapshot* _baseline = nullptr;
+	bit_snapshot _snapshot;
+	std::error_code _ec;
+};
+
+} // namespace io
+} // namespace cobalt
+
+#endif // COBALT_ENCODING_HPP_INCLUDED
@@ -126,7 +126,7 @@ public:
 	size_t invoke(const identifier& target, const ref_ptr<event>& event);
 
 private:
-	using Subscriptions =  std::unordered_multimap<identifier, std::pair<const void*, handler_type>, boost::hash<identifier>>;
+	using Subscriptions = std::unordered_multimap<identifier, std::pair<const void*, handler_type>>;
 	using Connections = std::unordered_multimap<const void*, identifier>;
 	using EventQueue = std::deque<std::pair<identifier, ref_ptr<event>>>;
 	
@@ -5,6 +5,7 @@
 
 #include "fsm_fwd.hpp"
 
+#include <algorithm>
 #include <type_traits>
 
 #include <boost/assert.hpp>
@@ -177,6 +178,685 @@ inline bool state_machine<T>::send() {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+template <typename Machine>
+inline Machine* static_state<Machine>::machine() const noexcept {
+	BOOST_ASSERT(_machine);
+	return static_cast<Machine*>(static_cast<typename Machine::machine_type*>(_machine));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+template <typename... States, typename... Rows>
+template <typename State>
+constexpr typename transition_table<states<States...>, transitions<Rows...>>::index_type transition_table<states<States...>, transitions<Rows...>>::index_of() noexcept {
+	constexpr auto index = type_position<State, States...>();
+	static_assert(index < state_count, "Unknown state");
+	return static_cast<index_type>(index);
+}
+
+template <typename... States, typename... Rows>
+template <typename Event>
+constexpr typename transition_table<states<States...>, transitions<Rows...>>::index_type transition_table<states<States...>, transitions<Rows...>>::event_index() noexcept {
+	constexpr auto index = unique_type_position<Event, typename Rows::event_type...>();
+	return index < event_count ? static_cast<index_type>(index) : npos;
+}
+
+template <typename... States, typename... Rows>
+constexpr typename transition_table<states<States...>, transitions<Rows...>>::targets_type transition_table<states<States...>, transitions<Rows...>>::targets() noexcept {
+	targets_type targets{};
+	for (auto&& events : targets) {
+		for (auto&& to : events)
+			to = npos;
+	}
+	((targets[index_of<typename Rows::from_type>()][event_index<typename Rows::event_type>()] = index_of<typename Rows::to_type>()), ...);
+	return targets;
+}
+
+template <typename... States, typename... Rows>
+constexpr typename transition_table<states<States...>, transitions<Rows...>>::reachable_type transition_table<states<States...>, transitions<Rows...>>::reachable() noexcept {
+	reachable_type reachable{};
+	((reachable[index_of<typename Rows::from_type>()][index_of<typename Rows::to_type>()] = true), ...);
+	return reachable;
+}
+
+template <typename... States, typename... Rows>
+constexpr bool transition_table<states<States...>, transitions<Rows...>>::deterministic() noexcept {
+	std::array<std::array<bool, event_count>, state_count> used{};
+	bool result = true;
+	auto use = [&](size_t from, size_t event) {
+		result = result && !used[from][event];
+		used[from][event] = true;
+	};
+	(use(index_of<typename Rows::from_type>(), event_index<typename Rows::event_type>()), ...);
+	return result;
+}
+
+template <typename... States, typename... Rows>
+template <typename T>
+constexpr bool transition_table<states<States...>, transitions<Rows...>>::validate() noexcept {
+	static_assert((std::is_base_of<T, States>::value && ...), "State is not derived from T");
+	static_assert(unique_type_count<States...>() == state_count, "States are not unique");
+	static_assert(deterministic(), "State has several transitions on the same event");
+	return true;
+}
+
+template <typename... States, typename... Substates, typename... Rows>
+constexpr typename hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::states_type hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::parents() noexcept {
+	return state_parents(states<States...>(), hierarchy<Substates...>());
+}
+
+template <typename... States, typename... Substates, typename... Rows>
+constexpr typename hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::states_type hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::initials() noexcept {
+	states_type initials{};
+	for (auto&& initial : initials)
+		initial = npos;
+	auto add = [&](size_t child, size_t parent) {
+		if (child < state_count && parent < state_count && initials[parent] == npos)
+			initials[parent] = static_cast<index_type>(child);
+	};
+	(add(type_position<typename Substates::child_type, States...>(), type_position<typename Substates::parent_type, States...>()), ...);
+	return initials;
+}
+
+template <typename... States, typename... Substates, typename... Rows>
+constexpr typename hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::states_type hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::depths() noexcept {
+	auto levels = state_depths(states<States...>(), hierarchy<Substates...>());
+	states_type depths{};
+	for (size_t i = 0; i < state_count; ++i)
+		depths[i] = static_cast<index_type>(levels[i] < depth_count ? levels[i] : depth_count - 1);
+	return depths;
+}
+
+template <typename... States, typename... Substates, typename... Rows>
+constexpr typename hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::ancestors_type hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::ancestors() noexcept {
+	auto parents = hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::parents();
+	auto depths = hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::depths();
+	ancestors_type ancestors{};
+	for (size_t i = 0; i < state_count; ++i) {
+		auto&& path = ancestors[i];
+		for (auto&& ancestor : path)
+			ancestor = npos;
+		auto state = static_cast<index_type>(i);
+		for (size_t depth = depths[i] + 1; depth-- && state != npos; state = parents[state])
+			path[depth] = state;
+	}
+	return ancestors;
+}
+
+template <typename... States, typename... Substates, typename... Rows>
+constexpr typename hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::event_transitions_type hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::event_transitions() noexcept {
+	auto parents = hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::parents();
+	auto depths = hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::depths();
+	auto ancestors = hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::ancestors();
+	
+	auto own = empty<event_count>();
+	auto add = [&](size_t from, size_t event, index_type to, history_kind history) {
+		own[from][event].target = to;
+		own[from][event].history = history;
+	};
+	(add(index_of<typename Rows::from_type>(), event_index<typename Rows::event_type>(),
+		index_of<typename transition_target<typename Rows::to_type>::type>(), transition_target<typename Rows::to_type>::history), ...);
+	
+	// Events not handled by state fall back to the nearest ancestor handling them
+	auto resolved = empty<event_count>();
+	for (size_t state = 0; state < state_count; ++state) {
+		for (size_t event = 0; event < event_count; ++event) {
+			auto source = static_cast<index_type>(state);
+			for (size_t depth = 0; depth < depth_count && source != npos && own[source][event].target == npos; ++depth)
+				source = parents[source];
+			if (source == npos || own[source][event].target == npos)
+				continue;
+			resolved[state][event] = own[source][event];
+			resolved[state][event].domain = domain(ancestors, depths, source, own[source][event].target);
+		}
+	}
+	return resolved;
+}
+
+template <typename... States, typename... Substates, typename... Rows>
+constexpr typename hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::target_transitions_type hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::target_transitions() noexcept {
+	auto parents = hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::parents();
+	auto depths = hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::depths();
+	auto ancestors = hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::ancestors();
+	
+	std::array<std::array<bool, state_count>, state_count> own{};
+	((own[index_of<typename Rows::from_type>()][index_of<typename transition_target<typename Rows::to_type>::type>()] = true), ...);
+	
+	auto resolved = empty<state_count>();
+	for (size_t state = 0; state < state_count; ++state) {
+		for (size_t target = 0; target < state_count; ++target) {
+			auto source = static_cast<index_type>(state);
+			for (size_t depth = 0; depth < depth_count && source != npos && !own[source][target]; ++depth)
+				source = parents[source];
+			if (source == npos || !own[source][target])
+				continue;
+			resolved[state][target].target = static_cast<index_type>(target);
+			resolved[state][target].domain = domain(ancestors, depths, source, static_cast<index_type>(target));
+		}
+	}
+	return resolved;
+}
+
+template <typename... States, typename... Substates, typename... Rows>
+constexpr typename hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::index_type hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::domain(const ancestors_type& ancestors, const states_type& depths, index_type source, index_type target) noexcept {
+	// Common ancestor is left too if it's source or target of transition
+	auto depth = depths[source] < depths[target] ? depths[source] : depths[target];
+	index_type common = npos;
+	for (size_t i = 0; i <= depth && ancestors[source][i] == ancestors[target][i]; ++i)
+		common = ancestors[source][i];
+	if (common != npos && (common == source || common == target))
+		common = depths[common] ? ancestors[common][depths[common] - 1] : npos;
+	return common;
+}
+
+template <typename... States, typename... Substates, typename... Rows>
+template <typename T>
+constexpr bool hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>::validate() noexcept {
+	static_assert(flat_table::template validate<T>());
+	static_assert(((type_position<typename Substates::child_type, States...>() < state_count) && ...), "Unknown substate");
+	static_assert(((type_position<typename Substates::parent_type, States...>() < state_count) && ...), "Unknown parent state");
+	static_assert(unique_type_count<typename Substates::child_type...>() == sizeof...(Substates), "Substate has several parents");
+	static_assert(depth_count <= state_count, "Cyclic hierarchy of states");
+	return true;
+}
+
+template <typename State, typename T, typename = void>
+struct has_enter : std::false_type {};
+template <typename State, typename T>
+struct has_enter<State, T, std::void_t<decltype(std::declval<State&>().enter(std::declval<T*>()))>> : std::true_type {};
+
+template <typename State, typename T, typename = void>
+struct has_leave : std::false_type {};
+template <typename State, typename T>
+struct has_leave<State, T, std::void_t<decltype(std::declval<State&>().leave(std::declval<T*>()))>> : std::true_type {};
+
+template <typename State, typename T, typename = void>
+struct has_batch_enter : std::false_type {};
+template <typename State, typename T>
+struct has_batch_enter<State, T, std::void_t<decltype(std::declval<State&>().enter(std::declval<instance_batch>(), std::declval<T*>()))>> : std::true_type {};
+
+template <typename State, typename T, typename = void>
+struct has_batch_leave : std::false_type {};
+template <typename State, typename T>
+struct has_batch_leave<State, T, std::void_t<decltype(std::declval<State&>().leave(std::declval<instance_batch>(), std::declval<T*>()))>> : std::true_type {};
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T, typename... States, typename... Rows>
+inline static_state_machine<T, states<States...>, transitions<Rows...>>::static_state_machine() {
+	static_assert(table::template validate<T>());
+	bind(std::index_sequence_for<States...>());
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline bool static_state_machine<T, states<States...>, transitions<Rows...>>::can_enter() const noexcept {
+	static constexpr auto reachable = table::reachable();
+	return _current == npos || reachable[_current][index_of<State>()];
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline bool static_state_machine<T, states<States...>, transitions<Rows...>>::enter() {
+	if (!can_enter<State>())
+		return false;
+	transit(index_of<State>());
+	return true;
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename Event>
+inline bool static_state_machine<T, states<States...>, transitions<Rows...>>::send() {
+	constexpr auto event = event_index<Event>();
+	if constexpr (event == npos) {
+		// No state reacts to event, same result as state_machine at runtime
+		return false;
+	} else {
+		static constexpr auto targets = table::targets();
+		if (_current == npos)
+			return false;
+		auto to = targets[_current][event];
+		if (to == npos)
+			return false;
+		transit(to);
+		return true;
+	}
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline State* static_state_machine<T, states<States...>, transitions<Rows...>>::state_for() noexcept {
+	return &std::get<index_of<State>()>(_states);
+}
+
+template <typename T, typename... States, typename... Rows>
+inline T* static_state_machine<T, states<States...>, transitions<Rows...>>::current_state() const noexcept {
+	BOOST_ASSERT(_current != npos);
+	return interface(_current);
+}
+
+template <typename T, typename... States, typename... Rows>
+inline bool static_state_machine<T, states<States...>, transitions<Rows...>>::terminate() {
+	static constexpr hook_type leave[] = { &leave_hook<States>... };
+	if (_current == npos)
+		return false;
+	leave[_current](*this, npos);
+	_current = npos;
+	return true;
+}
+
+template <typename T, typename... States, typename... Rows>
+template <size_t... Is>
+inline void static_state_machine<T, states<States...>, transitions<Rows...>>::bind(std::index_sequence<Is...>) noexcept {
+	_interfaces = { static_cast<T*>(&std::get<Is>(_states))... };
+	auto link = [this](auto& state) {
+		if constexpr (std::is_base_of<detail::static_state_link, std::decay_t<decltype(state)>>::value)
+			static_cast<detail::static_state_link&>(state)._machine = static_cast<void*>(this);
+	};
+	(link(std::get<Is>(_states)), ...);
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline void static_state_machine<T, states<States...>, transitions<Rows...>>::enter_hook(static_state_machine& machine, index_type from) {
+	if constexpr (detail::has_enter<State, T>::value)
+		std::get<State>(machine._states).enter(machine.interface(from));
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline void static_state_machine<T, states<States...>, transitions<Rows...>>::leave_hook(static_state_machine& machine, index_type to) {
+	if constexpr (detail::has_leave<State, T>::value)
+		std::get<State>(machine._states).leave(machine.interface(to));
+}
+
+template <typename T, typename... States, typename... Rows>
+inline void static_state_machine<T, states<States...>, transitions<Rows...>>::transit(index_type to) {
+	static constexpr hook_type enter[] = { &enter_hook<States>... };
+	static constexpr hook_type leave[] = { &leave_hook<States>... };
+	auto from = _current;
+	if (from != npos)
+		leave[from](*this, to);
+	enter[to](*this, from);
+	_current = to;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T, typename... States, typename... Rows>
+inline batched_state_machine<T, states<States...>, transitions<Rows...>>::batched_state_machine() {
+	static_assert(table::template validate<T>());
+	bind(std::index_sequence_for<States...>());
+}
+
+template <typename T, typename... States, typename... Rows>
+inline uint32_t batched_state_machine<T, states<States...>, transitions<Rows...>>::add(size_t count) {
+	auto first = _current.size();
+	_current.resize(first + count, npos);
+	return static_cast<uint32_t>(first);
+}
+
+template <typename T, typename... States, typename... Rows>
+inline void batched_state_machine<T, states<States...>, transitions<Rows...>>::clear() noexcept {
+	_current.clear();
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline size_t batched_state_machine<T, states<States...>, transitions<Rows...>>::enter(const uint8_t* mask) {
+	static constexpr auto column = [] {
+		constexpr auto to = index_of<State>();
+		constexpr auto reachable = table::reachable();
+		column_type column{};
+		for (size_t from = 0; from < state_count; ++from)
+			column[from] = reachable[from][to] ? to : npos;
+		column[state_count] = to;
+		return column;
+	}();
+	return apply(column, mask);
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename Event>
+inline size_t batched_state_machine<T, states<States...>, transitions<Rows...>>::send(const uint8_t* mask) {
+	constexpr auto event = event_index<Event>();
+	if constexpr (event == npos) {
+		return 0;
+	} else {
+		static constexpr auto column = [] {
+			constexpr auto targets = table::targets();
+			column_type column{};
+			for (size_t from = 0; from < state_count; ++from)
+				column[from] = targets[from][event];
+			column[state_count] = npos;
+			return column;
+		}();
+		return apply(column, mask);
+	}
+}
+
+template <typename T, typename... States, typename... Rows>
+inline size_t batched_state_machine<T, states<States...>, transitions<Rows...>>::terminate(const uint8_t* mask) {
+	static constexpr auto column = [] {
+		column_type column{};
+		for (size_t from = 0; from < state_count; ++from)
+			column[from] = terminate_target;
+		column[state_count] = npos;
+		return column;
+	}();
+	return apply(column, mask);
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline bool batched_state_machine<T, states<States...>, transitions<Rows...>>::can_enter(uint32_t instance) const noexcept {
+	static constexpr auto reachable = table::reachable();
+	auto current = current_index(instance);
+	return current == npos || reachable[current][index_of<State>()];
+}
+
+template <typename T, typename... States, typename... Rows>
+inline typename batched_state_machine<T, states<States...>, transitions<Rows...>>::index_type batched_state_machine<T, states<States...>, transitions<Rows...>>::current_index(uint32_t instance) const noexcept {
+	BOOST_ASSERT(instance < size());
+	return _current[instance];
+}
+
+template <typename T, typename... States, typename... Rows>
+inline T* batched_state_machine<T, states<States...>, transitions<Rows...>>::current_state(uint32_t instance) const noexcept {
+	BOOST_ASSERT(!terminated(instance));
+	return interface(current_index(instance));
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline size_t batched_state_machine<T, states<States...>, transitions<Rows...>>::count() const noexcept {
+	return std::count(_current.begin(), _current.end(), index_of<State>());
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline State* batched_state_machine<T, states<States...>, transitions<Rows...>>::state_for() noexcept {
+	return &std::get<index_of<State>()>(_states);
+}
+
+template <typename T, typename... States, typename... Rows>
+constexpr bool batched_state_machine<T, states<States...>, transitions<Rows...>>::has_hooks() noexcept {
+	return ((detail::has_batch_enter<States, T>::value || detail::has_batch_leave<States, T>::value) || ...);
+}
+
+template <typename T, typename... States, typename... Rows>
+template <size_t... Is>
+inline typename batched_state_machine<T, states<States...>, transitions<Rows...>>::index_type batched_state_machine<T, states<States...>, transitions<Rows...>>::select(index_type current, const column_type& column, std::index_sequence<Is...>) noexcept {
+	auto target = column[state_count];
+	((target = current == Is ? column[Is] : target), ...);
+	return target;
+}
+
+template <typename T, typename... States, typename... Rows>
+constexpr auto batched_state_machine<T, states<States...>, transitions<Rows...>>::hooked(const column_type& column) noexcept -> std::array<bool, state_count + 1> {
+	constexpr bool enters[] = { detail::has_batch_enter<States, T>::value..., false };
+	constexpr bool leaves[] = { detail::has_batch_leave<States, T>::value..., false };
+	std::array<bool, state_count + 1> hooked{};
+	for (size_t from = 0; from <= state_count; ++from) {
+		auto to = column[from];
+		hooked[from] = to != npos && (leaves[from] || enters[to < state_count ? to : state_count]);
+	}
+	return hooked;
+}
+
+template <typename T, typename... States, typename... Rows>
+inline size_t batched_state_machine<T, states<States...>, transitions<Rows...>>::apply(const column_type& column, const uint8_t* mask) {
+	auto size = _current.size();
+	auto current = _current.data();
+	
+	// Branchless passes over state indices, compilers vectorize them. Column and
+	// counter are local, stores of bytes would otherwise force reloading them.
+	auto update = [size, current, mask, column](auto masked, auto write, index_type* targets) {
+		size_t changed = 0;
+		for (size_t i = 0; i < size; ++i) {
+			auto target = select(current[i], column, std::make_index_sequence<state_count>());
+			if constexpr (masked)
+				target = mask[i] ? target : npos;
+			changed += target != npos;
+			if constexpr (write)
+				current[i] = target == npos ? current[i] : target == terminate_target ? npos : target;
+			else
+				targets[i] = target;
+		}
+		return changed;
+	};
+	
+	if (!has_hooks()) {
+		return mask ? update(std::true_type(), std::true_type(), nullptr) : update(std::false_type(), std::true_type(), nullptr);
+	}
+	
+	// Hooks see all instances in their states before the event
+	_targets.resize(size);
+	auto targets = _targets.data();
+	auto changed = mask ? update(std::true_type(), std::false_type(), targets) : update(std::false_type(), std::false_type(), targets);
+	if (changed)
+		notify(column);
+	for (size_t i = 0; i < size; ++i)
+		current[i] = targets[i] == npos ? current[i] : targets[i] == terminate_target ? npos : targets[i];
+	return changed;
+}
+
+template <typename T, typename... States, typename... Rows>
+inline void batched_state_machine<T, states<States...>, transitions<Rows...>>::notify(const column_type& column) {
+	static constexpr hook_type enter[] = { &enter_hook<States>... };
+	static constexpr hook_type leave[] = { &leave_hook<States>... };
+	
+	auto groups = hooked(column);
+	if (std::none_of(groups.begin(), groups.end(), [](bool hooked) { return hooked; }))
+		return;
+	
+	// Every group has single target, since it's determined by the current state.
+	// Each hooked group is collected by its own branchless pass, there are few of them.
+	auto size = _current.size();
+	auto current = _current.data();
+	auto targets = _targets.data();
+	for (size_t group = 0; group <= state_count; ++group) {
+		auto&& instances = _groups[group];
+		instances.clear();
+		if (!groups[group])
+			continue;
+		
+		instances.resize(size);
+		auto output = instances.data();
+		auto from = group < state_count ? static_cast<index_type>(group) : npos;
+		size_t count = 0;
+		for (size_t i = 0; i < size; ++i) {
+			output[count] = static_cast<uint32_t>(i);
+			count += current[i] == from && targets[i] != npos;
+		}
+		instances.resize(count);
+	}
+	
+	for (size_t group = 0; group <= state_count; ++group) {
+		auto&& instances = _groups[group];
+		if (instances.empty())
+			continue;
+		
+		instance_batch batch{ instances.data(), instances.data() + instances.size() };
+		auto from = group < state_count ? static_cast<index_type>(group) : npos;
+		auto to = column[group];
+		if (from != npos)
+			leave[from](*this, batch, to);
+		if (to != terminate_target)
+			enter[to](*this, batch, from);
+	}
+}
+
+template <typename T, typename... States, typename... Rows>
+template <size_t... Is>
+inline void batched_state_machine<T, states<States...>, transitions<Rows...>>::bind(std::index_sequence<Is...>) noexcept {
+	_interfaces = { static_cast<T*>(&std::get<Is>(_states))... };
+	auto link = [this](auto& state) {
+		if constexpr (std::is_base_of<detail::static_state_link, std::decay_t<decltype(state)>>::value)
+			static_cast<detail::static_state_link&>(state)._machine = static_cast<void*>(this);
+	};
+	(link(std::get<Is>(_states)), ...);
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline void batched_state_machine<T, states<States...>, transitions<Rows...>>::enter_hook(batched_state_machine& machine, instance_batch instances, index_type from) {
+	if constexpr (detail::has_batch_enter<State, T>::value)
+		std::get<State>(machine._states).enter(instances, machine.interface(from));
+}
+
+template <typename T, typename... States, typename... Rows>
+template <typename State>
+inline void batched_state_machine<T, states<States...>, transitions<Rows...>>::leave_hook(batched_state_machine& machine, instance_batch instances, index_type to) {
+	if constexpr (detail::has_batch_leave<State, T>::value)
+		std::get<State>(machine._states).leave(instances, machine.interface(to));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+inline hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::hierarchical_state_machine() {
+	static_assert(table::template validate<T>());
+	_history.fill(npos);
+	bind(std::index_sequence_for<States...>());
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+template <typename State>
+inline bool hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::can_enter() const noexcept {
+	static constexpr auto targets = table::target_transitions();
+	return _current == npos || targets[_current][index_of<State>()].target != npos;
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+template <typename State>
+inline bool hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::enter() {
+	static constexpr auto targets = table::target_transitions();
+	if (_current == npos) {
+		transit({ index_of<State>(), npos, detail::history_kind::none });
+		return true;
+	}
+	auto&& transition = targets[_current][index_of<State>()];
+	if (transition.target == npos)
+		return false;
+	transit(transition);
+	return true;
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+template <typename Event>
+inline bool hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::send() {
+	constexpr auto event = event_index<Event>();
+	if constexpr (event == npos) {
+		return false;
+	} else {
+		static constexpr auto transitions = table::event_transitions();
+		if (_current == npos)
+			return false;
+		auto&& transition = transitions[_current][event];
+		if (transition.target == npos)
+			return false;
+		transit(transition);
+		return true;
+	}
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+template <typename State>
+inline State* hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::state_for() noexcept {
+	return &std::get<index_of<State>()>(_states);
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+template <typename State>
+inline bool hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::is_in() const noexcept {
+	static constexpr auto ancestors = table::ancestors();
+	static constexpr auto depth = table::depths()[index_of<State>()];
+	return _current != npos && ancestors[_current][depth] == index_of<State>();
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+inline T* hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::current_state() const noexcept {
+	BOOST_ASSERT(_current != npos);
+	return interface(_current);
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+inline bool hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::terminate() {
+	static constexpr auto parents = table::parents();
+	static constexpr hook_type leave[] = { &leave_hook<States>... };
+	if (_current == npos)
+		return false;
+	for (auto state = _current; state != npos; state = parents[state])
+		leave[state](*this, npos);
+	_current = npos;
+	_history.fill(npos);
+	return true;
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+template <size_t... Is>
+inline void hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::bind(std::index_sequence<Is...>) noexcept {
+	_interfaces = { static_cast<T*>(&std::get<Is>(_states))... };
+	auto link = [this](auto& state) {
+		if constexpr (std::is_base_of<detail::static_state_link, std::decay_t<decltype(state)>>::value)
+			static_cast<detail::static_state_link&>(state)._machine = static_cast<void*>(this);
+	};
+	(link(std::get<Is>(_states)), ...);
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+template <typename State>
+inline void hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::enter_hook(hierarchical_state_machine& machine, index_type from) {
+	if constexpr (detail::has_enter<State, T>::value)
+		std::get<State>(machine._states).enter(machine.interface(from));
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+template <typename State>
+inline void hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::leave_hook(hierarchical_state_machine& machine, index_type to) {
+	if constexpr (detail::has_leave<State, T>::value)
+		std::get<State>(machine._states).leave(machine.interface(to));
+}
+
+template <typename T, typename... States, typename... Substates, typename... Rows>
+inline void hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>>::transit(const transition_type& transition) {
+	static constexpr auto parents = table::parents();
+	static constexpr auto initials = table::initials();
+	static constexpr auto depths = table::depths();
+	static constexpr auto ancestors = table::ancestors();
+	static constexpr hook_type enter[] = { &enter_hook<States>... };
+	static constexpr hook_type leave[] = { &leave_hook<States>... };
+	
+	// Left states remember innermost active state for history
+	auto from = _current;
+	auto target = transition.target;
+	for (auto state = from; state != transition.domain; state = parents[state]) {
+		_history[state] = from;
+		leave[state](*this, target);
+	}
+	
+	auto innermost = target;
+	auto remembered = transition.history != detail::history_kind::none ? _history[target] : npos;
+	if (remembered != npos && remembered != target)
+		innermost = transition.history == detail::history_kind::deep ? remembered : ancestors[remembered][depths[target] + 1];
+	
+	size_t depth = transition.domain != npos ? depths[transition.domain] + 1 : 0;
+	for (; depth <= depths[innermost]; ++depth)
+		enter[ancestors[innermost][depth]](*this, from);
+	for (auto initial = initials[innermost]; initial != npos; initial = initials[initial]) {
+		enter[initial](*this, from);
+		innermost = initial;
+	}
+	_current = innermost;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 template <typename Event, typename State, typename = std::enable_if_t<std::is_base_of<state_base, State>::value>>
 inline transition make_transition() noexcept {
 	return std::make_pair(type_id<Event>(), type_id<State>());
@@ -6,11 +6,29 @@
 // Classes in this file:
 //     state
 //     state_machine
+//     states
+//     row
+//     transitions
+//     shallow_history
+//     deep_history
+//     substate
+//     hierarchy
+//     instance_batch
+//     static_state
+//     static_state_machine
+//     batched_state_machine
+//     hierarchical_state_machine
 
 #include <cobalt/utility/type_index.hpp>
 
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace cobalt {
 namespace fsm {
@@ -103,6 +121,497 @@ private:
 	
 };
 
+/// List of states of static state machine
+template <typename... States>
+struct states {};
+
+/// Transition from state `From` to state `To` on event `Event`
+template <typename From, typename Event, typename To>
+struct row {
+	using from_type = From;
+	using event_type = Event;
+	using to_type = To;
+};
+
+/// List of transitions of static state machine
+template <typename... Rows>
+struct transitions {};
+
+/// Target of transition entering substate of `State` which was active when it was left
+///
+/// Initial substate is entered if `State` wasn't left yet.
+template <typename State>
+struct shallow_history {};
+
+/// Target of transition entering all nested substates of `State` which were active when it was left
+template <typename State>
+struct deep_history {};
+
+/// State `Child` is nested in state `Parent`, the first substate of parent is its initial state
+template <typename Child, typename Parent>
+struct substate {
+	using child_type = Child;
+	using parent_type = Parent;
+};
+
+/// Nesting of states of hierarchical state machine
+template <typename... Substates>
+struct hierarchy {};
+
+/// Instances of batched state machine changing state together
+struct instance_batch {
+	const uint32_t* first;
+	const uint32_t* last;
+	
+	const uint32_t* begin() const noexcept { return first; }
+	const uint32_t* end() const noexcept { return last; }
+	size_t size() const noexcept { return last - first; }
+	uint32_t operator[](size_t i) const noexcept { return first[i]; }
+};
+
+template <typename T, typename States, typename Transitions> class static_state_machine;
+template <typename T, typename States, typename Transitions> class batched_state_machine;
+template <typename T, typename States, typename Hierarchy, typename Transitions> class hierarchical_state_machine;
+
+namespace detail {
+
+class static_state_link {
+protected:
+	template <typename, typename, typename> friend class fsm::static_state_machine;
+	template <typename, typename, typename> friend class fsm::batched_state_machine;
+	template <typename, typename, typename, typename> friend class fsm::hierarchical_state_machine;
+	
+	void* _machine = nullptr;
+};
+
+/// Position of the first occurrence of T in Ts, size of Ts if not found
+template <typename T, typename... Ts>
+constexpr size_t type_position() noexcept {
+	constexpr bool matches[] = { std::is_same_v<T, Ts>..., false };
+	for (size_t i = 0; i < sizeof...(Ts); ++i) {
+		if (matches[i])
+			return i;
+	}
+	return sizeof...(Ts);
+}
+
+/// Position of T among distinct types of Ts, size of Ts if not found
+template <typename T, typename... Ts>
+constexpr size_t unique_type_position() noexcept {
+	constexpr size_t firsts[] = { type_position<Ts, Ts...>()..., 0 };
+	auto position = type_position<T, Ts...>();
+	if (position == sizeof...(Ts))
+		return position;
+	
+	size_t unique = 0;
+	for (size_t i = 0; i < position; ++i)
+		unique += firsts[i] == i;
+	return unique;
+}
+
+/// Number of distinct types of Ts
+template <typename... Ts>
+constexpr size_t unique_type_count() noexcept {
+	constexpr size_t firsts[] = { type_position<Ts, Ts...>()..., 0 };
+	size_t unique = 0;
+	for (size_t i = 0; i < sizeof...(Ts); ++i)
+		unique += firsts[i] == i;
+	return unique;
+}
+
+template <typename States, typename Transitions> struct transition_table;
+
+/// Transition table of static state machines built at compile time
+template <typename... States, typename... Rows>
+struct transition_table<states<States...>, transitions<Rows...>> {
+	using index_type = uint8_t;
+	
+	static constexpr index_type npos = static_cast<index_type>(-1);
+	static constexpr size_t state_count = sizeof...(States);
+	/// Number of distinct events of transitions
+	static constexpr size_t event_count = unique_type_count<typename Rows::event_type...>();
+	
+	static_assert(state_count < npos - 1, "Too many states");
+	
+	/// Target state indexed by source state and event
+	using targets_type = std::array<std::array<index_type, event_count>, state_count>;
+	/// Whether target state is reachable from source state
+	using reachable_type = std::array<std::array<bool, state_count>, state_count>;
+	
+	template <typename State> static constexpr index_type index_of() noexcept;
+	/// Index of event, `npos` if there are no transitions on it
+	template <typename Event> static constexpr index_type event_index() noexcept;
+	
+	static constexpr targets_type targets() noexcept;
+	static constexpr reachable_type reachable() noexcept;
+	/// Whether every state has at most one transition on every event
+	static constexpr bool deterministic() noexcept;
+	
+	/// Fails compilation if states or transitions are malformed
+	template <typename T> static constexpr bool validate() noexcept;
+};
+
+enum class history_kind : uint8_t {
+	none,
+	shallow,
+	deep
+};
+
+/// State and history kind of transition target
+template <typename To>
+struct transition_target {
+	using type = To;
+	static constexpr history_kind history = history_kind::none;
+};
+
+template <typename State>
+struct transition_target<shallow_history<State>> {
+	using type = State;
+	static constexpr history_kind history = history_kind::shallow;
+};
+
+template <typename State>
+struct transition_target<deep_history<State>> {
+	using type = State;
+	static constexpr history_kind history = history_kind::deep;
+};
+
+/// Transition of hierarchical state machine resolved for innermost active state
+struct hierarchical_transition {
+	uint8_t target;         ///< Target state, `npos` if there is no transition
+	uint8_t domain;         ///< Innermost state staying active, `npos` if all states are left
+	history_kind history;
+};
+
+/// Parent of every state, `npos` for top level states
+template <typename... States, typename... Substates>
+constexpr std::array<uint8_t, sizeof...(States)> state_parents(states<States...>, hierarchy<Substates...>) noexcept {
+	constexpr size_t count = sizeof...(States);
+	constexpr size_t children[] = { type_position<typename Substates::child_type, States...>()..., count };
+	constexpr size_t parents[] = { type_position<typename Substates::parent_type, States...>()..., count };
+	std::array<uint8_t, count> result{};
+	for (auto&& parent : result)
+		parent = static_cast<uint8_t>(-1);
+	for (size_t i = 0; i < sizeof...(Substates); ++i) {
+		if (children[i] < count && parents[i] < count)
+			result[children[i]] = static_cast<uint8_t>(parents[i]);
+	}
+	return result;
+}
+
+/// Nesting level of every state, levels of states in cycles exceed number of states
+template <typename... States, typename... Substates>
+constexpr std::array<size_t, sizeof...(States)> state_depths(states<States...> s, hierarchy<Substates...> h) noexcept {
+	constexpr size_t count = sizeof...(States);
+	auto parents = state_parents(s, h);
+	std::array<size_t, count> result{};
+	for (size_t i = 0; i < count; ++i) {
+		for (auto parent = parents[i]; parent != static_cast<uint8_t>(-1) && result[i] <= count; parent = parents[parent])
+			++result[i];
+	}
+	return result;
+}
+
+template <typename States, typename Hierarchy, typename Transitions> struct hierarchy_table;
+
+/// Tables of hierarchical state machine built at compile time
+///
+/// Transitions are resolved for every state, so events not handled by state are
+/// looked up in its ancestors only once, at compile time.
+template <typename... States, typename... Substates, typename... Rows>
+struct hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>> {
+	using flat_table = transition_table<states<States...>, transitions<Rows...>>;
+	using index_type = typename flat_table::index_type;
+	using transition_type = hierarchical_transition;
+	
+	static constexpr index_type npos = flat_table::npos;
+	static constexpr size_t state_count = flat_table::state_count;
+	static constexpr size_t event_count = flat_table::event_count;
+	/// Number of nesting levels
+	static constexpr size_t depth_count = [] {
+		size_t count = 1;
+		for (auto depth : state_depths(states<States...>(), hierarchy<Substates...>()))
+			count = depth < count ? count : depth + 1;
+		return count < state_count + 1 ? count : state_count + 1;
+	}();
+	
+	/// State related to every state, `npos` if there is none
+	using states_type = std::array<index_type, state_count>;
+	/// Ancestors of every state by nesting level, the last one is the state itself
+	using ancestors_type = std::array<std::array<index_type, depth_count>, state_count>;
+	/// Transitions indexed by innermost active state and event
+	using event_transitions_type = std::array<std::array<transition_type, event_count>, state_count>;
+	/// Transitions indexed by innermost active state and target state
+	using target_transitions_type = std::array<std::array<transition_type, state_count>, state_count>;
+	
+	template <typename State> static constexpr index_type index_of() noexcept { return flat_table::template index_of<State>(); }
+	template <typename Event> static constexpr index_type event_index() noexcept { return flat_table::template event_index<Event>(); }
+	
+	static constexpr states_type parents() noexcept;
+	/// The first substate of every state
+	static constexpr states_type initials() noexcept;
+	static constexpr states_type depths() noexcept;
+	static constexpr ancestors_type ancestors() noexcept;
+	
+	static constexpr event_transitions_type event_transitions() noexcept;
+	static constexpr target_transitions_type target_transitions() noexcept;
+	
+	/// Fails compilation if states, hierarchy or transitions are malformed
+	template <typename T> static constexpr bool validate() noexcept;
+	
+private:
+	template <size_t Count> using row_type = std::array<transition_type, Count>;
+	
+	/// Table of states without transitions
+	template <size_t Count>
+	static constexpr std::array<row_type<Count>, state_count> empty() noexcept {
+		std::array<row_type<Count>, state_count> table{};
+		for (auto&& row : table) {
+			for (auto&& transition : row)
+				transition = { npos, npos, history_kind::none };
+		}
+		return table;
+	}
+	/// Innermost state staying active in transition from source to target
+	static constexpr index_type domain(const ancestors_type& ancestors, const states_type& depths, index_type source, index_type target) noexcept;
+};
+
+} // namespace detail
+
+/// Optional base of static state which needs access to its machine
+///
+/// `Machine` is static_state_machine, batched_state_machine, hierarchical_state_machine
+/// or a class derived from them.
+template <typename Machine>
+class static_state : public detail::static_state_link {
+public:
+	Machine* machine() const noexcept;
+};
+
+/// State machine with transition table built at compile time
+///
+/// States are stored by value and derive from `T`. Current state is an index and
+/// sending event is a lookup in constant table of state and event indices followed
+/// by calls of `leave(T* to)` and `enter(T* from)` of the states, which are
+/// optional and don't have to be virtual. Behaves the same as `state_machine`.
+template <typename T, typename... States, typename... Rows>
+class static_state_machine<T, states<States...>, transitions<Rows...>> {
+	using table = detail::transition_table<states<States...>, transitions<Rows...>>;
+	
+public:
+	using machine_type = static_state_machine;
+	using index_type = typename table::index_type;
+	
+	static constexpr index_type npos = table::npos;
+	static constexpr size_t state_count = table::state_count;
+	static constexpr size_t event_count = table::event_count;
+	
+	static_state_machine();
+	
+	static_state_machine(const static_state_machine&) = delete;
+	static_state_machine& operator=(const static_state_machine&) = delete;
+	
+	template <typename State> bool can_enter() const noexcept;
+	template <typename State> bool enter();
+	/// Returns false if current state has no transition on event
+	///
+	/// Events absent from the table compile to `return false` like in `state_machine`,
+	/// `event_index<Event>() != npos` checks them at compile time.
+	template <typename Event> bool send();
+	template <typename State> State* state_for() noexcept;
+	
+	T* current_state() const noexcept;
+	/// Index of current state, `npos` if terminated
+	index_type current_index() const noexcept { return _current; }
+	
+	bool terminated() const noexcept { return _current == npos; }
+	bool terminate();
+	
+	template <typename State> static constexpr index_type index_of() noexcept { return table::template index_of<State>(); }
+	/// Index of event, `npos` if there are no transitions on it
+	template <typename Event> static constexpr index_type event_index() noexcept { return table::template event_index<Event>(); }
+	
+private:
+	using hook_type = void (*)(static_state_machine& machine, index_type other);
+	
+	template <size_t... Is> void bind(std::index_sequence<Is...>) noexcept;
+	template <typename State> static void enter_hook(static_state_machine& machine, index_type from);
+	template <typename State> static void leave_hook(static_state_machine& machine, index_type to);
+	
+	void transit(index_type to);
+	
+	T* interface(index_type index) const noexcept { return index != npos ? _interfaces[index] : nullptr; }
+	
+	std::tuple<States...> _states;
+	std::array<T*, state_count> _interfaces;
+	index_type _current = npos;
+};
+
+/// Many instances of static state machine sharing state objects
+///
+/// Current states of instances are kept in contiguous array of indices. Events are
+/// applied to all instances, or to those selected by mask, in branchless passes
+/// over the array. States may have optional hooks `leave(instance_batch, T* to)`
+/// and `enter(instance_batch, T* from)`, which are called once per group of
+/// instances moving from the same state, before any instance changes its state.
+/// Instances are grouped only for transitions which have hooks.
+template <typename T, typename... States, typename... Rows>
+class batched_state_machine<T, states<States...>, transitions<Rows...>> {
+	using table = detail::transition_table<states<States...>, transitions<Rows...>>;
+	
+public:
+	using machine_type = batched_state_machine;
+	using index_type = typename table::index_type;
+	
+	static constexpr index_type npos = table::npos;
+	static constexpr size_t state_count = table::state_count;
+	static constexpr size_t event_count = table::event_count;
+	
+	batched_state_machine();
+	
+	batched_state_machine(const batched_state_machine&) = delete;
+	batched_state_machine& operator=(const batched_state_machine&) = delete;
+	
+	/// Adds terminated instances, returns index of the first one
+	uint32_t add(size_t count = 1);
+	/// Removes all instances without notifying states
+	void clear() noexcept;
+	
+	size_t size() const noexcept { return _current.size(); }
+	bool empty() const noexcept { return _current.empty(); }
+	
+	/// Enters state in instances which can enter it, returns number of them
+	///
+	/// Instances are selected by nonzero `mask` entries, all instances if it is null.
+	template <typename State> size_t enter(const uint8_t* mask = nullptr);
+	/// Sends event to instances, returns number of instances which changed state
+	template <typename Event> size_t send(const uint8_t* mask = nullptr);
+	/// Terminates instances, returns number of instances which were not terminated
+	size_t terminate(const uint8_t* mask = nullptr);
+	
+	template <typename State> bool can_enter(uint32_t instance) const noexcept;
+	bool terminated(uint32_t instance) const noexcept { return current_index(instance) == npos; }
+	
+	/// Index of current state of instance, `npos` if terminated
+	index_type current_index(uint32_t instance) const noexcept;
+	T* current_state(uint32_t instance) const noexcept;
+	/// Current state indices of all instances
+	const index_type* data() const noexcept { return _current.data(); }
+	
+	/// Number of instances in state
+	template <typename State> size_t count() const noexcept;
+	
+	/// State object shared by all instances
+	template <typename State> State* state_for() noexcept;
+	
+	template <typename State> static constexpr index_type index_of() noexcept { return table::template index_of<State>(); }
+	template <typename Event> static constexpr index_type event_index() noexcept { return table::template event_index<Event>(); }
+	
+private:
+	/// Target which terminates instance, `npos` target keeps current state
+	static constexpr index_type terminate_target = static_cast<index_type>(state_count);
+	
+	/// Target for every current state, the last one is target of terminated instances
+	using column_type = std::array<index_type, state_count + 1>;
+	using hook_type = void (*)(batched_state_machine& machine, instance_batch instances, index_type other);
+	
+	static constexpr bool has_hooks() noexcept;
+	/// Whether transitions of instances in state, or terminated ones, call hooks
+	static constexpr std::array<bool, state_count + 1> hooked(const column_type& column) noexcept;
+	
+	template <size_t... Is>
+	static index_type select(index_type current, const column_type& column, std::index_sequence<Is...>) noexcept;
+	/// Computes targets of instances and moves them, returns number of instances changing state
+	size_t apply(const column_type& column, const uint8_t* mask);
+	
+	template <size_t... Is> void bind(std::index_sequence<Is...>) noexcept;
+	template <typename State> static void enter_hook(batched_state_machine& machine, instance_batch instances, index_type from);
+	template <typename State> static void leave_hook(batched_state_machine& machine, instance_batch instances, index_type to);
+	
+	/// Calls hooks for groups of instances which move to their targets
+	void notify(const column_type& column);
+	
+	T* interface(index_type index) const noexcept { return index < state_count ? _interfaces[index] : nullptr; }
+	
+	std::tuple<States...> _states;
+	std::array<T*, state_count> _interfaces;
+	std::vector<index_type> _current;
+	std::vector<index_type> _targets;   ///< Scratch targets of current operation
+	std::array<std::vector<uint32_t>, state_count + 1> _groups;    ///< Scratch instances grouped by current state
+};
+
+/// Static state machine with nested states
+///
+/// Active states are the current innermost state and all its ancestors. Events not
+/// handled by the current state are handled by the nearest ancestor which has
+/// transition on them. Entered state enters its initial substates down to innermost
+/// one, or the remembered ones if transition targets its `shallow_history` or
+/// `deep_history`. Transition leaves active states up to the innermost common
+/// ancestor of its source and target, states are left from inner to outer ones and
+/// entered from outer to inner ones with the same hooks as `static_state_machine`.
+///
+/// Transitions are resolved through ancestors at compile time, so sending event is
+/// single lookup, and moving between states walks arrays of parents and ancestors
+/// bounded by nesting depth.
+template <typename T, typename... States, typename... Substates, typename... Rows>
+class hierarchical_state_machine<T, states<States...>, hierarchy<Substates...>, transitions<Rows...>> {
+	using table = detail::hierarchy_table<states<States...>, hierarchy<Substates...>, transitions<Rows...>>;
+	
+public:
+	using machine_type = hierarchical_state_machine;
+	using index_type = typename table::index_type;
+	
+	static constexpr index_type npos = table::npos;
+	static constexpr size_t state_count = table::state_count;
+	static constexpr size_t event_count = table::event_count;
+	/// Number of nesting levels
+	static constexpr size_t depth_count = table::depth_count;
+	
+	hierarchical_state_machine();
+	
+	hierarchical_state_machine(const hierarchical_state_machine&) = delete;
+	hierarchical_state_machine& operator=(const hierarchical_state_machine&) = delete;
+	
+	/// Whether machine is terminated or any active state has transition to state
+	template <typename State> bool can_enter() const noexcept;
+	template <typename State> bool enter();
+	template <typename Event> bool send();
+	template <typename State> State* state_for() noexcept;
+	
+	/// Whether state is current state or its ancestor
+	template <typename State> bool is_in() const noexcept;
+	
+	/// Innermost active state
+	T* current_state() const noexcept;
+	/// Index of innermost active state, `npos` if terminated
+	index_type current_index() const noexcept { return _current; }
+	
+	bool terminated() const noexcept { return _current == npos; }
+	/// Leaves all active states and forgets history
+	bool terminate();
+	
+	template <typename State> static constexpr index_type index_of() noexcept { return table::template index_of<State>(); }
+	/// Index of event, `npos` if there are no transitions on it
+	template <typename Event> static constexpr index_type event_index() noexcept { return table::template event_index<Event>(); }
+	
+private:
+	using transition_type = typename table::transition_type;
+	using hook_type = void (*)(hierarchical_state_machine& machine, index_type other);
+	
+	template <size_t... Is> void bind(std::index_sequence<Is...>) noexcept;
+	template <typename State> static void enter_hook(hierarchical_state_machine& machine, index_type from);
+	template <typename State> static void leave_hook(hierarchical_state_machine& machine, index_type to);
+	
+	void transit(const transition_type& transition);
+	
+	T* interface(index_type index) const noexcept { return index != npos ? _interfaces[index] : nullptr; }
+	
+	std::tuple<States...> _states;
+	std::array<T*, state_count> _interfaces;
+	std::array<index_type, state_count> _history;  ///< Innermost active state when state was left
+	index_type _current = npos;
+};
+
 } // namespace fsm
 } // namespace cobalt
 
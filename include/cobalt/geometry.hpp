@@ -3,6 +3,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <type_traits>
 #include <ostream>
 
@@ -10,6 +13,13 @@
 //     basic_point<>
 //     basic_size<>
 //     basic_rect<>
+//     vec3
+//     quat
+//     mat4
+//     aabb
+//     ray
+//     plane
+//     frustum
 
 namespace cobalt {
 
@@ -172,6 +182,261 @@ struct basic_rect {
 using rect = basic_rect<int>;
 using rectf = basic_rect<float>;
 
+struct vec3 {
+	float x = 0;
+	float y = 0;
+	float z = 0;
+	
+	constexpr vec3() noexcept = default;
+	constexpr vec3(float x, float y, float z) noexcept
+		: x(x), y(y), z(z) {}
+	
+	friend bool operator==(const vec3& lhs, const vec3& rhs) noexcept {
+		return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+	}
+	
+	friend bool operator!=(const vec3& lhs, const vec3& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+	
+	friend constexpr vec3 operator+(const vec3& lhs, const vec3& rhs) noexcept { return {lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z}; }
+	friend constexpr vec3 operator-(const vec3& lhs, const vec3& rhs) noexcept { return {lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z}; }
+	friend constexpr vec3 operator*(const vec3& v, float s) noexcept { return {v.x * s, v.y * s, v.z * s}; }
+	
+	template <typename CharT>
+	friend std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os, const vec3& v) {
+		os << '{' << v.x << ';' << v.y << ';' << v.z << '}';
+		return os;
+	}
+};
+
+/// Rotation quaternion
+struct quat {
+	float w = 1;
+	float x = 0;
+	float y = 0;
+	float z = 0;
+	
+	constexpr quat() noexcept = default;
+	constexpr quat(float w, float x, float y, float z) noexcept
+		: w(w), x(x), y(y), z(z) {}
+	
+	/// Rotation by `angle` radians around normalized `axis`
+	static quat angle_axis(float angle, const vec3& axis) noexcept {
+		auto s = std::sin(angle * 0.5f);
+		return {std::cos(angle * 0.5f), axis.x * s, axis.y * s, axis.z * s};
+	}
+	
+	friend bool operator==(const quat& lhs, const quat& rhs) noexcept {
+		return lhs.w == rhs.w && lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+	}
+	
+	friend bool operator!=(const quat& lhs, const quat& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+	
+	friend constexpr quat operator*(const quat& a, const quat& b) noexcept {
+		return {
+			a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+			a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+			a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+			a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w
+		};
+	}
+};
+
+/// 4x4 matrix of affine transform
+///
+/// Column-major, `m[column][row]`, the same layout OpenGL and glm use.
+struct mat4 {
+	float m[4][4] = {
+		{1, 0, 0, 0},
+		{0, 1, 0, 0},
+		{0, 0, 1, 0},
+		{0, 0, 0, 1}
+	};
+	
+	constexpr mat4() noexcept = default;
+	
+	static constexpr mat4 identity() noexcept { return {}; }
+	
+	/// Translation * rotation * scale
+	static mat4 compose(const vec3& translation, const quat& rotation, const vec3& scale) noexcept {
+		auto&& q = rotation;
+		auto xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		auto xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		auto wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+		
+		mat4 r;
+		r.m[0][0] = (1 - 2 * (yy + zz)) * scale.x;
+		r.m[0][1] = (2 * (xy + wz)) * scale.x;
+		r.m[0][2] = (2 * (xz - wy)) * scale.x;
+		r.m[1][0] = (2 * (xy - wz)) * scale.y;
+		r.m[1][1] = (1 - 2 * (xx + zz)) * scale.y;
+		r.m[1][2] = (2 * (yz + wx)) * scale.y;
+		r.m[2][0] = (2 * (xz + wy)) * scale.z;
+		r.m[2][1] = (2 * (yz - wx)) * scale.z;
+		r.m[2][2] = (1 - 2 * (xx + yy)) * scale.z;
+		r.m[3][0] = translation.x;
+		r.m[3][1] = translation.y;
+		r.m[3][2] = translation.z;
+		return r;
+	}
+	
+	const float* data() const noexcept { return &m[0][0]; }
+	
+	vec3 transform_point(const vec3& p) const noexcept {
+		return {
+			m[0][0] * p.x + m[1][0] * p.y + m[2][0] * p.z + m[3][0],
+			m[0][1] * p.x + m[1][1] * p.y + m[2][1] * p.z + m[3][1],
+			m[0][2] * p.x + m[1][2] * p.y + m[2][2] * p.z + m[3][2]
+		};
+	}
+	
+	friend mat4 operator*(const mat4& a, const mat4& b) noexcept {
+		mat4 r;
+		for (int c = 0; c < 4; ++c) {
+			for (int i = 0; i < 4; ++i)
+				r.m[c][i] = a.m[0][i] * b.m[c][0] + a.m[1][i] * b.m[c][1] + a.m[2][i] * b.m[c][2] + a.m[3][i] * b.m[c][3];
+		}
+		return r;
+	}
+	
+	friend bool operator==(const mat4& lhs, const mat4& rhs) noexcept {
+		for (int c = 0; c < 4; ++c) {
+			for (int i = 0; i < 4; ++i) {
+				if (lhs.m[c][i] != rhs.m[c][i])
+					return false;
+			}
+		}
+		return true;
+	}
+	
+	friend bool operator!=(const mat4& lhs, const mat4& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+};
+
+/// Axis-aligned bounding box, empty by default
+struct aabb {
+	vec3 min{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	vec3 max{ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+	
+	constexpr aabb() noexcept = default;
+	constexpr aabb(const vec3& min, const vec3& max) noexcept
+		: min(min), max(max) {}
+	
+	bool empty() const noexcept { return min.x > max.x || min.y > max.y || min.z > max.z; }
+	
+	vec3 center() const noexcept { return (min + max) * 0.5f; }
+	vec3 extent() const noexcept { return max - min; }
+	
+	/// Half of surface area, cost metric of bounding volume hierarchies
+	float half_area() const noexcept {
+		auto e = extent();
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+	
+	bool contains(const aabb& b) const noexcept {
+		return min.x <= b.min.x && min.y <= b.min.y && min.z <= b.min.z
+			&& b.max.x <= max.x && b.max.y <= max.y && b.max.z <= max.z;
+	}
+	
+	bool intersects(const aabb& b) const noexcept {
+		return min.x <= b.max.x && b.min.x <= max.x
+			&& min.y <= b.max.y && b.min.y <= max.y
+			&& min.z <= b.max.z && b.min.z <= max.z;
+	}
+	
+	aabb inflated(float margin) const noexcept {
+		return { min - vec3(margin, margin, margin), max + vec3(margin, margin, margin) };
+	}
+	
+	friend aabb merge(const aabb& a, const aabb& b) noexcept {
+		return {
+			{ std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z) },
+			{ std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z) }
+		};
+	}
+	
+	friend bool operator==(const aabb& lhs, const aabb& rhs) noexcept { return lhs.min == rhs.min && lhs.max == rhs.max; }
+	friend bool operator!=(const aabb& lhs, const aabb& rhs) noexcept { return !(lhs == rhs); }
+};
+
+struct ray {
+	vec3 origin;
+	vec3 direction;
+	
+	/// Distance along ray to the entry point of box, or negative value if ray misses it within `max_distance`
+	float intersect(const aabb& box, float max_distance = std::numeric_limits<float>::max()) const noexcept {
+		float t_min = 0, t_max = max_distance;
+		const float o[] = { origin.x, origin.y, origin.z };
+		const float d[] = { direction.x, direction.y, direction.z };
+		const float lo[] = { box.min.x, box.min.y, box.min.z };
+		const float hi[] = { box.max.x, box.max.y, box.max.z };
+		for (int i = 0; i < 3; ++i) {
+			if (d[i] == 0) {
+				if (o[i] < lo[i] || o[i] > hi[i])
+					return -1;
+				continue;
+			}
+			auto inv = 1 / d[i];
+			auto t0 = (lo[i] - o[i]) * inv;
+			auto t1 = (hi[i] - o[i]) * inv;
+			if (t0 > t1)
+				std::swap(t0, t1);
+			t_min = std::max(t_min, t0);
+			t_max = std::min(t_max, t1);
+			if (t_min > t_max)
+				return -1;
+		}
+		return t_min;
+	}
+};
+
+/// Plane of points p with dot(normal, p) + d == 0, normal points to positive half-space
+struct plane {
+	vec3 normal;
+	float d = 0;
+	
+	float distance(const vec3& p) const noexcept { return normal.x * p.x + normal.y * p.y + normal.z * p.z + d; }
+};
+
+/// Convex volume bounded by planes facing inwards
+struct frustum {
+	plane planes[6];
+	
+	/// Frustum of projection * view matrix
+	static frustum from_matrix(const mat4& m) noexcept {
+		auto row = [&](int r) { return plane{ { m.m[0][r], m.m[1][r], m.m[2][r] }, m.m[3][r] }; };
+		auto add = [](const plane& a, const plane& b, float sign) {
+			return plane{ { a.normal.x + sign * b.normal.x, a.normal.y + sign * b.normal.y, a.normal.z + sign * b.normal.z }, a.d + sign * b.d };
+		};
+		auto w = row(3);
+		frustum f;
+		for (int i = 0; i < 3; ++i) {
+			f.planes[2 * i] = add(w, row(i), 1);
+			f.planes[2 * i + 1] = add(w, row(i), -1);
+		}
+		return f;
+	}
+	
+	/// Conservative test, may report boxes near frustum corners as intersecting
+	bool intersects(const aabb& box) const noexcept {
+		for (auto&& p : planes) {
+			// Box corner farthest along plane normal
+			vec3 v{
+				p.normal.x >= 0 ? box.max.x : box.min.x,
+				p.normal.y >= 0 ? box.max.y : box.min.y,
+				p.normal.z >= 0 ? box.max.z : box.min.z
+			};
+			if (p.distance(v) < 0)
+				return false;
+		}
+		return true;
+	}
+};
+
 } // namespace cobalt
 
 #endif // COBALT_GEOMETRY_HPP_INCLUDED
@@ -557,7 +557,7 @@ inline stream_holder::stream_holder(stream& stream)
 {
 }
 
-stream_holder::stream_holder(stream* stream)
+inline stream_holder::stream_holder(stream* stream)
 	: _stream(stream)
 	, _owning(true)
 {
@@ -566,7 +566,7 @@ stream_holder::stream_holder(stream* stream)
 		retain(_stream);
 }
 
-stream_holder::~stream_holder() {
+inline stream_holder::~stream_holder() {
 	if (_stream && _owning)
 		release(_stream);
 }
@@ -1252,7 +1252,7 @@ inline bit_writer::bit_writer(stream* stream) noexcept
 
 inline bit_writer::~bit_writer() {
 	std::error_code ec;
-	write_align(ec);
+	flush(ec);
 	BOOST_ASSERT(!ec);
 }
 
@@ -1263,11 +1263,13 @@ inline void bit_writer::write_bits(uint32_t value, int bits, std::error_code& ec
 		return;
 	}
 
-	_scratch |= static_cast<uint64_t>(value & ((1 << bits) - 1)) << _scratch_bits;
+	_scratch |= (value & ((uint64_t(1) << bits) - 1)) << _scratch_bits;
 	_scratch_bits += bits;
 
 	if (_scratch_bits >= 32) {
-		_writer.write(static_cast<uint32_t>(_scratch & 0xffffffff), ec);
+		// Bits are read back byte by byte starting from the lowest one
+		auto word = boost::endian::native_to_little(static_cast<uint32_t>(_scratch & 0xffffffff));
+		_writer.base_stream()->write(&word, sizeof(word), ec);
 		_scratch >>= 32;
 		_scratch_bits -= 32;
 	}
@@ -1286,8 +1288,12 @@ inline void bit_writer::write_align(std::error_code& ec) noexcept {
 }
 
 inline void bit_writer::flush(std::error_code& ec) noexcept {
+	write_align(ec);
+	if (ec)
+		return;
+	
 	if (_scratch_bits > 0) {
-		int bytes = (_scratch_bits >> 3) + ((_scratch_bits & 0x7) ? 1 : 0);
+		int bytes = _scratch_bits >> 3;
 		for (int i = 0; i < bytes; ++i, _scratch >>= 8, _scratch_bits -= 8) {
 			_writer.write(static_cast<uint8_t>(_scratch & 0xff), ec);
 			if (ec)
@@ -1345,11 +1351,13 @@ inline uint32_t bit_reader::read_bits(int bits, std::error_code& ec) noexcept {
 
 	while (_scratch_bits < bits) {
 		auto value = _reader.read_uint8(ec);
-		_scratch |= value << _scratch_bits;
+		if (ec)
+			return 0;
+		_scratch |= static_cast<uint64_t>(value) << _scratch_bits;
 		_scratch_bits += 8;
 	}
 
-	uint32_t value = _scratch & ((1 << bits) - 1);
+	uint32_t value = _scratch & ((uint64_t(1) << bits) - 1);
 
 	_scratch >>= bits;
 	_scratch_bits -= bits;
@@ -1427,6 +1435,14 @@ struct bits_required {
 	};
 };
 
+/// Number of bits required to store values in [min, max] range
+constexpr int bits_required_for(int64_t min, int64_t max) noexcept {
+	int bits = 0;
+	for (auto range = static_cast<uint64_t>(max - min); range; range >>= 1)
+		++bits;
+	return bits;
+}
+
 }} // namespace cobalt::io
 
 #endif // COBALT_IO_HPP_INCLUDED
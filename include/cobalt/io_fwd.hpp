@@ -306,7 +306,16 @@ public:
 	std::string read_pascal_string(); // length prepended string
 };
 
-/// Bit packed stream writer
+/// Version of bit packed stream layout
+///
+/// Bits are packed starting from the lowest bit of the first byte, a value
+/// spans bytes from its lowest bits to its highest ones. Streams have no header,
+/// so callers storing them keep the version with their data. Version 1 stored
+/// every complete 32 bits as a big-endian word, which bit_reader couldn't read
+/// back, such streams have to be written again.
+constexpr uint32_t bit_stream_version = 2;
+
+/// Bit packed stream writer, see `bit_stream_version` for layout
 class bit_writer {
 public:
 	explicit bit_writer(stream& stream) noexcept;
@@ -320,7 +329,7 @@ public:
 	void write_bits(uint32_t value, int bits, std::error_code& ec) noexcept;
 	/// Write scratched bits to stream and align bit position to byte boundary
 	void write_align(std::error_code& ec) noexcept;
-	/// Flush scratched bits to stream
+	/// Write scratched bits to stream padding the last byte with zeros, called by destructor
 	void flush(std::error_code& ec) noexcept;
 	
 	void write_bits(uint32_t value, int bits);
@@ -333,7 +342,7 @@ private:
 	int _scratch_bits = 0;
 };
 
-/// Bit packed stream reader
+/// Bit packed stream reader, see `bit_stream_version` for layout
 class bit_reader {
 public:
 	explicit bit_reader(stream& stream) noexcept;
@@ -0,0 +1,216 @@
+#ifndef COBALT_JOBS_HPP_INCLUDED
+#define COBALT_JOBS_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     job_graph
+//     thread_pool
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cobalt {
+
+///
+/// Set of jobs with dependencies between them
+///
+/// Every job is split into chunks which may run concurrently. Job starts only
+/// after all jobs it depends on are complete.
+///
+class job_graph {
+public:
+	using job_id = size_t;
+	using function_type = std::function<void(size_t chunk)>;
+
+	/// Adds job of `chunks` calls of `function(chunk)`
+	job_id add(size_t chunks, function_type function) {
+		_jobs.push_back({ std::move(function), chunks });
+		return _jobs.size() - 1;
+	}
+
+	/// Makes `job` wait for completion of `dependency`, which must be added earlier
+	void depend(job_id job, job_id dependency) {
+		BOOST_ASSERT(dependency < job && job < _jobs.size());
+		_jobs[dependency].dependents.push_back(job);
+		++_jobs[job].dependencies;
+	}
+
+	size_t size() const noexcept { return _jobs.size(); }
+	bool empty() const noexcept { return _jobs.empty(); }
+
+	void clear() noexcept { _jobs.clear(); }
+
+private:
+	friend class thread_pool;
+
+	struct job {
+		function_type function;
+		size_t chunks;
+		std::vector<job_id> dependents;
+		size_t dependencies = 0;
+		size_t remaining = 0;       ///< Dependencies while waiting, chunks once started
+	};
+
+	std::vector<job> _jobs;
+};
+
+///
+/// Fixed set of worker threads running job graphs
+///
+/// Thread calling `run` works on the graph too, so pool without workers just
+/// runs jobs serially in dependency order.
+///
+class thread_pool {
+public:
+	explicit thread_pool(size_t workers = default_workers()) {
+		_threads.reserve(workers);
+		for (size_t i = 0; i < workers; ++i)
+			_threads.emplace_back([this] { work(); });
+	}
+
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_wake.notify_all();
+		for (auto&& thread : _threads)
+			thread.join();
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	/// Number of threads running jobs including the calling one
+	size_t concurrency() const noexcept { return _threads.size() + 1; }
+
+	/// Runs all jobs of graph and waits for their completion
+	///
+	/// If any chunk throws, the rest of the graph still runs and the first exception is rethrown.
+	void run(job_graph& graph);
+
+	static size_t default_workers() noexcept {
+		auto n = std::thread::hardware_concurrency();
+		return n > 1 ? n - 1 : 0;
+	}
+
+private:
+	struct work_item {
+		job_graph::job* job;
+		size_t chunk;
+	};
+
+	void work();
+	void execute(std::unique_lock<std::mutex>& lock);
+	void start(job_graph::job& job);
+	void complete(job_graph::job& job);
+
+	std::vector<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::vector<work_item> _queue;
+	job_graph* _graph = nullptr;
+	size_t _pending = 0;                ///< Jobs of current graph not complete yet
+	std::exception_ptr _error;
+	bool _stopping = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// thread_pool
+//
+
+inline void thread_pool::run(job_graph& graph) {
+	if (graph.empty())
+		return;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	BOOST_ASSERT_MSG(!_graph, "thread pool runs one graph at a time");
+	_graph = &graph;
+	_pending = graph._jobs.size();
+	_error = nullptr;
+
+	for (auto&& job : graph._jobs)
+		job.remaining = job.dependencies;
+	for (auto&& job : graph._jobs) {
+		if (!job.dependencies)
+			start(job);
+	}
+
+	while (_pending) {
+		_wake.wait(lock, [this] { return !_pending || !_queue.empty(); });
+		if (!_queue.empty())
+			execute(lock);
+	}
+
+	_graph = nullptr;
+	if (auto error = std::exchange(_error, nullptr))
+		std::rethrow_exception(error);
+}
+
+inline void thread_pool::work() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;) {
+		_wake.wait(lock, [this] { return _stopping || !_queue.empty(); });
+		if (_stopping)
+			return;
+		execute(lock);
+	}
+}
+
+inline void thread_pool::execute(std::unique_lock<std::mutex>& lock) {
+	auto item = _queue.back();
+	_queue.pop_back();
+
+	lock.unlock();
+	std::exception_ptr error;
+	try {
+		item.job->function(item.chunk);
+	} catch (...) {
+		error = std::current_exception();
+	}
+	lock.lock();
+
+	if (error && !_error)
+		_error = error;
+	if (!--item.job->remaining)
+		complete(*item.job);
+}
+
+inline void thread_pool::start(job_graph::job& job) {
+	if (!job.chunks) {
+		complete(job);
+		return;
+	}
+
+	job.remaining = job.chunks;
+	// Reversed, so chunks are taken from the back of the queue in order
+	for (size_t i = job.chunks; i--; )
+		_queue.push_back({ &job, i });
+	if (job.chunks > 1)
+		_wake.notify_all();
+	else
+		_wake.notify_one();
+}
+
+inline void thread_pool::complete(job_graph::job& job) {
+	for (auto dependent : job.dependents) {
+		auto&& next = _graph->_jobs[dependent];
+		if (!--next.remaining)
+			start(next);
+	}
+	if (!--_pending)
+		_wake.notify_all();
+}
+
+} // namespace cobalt
+
+#endif // COBALT_JOBS_HPP_INCLUDED
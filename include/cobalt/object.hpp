@@ -5,20 +5,24 @@
 
 // Classes in this file:
 //     object
+//     object_pool
 
 #include <cobalt/utility/intrusive.hpp>
 #include <cobalt/utility/type_index.hpp>
 #include <cobalt/utility/identifier.hpp>
 #include <cobalt/utility/factory.hpp>
 
+#include <atomic>
 #include <type_traits>
+#include <typeinfo>
+#include <vector>
 
 namespace cobalt {
 
 ///
 /// Object
 ///
-class object : public local_ref_counter<object> {
+class object {
 public:
 	object() = default;
 	
@@ -32,14 +36,119 @@ public:
 	const identifier& name() const noexcept { return _name; }
 	void name(const identifier& name) noexcept { _name = name; }
 	
+	/// Creator of instances of one type, resolved once for code creating many of them
+	using instance_creator = auto_factory<object(), type_index>::creator_handle;
+	
 	static object* create_instance(const type_index& type);
+	static object* create_instance(instance_creator creator);
 	template <typename T> static T* create_instance();
 	
+	/// Returns null if type is not registered
+	static instance_creator find_creator(const type_index& type) noexcept;
+	
+	/// Call after static initialization to make `create_instance` lookups lock-free
+	static void freeze_types();
+	
+	unsigned int use_count() const noexcept { return _ref_count; }
+	
+	/// Called when released object is put into pool, should release resources and references
+	virtual void reset() noexcept { _name = identifier(); }
+	/// Called when pooled object is handed out by `create_instance`
+	virtual void reuse() noexcept {}
+	
+	friend void intrusive_ptr_add_ref(const object* p) noexcept { ++p->_ref_count; }
+	friend void intrusive_ptr_release(const object* p) noexcept {
+		if (!--p->_ref_count)
+			const_cast<object*>(p)->recycle();
+	}
+	
 protected:
 	using object_factory = auto_factory<object(), type_index>;
 	
+	/// Disposes object once the last reference is released
+	virtual void recycle() noexcept { delete this; }
+	
 private:
 	identifier _name;
+	mutable unsigned int _ref_count = 0;
+};
+
+/// Counters of object pool
+struct object_pool_stats {
+	size_t hits = 0;        ///< Instances taken from pool
+	size_t misses = 0;      ///< Instances allocated because pool was empty
+	size_t recycled = 0;    ///< Released instances put into pool
+	size_t discarded = 0;   ///< Released instances deleted because pool was full
+};
+
+///
+/// Recycling pool of objects of type T
+///
+/// Pools are disabled until capacity is set. Released objects of enabled pool are
+/// reset and kept per thread, `create_instance` hands them out before allocating
+/// new ones. Every class with IMPLEMENT_OBJECT_TYPE has its own pool.
+///
+template <typename T>
+class object_pool {
+public:
+	/// Sets maximum number of instances kept by each thread, zero disables pooling
+	static void capacity(size_t capacity) noexcept { shared().capacity.store(capacity, std::memory_order_relaxed); }
+	static size_t capacity() noexcept { return shared().capacity.load(std::memory_order_relaxed); }
+	
+	/// Number of instances kept by the current thread
+	static size_t size() noexcept { return local().objects.size(); }
+	
+	/// Fills pool of the current thread up to `count` instances
+	static void prewarm(size_t count);
+	
+	/// Deletes instances kept by the current thread
+	static void clear() noexcept { local().clear(); }
+	
+	static object_pool_stats stats() noexcept;
+	static void reset_stats() noexcept;
+	
+	template <typename... Args>
+	static T* acquire(Args&&... args);
+	static void release(T* p) noexcept;
+	
+private:
+	struct counters {
+		std::atomic<size_t> capacity{0};
+		std::atomic<size_t> hits{0};
+		std::atomic<size_t> misses{0};
+		std::atomic<size_t> recycled{0};
+		std::atomic<size_t> discarded{0};
+	};
+	
+	struct freelist {
+		~freelist() { clear(); }
+	
+		void clear() noexcept {
+			for (auto p : objects)
+				delete p;
+			objects.clear();
+		}
+	
+		std::vector<T*> objects;
+	};
+	
+	static counters& shared() noexcept {
+		// Intentionally leaked, thread freelists may be destroyed after static objects
+		static counters* c = new counters;
+		return *c;
+	}
+	
+	static freelist& local() noexcept {
+		static thread_local freelist f;
+		return f;
+	}
+};
+
+/// Objects created by factories are taken from their pools
+template <typename T>
+struct factory_construct<T, std::enable_if_t<std::is_base_of_v<object, T>>> {
+	template <typename... Args>
+	static T* create(Args&&... args) { return object_pool<T>::acquire(std::forward<Args>(args)...); }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -50,15 +159,113 @@ inline object* object::create_instance(const type_index& type) {
 	return object_factory::create(type);
 }
 
+inline object* object::create_instance(instance_creator creator) {
+	return object_factory::create(creator);
+}
+
 template <typename T>
 inline T* object::create_instance() {
 	static_assert(std::is_base_of<object, T>::value, "T is not derived from object");
 	return static_cast<T*>(object_factory::create(T::class_type()));
 }
 
+inline object::instance_creator object::find_creator(const type_index& type) noexcept {
+	return object_factory::find(type);
+}
+
+inline void object::freeze_types() {
+	object_factory::freeze();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// object_pool
+//
+
+template <typename T>
+inline void object_pool<T>::prewarm(size_t count) {
+	auto&& objects = local().objects;
+	objects.reserve(count);
+	while (objects.size() < count)
+		objects.push_back(new T());
+}
+
+template <typename T>
+inline object_pool_stats object_pool<T>::stats() noexcept {
+	auto&& c = shared();
+	object_pool_stats s;
+	s.hits = c.hits.load(std::memory_order_relaxed);
+	s.misses = c.misses.load(std::memory_order_relaxed);
+	s.recycled = c.recycled.load(std::memory_order_relaxed);
+	s.discarded = c.discarded.load(std::memory_order_relaxed);
+	return s;
+}
+
+template <typename T>
+inline void object_pool<T>::reset_stats() noexcept {
+	auto&& c = shared();
+	c.hits.store(0, std::memory_order_relaxed);
+	c.misses.store(0, std::memory_order_relaxed);
+	c.recycled.store(0, std::memory_order_relaxed);
+	c.discarded.store(0, std::memory_order_relaxed);
+}
+
+template <typename T>
+template <typename... Args>
+inline T* object_pool<T>::acquire(Args&&... args) {
+	auto&& c = shared();
+	if (!c.capacity.load(std::memory_order_relaxed))
+		return new T(std::forward<Args>(args)...);
+	
+	// Pooled instances are default constructed, so only argumentless creation reuses them
+	auto&& objects = local().objects;
+	if constexpr (sizeof...(Args) == 0) {
+		if (!objects.empty()) {
+			auto p = objects.back();
+			objects.pop_back();
+			c.hits.fetch_add(1, std::memory_order_relaxed);
+			p->reuse();
+			return p;
+		}
+	}
+	
+	c.misses.fetch_add(1, std::memory_order_relaxed);
+	return new T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+inline void object_pool<T>::release(T* p) noexcept {
+	BOOST_ASSERT(p && !p->use_count());
+	auto&& c = shared();
+	auto capacity = c.capacity.load(std::memory_order_relaxed);
+	
+	// Instances of derived classes without own pool can't be reused as T
+	if (!capacity || typeid(*p) != typeid(T)) {
+		delete p;
+		return;
+	}
+	
+	auto&& objects = local().objects;
+	if (objects.size() >= capacity) {
+		c.discarded.fetch_add(1, std::memory_order_relaxed);
+		delete p;
+		return;
+	}
+	
+	p->reset();
+	try {
+		objects.push_back(p);
+	} catch (...) {
+		delete p;
+		return;
+	}
+	c.recycled.fetch_add(1, std::memory_order_relaxed);
+}
+
 #define IMPLEMENT_OBJECT_TYPE(ThisClass) \
 private: \
 	REGISTER_FACTORY_WITH_KEY(object_factory, ThisClass, ThisClass::class_type()) \
+protected: \
+	virtual void recycle() noexcept override { ::cobalt::object_pool<ThisClass>::release(this); } \
 public: \
 	static const type_index& class_type() noexcept { static auto type = type_id<ThisClass>(); return type; } \
 	virtual const type_index& object_type() const noexcept override { return class_type(); }
@@ -0,0 +1,206 @@
+#ifndef COBALT_PREFAB_HPP_INCLUDED
+#define COBALT_PREFAB_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     prefab
+
+#include <cobalt/actor.hpp>
+
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+namespace cobalt {
+
+///
+/// Template of actor instantiated many times
+///
+/// Captures components, transform hierarchy and data components of an actor into
+/// flat arrays, where links between transforms are indices. Components are created
+/// by object factory creators resolved on capture, so they come from object pools
+/// when pooling is enabled, and copy their state with `actor_component::assign`. Data components are copied in
+/// bulk into level storage with one allocation per type, trivially copyable ones
+/// end up as plain memory copies.
+///
+class prefab {
+public:
+	/// Captures current state of actor, later changes of actor don't affect prefab
+	explicit prefab(actor& source);
+
+	prefab(const prefab&) = delete;
+	prefab& operator=(const prefab&) = delete;
+
+	/// Number of actor components including transforms
+	size_t components() const noexcept { return _nodes.size(); }
+	size_t transforms() const noexcept { return _transforms; }
+	size_t data_components() const noexcept { return _data.size(); }
+
+	/// Creates actor which is not attached to level
+	ref_ptr<actor> instantiate() const;
+
+	/// Creates `count` actors in level and appends them to result
+	///
+	/// If it throws, created actors and their data are removed again, so level and
+	/// result are left as they were.
+	void instantiate(level& level, size_t count, std::vector<actor*>& result) const;
+
+private:
+	struct node {
+		object::instance_creator creator;
+		ref_ptr<actor_component> prototype;
+		int32_t parent;     ///< Index of parent transform, -1 for root transform and other components
+	};
+
+	struct data_entry {
+		uint32_t type;
+		component_handle handle;
+	};
+
+	void capture(const actor_component& component, int32_t parent);
+	void build(actor& a, std::vector<actor_component*>& created) const;
+
+	std::vector<node> _nodes;           ///< Transforms in pre-order followed by other components
+	size_t _transforms = 0;
+	std::vector<data_entry> _data;
+	component_storage _storage;         ///< Prototypes of data components
+	identifier _name;
+	aabb _bounds;
+	bool _active;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// prefab
+//
+
+inline prefab::prefab(actor& source)
+	: _name(source.name())
+	, _bounds(source.bounds())
+	, _active(source.active_self())
+{
+	if (auto root = source.transform()) {
+		// Pre-order walk, parent is always captured before its children
+		int32_t parent = -1;
+		for (auto n = root; n; ) {
+			capture(*n, parent);
+			if (auto child = n->first_child()) {
+				parent = static_cast<int32_t>(_nodes.size() - 1);
+				n = child;
+				continue;
+			}
+			while (n != root && !n->next_sibling()) {
+				n = n->parent();
+				parent = _nodes[parent].parent;
+			}
+			n = n != root ? n->next_sibling() : nullptr;
+		}
+		_transforms = _nodes.size();
+	}
+
+	for (auto&& component : source.components())
+		capture(component, -1);
+
+	auto&& storage = source.storage();
+	auto lock = component_storage::lock_if_detached(storage);
+	_data.reserve(source._data.size());
+	for (auto&& entry : source._data) {
+		auto pool = storage.find_pool(entry.type);
+		BOOST_ASSERT(pool);
+		actor* owner = nullptr;
+		component_handle handle;
+		pool->copy_to(entry.handle, &owner, 1, _storage.pool(entry.type, *pool), &handle);
+		_data.push_back({ entry.type, handle });
+	}
+}
+
+inline ref_ptr<actor> prefab::instantiate() const {
+	ref_ptr<actor> a = object::create_instance<actor>();
+	std::vector<actor_component*> created;
+	build(*a, created);
+
+	auto&& storage = a->storage();
+	auto lock = component_storage::lock_if_detached(storage);
+	a->_data.reserve(_data.size());
+	for (auto&& entry : _data) {
+		auto source = _storage.find_pool(entry.type);
+		auto owner = a.get();
+		component_handle handle;
+		source->copy_to(entry.handle, &owner, 1, storage.pool(entry.type, *source), &handle);
+		a->_data.push_back({ entry.type, handle });
+	}
+	return a;
+}
+
+inline void prefab::instantiate(level& level, size_t count, std::vector<actor*>& result) const {
+	auto first = result.size();
+	result.reserve(first + count);
+
+	try {
+		std::vector<actor_component*> created;
+		created.reserve(_nodes.size());
+		for (size_t i = 0; i < count; ++i) {
+			ref_ptr<actor> a = object::create_instance<actor>();
+			build(*a, created);
+			a->_data.reserve(_data.size());
+			level.add_actor(a.get());
+			result.push_back(a.get());
+		}
+
+		// Copies of every data component are created in one pass over its pool
+		auto owners = result.data() + first;
+		std::vector<component_handle> handles(count);
+		for (auto&& entry : _data) {
+			auto source = _storage.find_pool(entry.type);
+			source->copy_to(entry.handle, owners, count, level.storage().pool(entry.type, *source), handles.data());
+			// Reserved above, doesn't throw
+			for (size_t i = 0; i < count; ++i)
+				owners[i]->_data.push_back({ entry.type, handles[i] });
+		}
+	} catch (...) {
+		// Level holds the only reference, so removing destroys data instead of moving it and doesn't throw
+		for (auto i = first; i < result.size(); ++i)
+			level.remove_actor(result[i]);
+		result.resize(first);
+		throw;
+	}
+}
+
+inline void prefab::capture(const actor_component& component, int32_t parent) {
+	auto creator = object::find_creator(component.object_type());
+	if (!creator)
+		throw std::system_error(std::make_error_code(std::errc::not_supported), "component type is not registered");
+	ref_ptr<actor_component> prototype = static_cast<actor_component*>(object::create_instance(creator));
+	prototype->assign(component);
+	_nodes.push_back({ creator, std::move(prototype), parent });
+}
+
+inline void prefab::build(actor& a, std::vector<actor_component*>& created) const {
+	a.name(_name);
+	a.active(_active);
+	a.bounds(_bounds);
+
+	// Links are patched in the same pass, parents are created before their children
+	created.clear();
+	ref_ptr<transform_component> root;
+	for (size_t i = 0, size = _nodes.size(); i < size; ++i) {
+		auto&& n = _nodes[i];
+		auto c = static_cast<actor_component*>(object::create_instance(n.creator));
+		BOOST_ASSERT(c);
+		if (i >= _transforms)
+			a.add_component(c);
+		else if (n.parent < 0)
+			root = static_cast<transform_component*>(c);
+		else
+			static_cast<transform_component*>(created[n.parent])->add_child(static_cast<transform_component*>(c));
+		created.push_back(c);
+		c->assign(*n.prototype);
+	}
+	// Hierarchy is attached once complete, so building it doesn't notify actor
+	if (root)
+		a.transform(root.get());
+}
+
+} // namespace cobalt
+
+#endif // COBALT_PREFAB_HPP_INCLUDED
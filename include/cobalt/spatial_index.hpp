@@ -0,0 +1,370 @@
+#ifndef COBALT_SPATIAL_INDEX_HPP_INCLUDED
+#define COBALT_SPATIAL_INDEX_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     aabb_tree
+
+#include <cobalt/geometry.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/container/small_vector.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace cobalt {
+
+///
+/// Dynamic bounding volume hierarchy
+///
+/// Leaves keep bounds inflated by margin, so moving objects are reinserted only
+/// when their bounds leave the inflated ones. Tree is kept balanced by rotations
+/// on insertion and removal. Queries test tight bounds of leaves.
+///
+template <typename T>
+class aabb_tree {
+public:
+	using proxy_id = int32_t;
+	static constexpr proxy_id null = -1;
+
+	explicit aabb_tree(float margin = 0.1f) noexcept : _margin(margin) {}
+
+	proxy_id insert(const aabb& bounds, T value);
+	void remove(proxy_id id) noexcept;
+
+	/// Updates bounds of leaf, returns true if leaf has been reinserted
+	bool move(proxy_id id, const aabb& bounds);
+
+	const aabb& bounds(proxy_id id) const noexcept { BOOST_ASSERT(is_leaf(id)); return _nodes[id].tight; }
+	const aabb& fat_bounds(proxy_id id) const noexcept { BOOST_ASSERT(is_leaf(id)); return _nodes[id].box; }
+	const T& value(proxy_id id) const noexcept { BOOST_ASSERT(is_leaf(id)); return _nodes[id].value; }
+
+	size_t size() const noexcept { return _size; }
+	bool empty() const noexcept { return !_size; }
+	int height() const noexcept { return _root != null ? _nodes[_root].height : 0; }
+
+	void clear() noexcept;
+
+	/// Appends values of leaves intersecting box, returns number of them
+	size_t query(const aabb& box, std::vector<T>& result) const;
+	/// Appends values of leaves intersecting frustum, returns number of them
+	size_t query(const frustum& f, std::vector<T>& result) const;
+	/// Appends values of leaves hit by ray within `max_distance`, returns number of them
+	size_t raycast(const ray& r, float max_distance, std::vector<T>& result) const;
+
+	/// Calls `visit(id)` for leaves which bounds satisfy `overlaps(bounds)` until it returns false
+	template <typename Overlaps, typename Visit>
+	void traverse(Overlaps overlaps, Visit visit) const;
+
+private:
+	struct node {
+		aabb box;               ///< Fat bounds of leaf or bounds of children
+		aabb tight;
+		T value{};
+		proxy_id parent = null; ///< Next free node for free nodes
+		proxy_id child1 = null;
+		proxy_id child2 = null;
+		int32_t height = -1;    ///< Zero for leaves, -1 for free nodes
+
+		bool leaf() const noexcept { return child1 == null; }
+	};
+
+	bool is_leaf(proxy_id id) const noexcept { return id >= 0 && size_t(id) < _nodes.size() && _nodes[id].height == 0; }
+
+	proxy_id allocate();
+	void free(proxy_id id) noexcept;
+
+	void insert_leaf(proxy_id leaf);
+	void remove_leaf(proxy_id leaf) noexcept;
+	void refit(proxy_id index) noexcept;
+	proxy_id balance(proxy_id a) noexcept;
+
+	std::vector<node> _nodes;
+	proxy_id _root = null;
+	proxy_id _free = null;
+	size_t _size = 0;
+	float _margin;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// aabb_tree
+//
+
+template <typename T>
+inline typename aabb_tree<T>::proxy_id aabb_tree<T>::insert(const aabb& bounds, T value) {
+	BOOST_ASSERT(!bounds.empty());
+	auto id = allocate();
+	auto&& n = _nodes[id];
+	n.box = bounds.inflated(_margin);
+	n.tight = bounds;
+	n.value = std::move(value);
+	n.height = 0;
+	insert_leaf(id);
+	++_size;
+	return id;
+}
+
+template <typename T>
+inline void aabb_tree<T>::remove(proxy_id id) noexcept {
+	BOOST_ASSERT(is_leaf(id));
+	remove_leaf(id);
+	free(id);
+	--_size;
+}
+
+template <typename T>
+inline bool aabb_tree<T>::move(proxy_id id, const aabb& bounds) {
+	BOOST_ASSERT(is_leaf(id));
+	BOOST_ASSERT(!bounds.empty());
+	auto&& n = _nodes[id];
+	n.tight = bounds;
+	if (n.box.contains(bounds))
+		return false;
+
+	remove_leaf(id);
+	_nodes[id].box = bounds.inflated(_margin);
+	insert_leaf(id);
+	return true;
+}
+
+template <typename T>
+inline void aabb_tree<T>::clear() noexcept {
+	_nodes.clear();
+	_root = _free = null;
+	_size = 0;
+}
+
+template <typename T>
+template <typename Overlaps, typename Visit>
+inline void aabb_tree<T>::traverse(Overlaps overlaps, Visit visit) const {
+	if (_root == null)
+		return;
+
+	boost::container::small_vector<proxy_id, 64> stack;
+	stack.push_back(_root);
+	while (!stack.empty()) {
+		auto&& n = _nodes[stack.back()];
+		auto id = stack.back();
+		stack.pop_back();
+
+		if (!overlaps(n.box))
+			continue;
+
+		if (n.leaf()) {
+			if (overlaps(n.tight) && !visit(id))
+				return;
+		} else {
+			stack.push_back(n.child2);
+			stack.push_back(n.child1);
+		}
+	}
+}
+
+template <typename T>
+inline size_t aabb_tree<T>::query(const aabb& box, std::vector<T>& result) const {
+	auto initial_size = result.size();
+	traverse([&](const aabb& b) { return b.intersects(box); }, [&](proxy_id id) {
+		result.push_back(_nodes[id].value);
+		return true;
+	});
+	return result.size() - initial_size;
+}
+
+template <typename T>
+inline size_t aabb_tree<T>::query(const frustum& f, std::vector<T>& result) const {
+	auto initial_size = result.size();
+	traverse([&](const aabb& b) { return f.intersects(b); }, [&](proxy_id id) {
+		result.push_back(_nodes[id].value);
+		return true;
+	});
+	return result.size() - initial_size;
+}
+
+template <typename T>
+inline size_t aabb_tree<T>::raycast(const ray& r, float max_distance, std::vector<T>& result) const {
+	auto initial_size = result.size();
+	traverse([&](const aabb& b) { return r.intersect(b, max_distance) >= 0; }, [&](proxy_id id) {
+		result.push_back(_nodes[id].value);
+		return true;
+	});
+	return result.size() - initial_size;
+}
+
+template <typename T>
+inline typename aabb_tree<T>::proxy_id aabb_tree<T>::allocate() {
+	if (_free == null) {
+		_nodes.emplace_back();
+		return static_cast<proxy_id>(_nodes.size() - 1);
+	}
+
+	auto id = _free;
+	_free = _nodes[id].parent;
+	_nodes[id] = node();
+	return id;
+}
+
+template <typename T>
+inline void aabb_tree<T>::free(proxy_id id) noexcept {
+	auto&& n = _nodes[id];
+	n.value = T{};
+	n.height = -1;
+	n.child1 = n.child2 = null;
+	n.parent = _free;
+	_free = id;
+}
+
+template <typename T>
+inline void aabb_tree<T>::insert_leaf(proxy_id leaf) {
+	if (_root == null) {
+		_root = leaf;
+		_nodes[leaf].parent = null;
+		return;
+	}
+
+	// Find the best sibling by surface area heuristic
+	auto box = _nodes[leaf].box;
+	auto index = _root;
+	while (!_nodes[index].leaf()) {
+		auto&& n = _nodes[index];
+		auto area = n.box.half_area();
+		auto combined = merge(n.box, box).half_area();
+
+		// Cost of creating new parent for this node and the leaf
+		auto cost = 2 * combined;
+		// Minimum cost of pushing the leaf further down
+		auto inheritance = 2 * (combined - area);
+
+		auto descend_cost = [&](proxy_id child) {
+			auto&& c = _nodes[child];
+			auto merged = merge(box, c.box).half_area();
+			return (c.leaf() ? merged : merged - c.box.half_area()) + inheritance;
+		};
+		auto cost1 = descend_cost(n.child1);
+		auto cost2 = descend_cost(n.child2);
+
+		if (cost < cost1 && cost < cost2)
+			break;
+		index = cost1 < cost2 ? n.child1 : n.child2;
+	}
+
+	auto sibling = index;
+	auto old_parent = _nodes[sibling].parent;
+	auto new_parent = allocate();
+	{
+		auto&& p = _nodes[new_parent];
+		p.parent = old_parent;
+		p.box = merge(box, _nodes[sibling].box);
+		p.height = _nodes[sibling].height + 1;
+		p.child1 = sibling;
+		p.child2 = leaf;
+	}
+
+	if (old_parent != null) {
+		auto&& op = _nodes[old_parent];
+		(op.child1 == sibling ? op.child1 : op.child2) = new_parent;
+	} else {
+		_root = new_parent;
+	}
+	_nodes[sibling].parent = new_parent;
+	_nodes[leaf].parent = new_parent;
+
+	refit(new_parent);
+}
+
+template <typename T>
+inline void aabb_tree<T>::remove_leaf(proxy_id leaf) noexcept {
+	if (leaf == _root) {
+		_root = null;
+		return;
+	}
+
+	auto parent = _nodes[leaf].parent;
+	auto grand_parent = _nodes[parent].parent;
+	auto sibling = _nodes[parent].child1 == leaf ? _nodes[parent].child2 : _nodes[parent].child1;
+
+	if (grand_parent != null) {
+		auto&& gp = _nodes[grand_parent];
+		(gp.child1 == parent ? gp.child1 : gp.child2) = sibling;
+		_nodes[sibling].parent = grand_parent;
+		free(parent);
+		refit(grand_parent);
+	} else {
+		_root = sibling;
+		_nodes[sibling].parent = null;
+		free(parent);
+	}
+}
+
+template <typename T>
+inline void aabb_tree<T>::refit(proxy_id index) noexcept {
+	while (index != null) {
+		index = balance(index);
+		auto&& n = _nodes[index];
+		auto&& c1 = _nodes[n.child1];
+		auto&& c2 = _nodes[n.child2];
+		n.height = 1 + std::max(c1.height, c2.height);
+		n.box = merge(c1.box, c2.box);
+		index = n.parent;
+	}
+}
+
+// Rotates subtree of `a` if it is imbalanced, returns new root of subtree
+template <typename T>
+inline typename aabb_tree<T>::proxy_id aabb_tree<T>::balance(proxy_id ia) noexcept {
+	auto&& a = _nodes[ia];
+	if (a.leaf() || a.height < 2)
+		return ia;
+
+	auto ib = a.child1;
+	auto ic = a.child2;
+	auto&& b = _nodes[ib];
+	auto&& c = _nodes[ic];
+	auto skew = c.height - b.height;
+
+	// Promotes `child` of `a`, the other child of `a` stays in place
+	auto rotate = [&](proxy_id ichild, bool child_is_first) {
+		auto&& x = _nodes[ichild];
+		auto i1 = x.child1;
+		auto i2 = x.child2;
+		auto&& n1 = _nodes[i1];
+		auto&& n2 = _nodes[i2];
+
+		// Swap a and x
+		x.child1 = ia;
+		x.parent = a.parent;
+		a.parent = ichild;
+
+		if (x.parent != null) {
+			auto&& p = _nodes[x.parent];
+			(p.child1 == ia ? p.child1 : p.child2) = ichild;
+		} else {
+			_root = ichild;
+		}
+
+		auto&& other = _nodes[child_is_first ? a.child2 : a.child1];
+		// Keep the taller grandchild under x, move the shorter one to a
+		auto keep = n1.height > n2.height ? i1 : i2;
+		auto give = n1.height > n2.height ? i2 : i1;
+		x.child2 = keep;
+		(child_is_first ? a.child1 : a.child2) = give;
+		_nodes[give].parent = ia;
+		a.box = merge(other.box, _nodes[give].box);
+		a.height = 1 + std::max(other.height, _nodes[give].height);
+		x.box = merge(a.box, _nodes[keep].box);
+		x.height = 1 + std::max(a.height, _nodes[keep].height);
+		return ichild;
+	};
+
+	if (skew > 1)
+		return rotate(ic, false);
+	if (skew < -1)
+		return rotate(ib, true);
+	return ia;
+}
+
+} // namespace cobalt
+
+#endif // COBALT_SPATIAL_INDEX_HPP_INCLUDED
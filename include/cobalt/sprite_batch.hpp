@@ -0,0 +1,599 @@
+#ifndef COBALT_SPRITE_BATCH_HPP_INCLUDED
+#define COBALT_SPRITE_BATCH_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     sprite_vertex
+//     sprite_texture
+//     sprite_desc
+//     mapped_ring
+//     basic_sprite_batch
+
+#include <cobalt/geometry.hpp>
+#include <cobalt/utility/radix_sort.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/predef/hardware/simd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#if BOOST_HW_SIMD_X86 >= BOOST_HW_SIMD_X86_SSE2_VERSION
+#include <emmintrin.h>
+#elif BOOST_HW_SIMD_ARM >= BOOST_HW_SIMD_ARM_NEON_VERSION
+#include <arm_neon.h>
+#endif
+
+namespace cobalt {
+
+enum class blend_mode : uint8_t {
+	none,
+	modulate,
+	add,
+	multiply,
+	replace
+};
+
+enum class sprite_sort : uint8_t {
+	deferred,           ///< Sprites are drawn in order of submission
+	texture,
+	blend,
+	back_to_front,
+	front_to_back
+};
+
+enum class buffer_target : uint8_t {
+	vertex,
+	index
+};
+
+enum class buffer_storage : uint8_t {
+	orphaned,           ///< Storage is replaced before every write, no synchronization with GPU
+	persistent          ///< Storage is mapped once, writes wait for fences of GPU commands reading it
+};
+
+struct sprite_vertex {
+	float x, y, z;
+	uint32_t color;
+	float u, v;
+};
+
+/// Texture of sprite, null handle draws untextured sprites
+struct sprite_texture {
+	uint32_t handle = 0;
+	float width = 0;
+	float height = 0;
+};
+
+/// Sprite submitted in bulk by `draw_many`
+///
+/// Quad of `dest` size is rotated clockwise by `rotation` in radians around its
+/// `origin`, which is placed at `dest.x`, `dest.y`. Origin is relative to size,
+/// (0, 0) is top left corner and (0.5, 0.5) is center. Scale is given by ratio
+/// of `dest` and `src` sizes.
+struct sprite_desc {
+	sprite_texture texture;
+	rectf src;                  ///< Texels of texture
+	rectf dest;
+	pointf origin;
+	float rotation = 0.0f;
+	uint32_t color = 0xffffffff;
+	float depth = 0.0f;
+	blend_mode blend = blend_mode::modulate;
+};
+
+///
+/// Ring of vertex or index buffer segments written by CPU while GPU reads others
+///
+/// Device is thin layer over graphics API, which has these members:
+///
+///     using buffer_type = ...;    // Handle of buffer
+///     using fence_type = ...;     // Handle of fence
+///     bool persistent_mapping() const;
+///     buffer_type create_buffer(buffer_target target, size_t size, buffer_storage storage);
+///     void destroy_buffer(buffer_type buffer);
+///     void orphan_buffer(buffer_type buffer, size_t size);
+///     void* map_buffer(buffer_type buffer, size_t offset, size_t size, buffer_storage storage);
+///     void unmap_buffer(buffer_type buffer);
+///     fence_type insert_fence();
+///     void wait_fence(fence_type fence);
+///     void delete_fence(fence_type fence);
+///
+/// Persistent storage is mapped for the whole lifetime of ring. It starts as one
+/// buffer of a segment per frame in flight, one fence is inserted per frame. A frame
+/// writing more segments than fit gets new segments instead of reusing ones of frames
+/// in flight, so the ring grows to hold all segments of those frames. Writing a segment
+/// waits only for the fence of the frame which wrote it before, that is signaled
+/// already unless GPU is more frames behind than there are frames in flight. Without
+/// persistent mapping every segment is a buffer which storage is orphaned and mapped
+/// before writing.
+///
+template <typename Device>
+class mapped_ring {
+public:
+	using buffer_type = typename Device::buffer_type;
+	using fence_type = typename Device::fence_type;
+
+	/// `segment_size` is in bytes, `segment_count` is number of frames in flight
+	mapped_ring(Device& device, buffer_target target, size_t segment_size, size_t segment_count);
+	~mapped_ring();
+
+	mapped_ring(const mapped_ring&) = delete;
+	mapped_ring& operator=(const mapped_ring&) = delete;
+
+	buffer_storage storage() const noexcept { return _storage; }
+	size_t segment_size() const noexcept { return _segment_size; }
+	size_t segment_count() const noexcept { return _segments.size(); }
+
+	/// Maps the next segment for writing
+	void* acquire();
+	/// Makes written segment available to GPU, must be called before drawing from it
+	void release();
+	/// Ends frame, segments written in it are protected from writes until GPU completes commands issued so far
+	void fence();
+
+	/// Buffer of the current segment
+	buffer_type buffer() const noexcept { return _segments[_current].buffer; }
+	/// Offset of the current segment in its buffer in bytes
+	size_t offset() const noexcept { return _segments[_current].offset; }
+
+private:
+	struct segment {
+		buffer_type buffer{};
+		size_t offset = 0;
+		uint8_t* memory = nullptr;  ///< Persistently mapped memory of segment
+		uint64_t frame = 0;         ///< Frame which wrote segment last, 0 if never written
+	};
+
+	struct frame_fence {
+		uint64_t frame;
+		fence_type fence;
+	};
+
+	Device& _device;
+	buffer_target _target;
+	buffer_storage _storage;
+	size_t _segment_size;
+	size_t _frames;                     ///< Frames in flight
+	std::vector<segment> _segments;
+	std::vector<buffer_type> _buffers;  ///< Persistently mapped buffers, segments added by growing have their own
+	std::deque<frame_fence> _fences;    ///< Fences of frames in flight, oldest first
+	size_t _current;
+	uint64_t _frame = 1;
+	bool _mapped = false;
+};
+
+///
+/// Sprite renderer writing vertices directly into mapped buffers
+///
+/// Quads are written in order of submission into mapped segment of vertex ring,
+/// while sort keys are kept apart. Every sort mode is a layout of 64-bit key, its
+/// high half holds the sorted fields and the low half position of the quad. On
+/// flush keys are radix sorted by the high half, which keeps order of submission
+/// for equal fields, indices are written in sorted order into index ring and
+/// sprites with the same texture and blend mode are drawn by one call of device
+/// `draw_sprites(vertex_buffer, index_buffer, first_index, index_count, texture,
+/// blend)`. Indices are 32-bit.
+///
+/// Sprites are flushed when segment is full or on `end()`, which ends the frame.
+///
+template <typename Device>
+class basic_sprite_batch {
+public:
+	static constexpr size_t vertices_per_sprite = 4;
+	static constexpr size_t indices_per_sprite = 6;
+
+	/// `capacity` is maximum number of sprites per flush, `segments` is number of frames in flight
+	///
+	/// Frames flushing several times take as many segments, rings grow to fit them.
+	explicit basic_sprite_batch(Device& device, size_t capacity = 16384, size_t segments = 3);
+
+	basic_sprite_batch(const basic_sprite_batch&) = delete;
+	basic_sprite_batch& operator=(const basic_sprite_batch&) = delete;
+
+	void begin(sprite_sort sort = sprite_sort::deferred);
+	void draw(const sprite_texture& texture, blend_mode blend, const rectf& src, const rectf& dest, uint32_t color = 0xffffffff, float depth = 0.0f);
+	void draw_rect(blend_mode blend, const rectf& dest, uint32_t color = 0xffffffff, float depth = 0.0f);
+	/// Draws `count` sprites, checks of batch state are made once per segment instead of per sprite
+	void draw_many(const sprite_desc* sprites, size_t count);
+	void end();
+
+	/// Draws queued sprites and continues in the next segment
+	void flush();
+
+	/// Number of queued sprites
+	size_t size() const noexcept { return _materials.size(); }
+	size_t capacity() const noexcept { return _capacity; }
+
+private:
+	struct sprite_material {
+		uint32_t texture;
+		blend_mode blend;
+	};
+
+	/// Bits of key holding position of quad
+	static constexpr unsigned index_bits = 32;
+
+	/// Sort key of quad, the first 24 bits of texture handle are sorted
+	uint64_t make_key(uint32_t texture, blend_mode blend, float depth, uint32_t index) const noexcept;
+	/// Maps depth to unsigned integer of the same order
+	static uint32_t depth_bits(float depth) noexcept;
+	/// Writes 4 vertices of transformed sprite
+	static void write_quad(sprite_vertex* quad, const sprite_desc& sprite) noexcept;
+
+	void sort();
+	/// Draws queued sprites and releases vertex segment
+	void submit();
+
+	Device& _device;
+	mapped_ring<Device> _vertices;
+	mapped_ring<Device> _indices;
+	sprite_vertex* _mapped = nullptr;   ///< Vertices of the current segment
+	std::vector<uint64_t> _keys;
+	std::vector<uint64_t> _scratch;     ///< Radix sort buffer
+	std::vector<sprite_material> _materials;    ///< Materials by position of quad
+	size_t _capacity;
+	sprite_sort _sort = sprite_sort::deferred;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// mapped_ring
+//
+
+template <typename Device>
+inline mapped_ring<Device>::mapped_ring(Device& device, buffer_target target, size_t segment_size, size_t segment_count)
+	: _device(device)
+	, _target(target)
+	, _storage(device.persistent_mapping() ? buffer_storage::persistent : buffer_storage::orphaned)
+	, _segment_size(segment_size)
+	, _frames(std::max<size_t>(segment_count, 1))
+	, _segments(_frames)
+	, _current(_segments.size() - 1)
+{
+	if (_storage == buffer_storage::persistent) {
+		auto size = _segment_size * _segments.size();
+		auto buffer = _device.create_buffer(target, size, _storage);
+		_buffers.push_back(buffer);
+		auto memory = static_cast<uint8_t*>(_device.map_buffer(buffer, 0, size, _storage));
+		BOOST_ASSERT(memory);
+		for (size_t i = 0; i < _segments.size(); ++i)
+			_segments[i] = { buffer, i * _segment_size, memory + i * _segment_size };
+	} else {
+		for (auto&& s : _segments)
+			s.buffer = _device.create_buffer(target, _segment_size, _storage);
+	}
+}
+
+template <typename Device>
+inline mapped_ring<Device>::~mapped_ring() {
+	for (auto&& f : _fences)
+		_device.delete_fence(f.fence);
+	if (_storage == buffer_storage::persistent) {
+		for (auto buffer : _buffers) {
+			_device.unmap_buffer(buffer);
+			_device.destroy_buffer(buffer);
+		}
+	} else {
+		if (_mapped)
+			_device.unmap_buffer(buffer());
+		for (auto&& s : _segments)
+			_device.destroy_buffer(s.buffer);
+	}
+}
+
+template <typename Device>
+inline void* mapped_ring<Device>::acquire() {
+	BOOST_ASSERT_MSG(!_mapped, "segment is already acquired");
+	auto next = (_current + 1) % _segments.size();
+
+	if (_storage == buffer_storage::orphaned) {
+		_current = next;
+		_mapped = true;
+		// Driver hands out new storage, while GPU keeps reading the old one
+		auto&& s = _segments[_current];
+		_device.orphan_buffer(s.buffer, _segment_size);
+		auto memory = _device.map_buffer(s.buffer, 0, _segment_size, _storage);
+		BOOST_ASSERT(memory);
+		return memory;
+	}
+
+	auto written = _segments[next].frame;
+	if (written && written + _frames > _frame) {
+		// Segment of frame in flight, ring grows instead of waiting for it
+		_buffers.reserve(_buffers.size() + 1);
+		_segments.reserve(_segments.size() + 1);
+		auto buffer = _device.create_buffer(_target, _segment_size, _storage);
+		_buffers.push_back(buffer);
+		auto memory = static_cast<uint8_t*>(_device.map_buffer(buffer, 0, _segment_size, _storage));
+		BOOST_ASSERT(memory);
+		_segments.insert(_segments.begin() + next, segment{ buffer, 0, memory, 0 });
+		written = 0;
+	}
+	_current = next;
+	_mapped = true;
+	auto&& s = _segments[_current];
+	s.frame = _frame;
+
+	// Fences are signaled in order, waiting for the last one of written frame completes older ones
+	while (!_fences.empty() && _fences.front().frame <= written) {
+		auto fence = _fences.front().fence;
+		_fences.pop_front();
+		if (_fences.empty() || _fences.front().frame > written)
+			_device.wait_fence(fence);
+		_device.delete_fence(fence);
+	}
+	return s.memory;
+}
+
+template <typename Device>
+inline void mapped_ring<Device>::release() {
+	BOOST_ASSERT_MSG(_mapped, "segment is not acquired");
+	_mapped = false;
+	if (_storage == buffer_storage::orphaned)
+		_device.unmap_buffer(buffer());
+}
+
+template <typename Device>
+inline void mapped_ring<Device>::fence() {
+	BOOST_ASSERT(!_mapped);
+	if (_storage == buffer_storage::persistent && _segments[_current].frame == _frame)
+		_fences.push_back({ _frame, _device.insert_fence() });
+	++_frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// basic_sprite_batch
+//
+
+template <typename Device>
+inline basic_sprite_batch<Device>::basic_sprite_batch(Device& device, size_t capacity, size_t segments)
+	: _device(device)
+	, _vertices(device, buffer_target::vertex, std::max<size_t>(capacity, 1) * vertices_per_sprite * sizeof(sprite_vertex), segments)
+	, _indices(device, buffer_target::index, std::max<size_t>(capacity, 1) * indices_per_sprite * sizeof(uint32_t), segments)
+	, _capacity(std::max<size_t>(capacity, 1))
+{
+	_keys.reserve(_capacity);
+	_scratch.resize(_capacity);
+	_materials.reserve(_capacity);
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::begin(sprite_sort sort) {
+	BOOST_ASSERT_MSG(!_mapped, "cannot nest begin() calls on a single sprite_batch");
+	_sort = sort;
+	_mapped = static_cast<sprite_vertex*>(_vertices.acquire());
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::draw(const sprite_texture& texture, blend_mode blend, const rectf& src, const rectf& dest, uint32_t color, float depth) {
+	BOOST_ASSERT_MSG(_mapped, "begin() must be called before draw()");
+	if (_materials.size() == _capacity)
+		flush();
+
+	auto index = static_cast<uint32_t>(_materials.size());
+	_materials.push_back({ texture.handle, blend });
+	_keys.push_back(make_key(texture.handle, blend, depth, index));
+
+	const float width_inv = texture.width > 0 ? 1.0f / texture.width : 0.0f;
+	const float height_inv = texture.height > 0 ? 1.0f / texture.height : 0.0f;
+	const float u0 = src.x * width_inv;
+	const float v0 = src.y * height_inv;
+	const float u1 = (src.x + src.width) * width_inv;
+	const float v1 = (src.y + src.height) * height_inv;
+	const float x1 = dest.x + dest.width;
+	const float y1 = dest.y + dest.height;
+
+	// Mapped memory may be write-combined, quad is written once and never read
+	auto quad = _mapped + index * vertices_per_sprite;
+	quad[0] = { dest.x, dest.y, depth, color, u0, v0 };
+	quad[1] = { dest.x, y1, depth, color, u0, v1 };
+	quad[2] = { x1, y1, depth, color, u1, v1 };
+	quad[3] = { x1, dest.y, depth, color, u1, v0 };
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::draw_rect(blend_mode blend, const rectf& dest, uint32_t color, float depth) {
+	draw(sprite_texture(), blend, rectf(), dest, color, depth);
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::draw_many(const sprite_desc* sprites, size_t count) {
+	BOOST_ASSERT_MSG(_mapped, "begin() must be called before draw_many()");
+	while (count > 0) {
+		if (_materials.size() == _capacity)
+			flush();
+
+		// Sprites fitting into the current segment
+		auto first = _materials.size();
+		auto n = std::min(count, _capacity - first);
+		_materials.resize(first + n);
+		_keys.resize(first + n);
+		auto materials = _materials.data() + first;
+		auto keys = _keys.data() + first;
+		auto quads = _mapped + first * vertices_per_sprite;
+		for (size_t i = 0; i < n; ++i) {
+			auto&& s = sprites[i];
+			materials[i] = { s.texture.handle, s.blend };
+			keys[i] = make_key(s.texture.handle, s.blend, s.depth, static_cast<uint32_t>(first + i));
+			write_quad(quads + i * vertices_per_sprite, s);
+		}
+		sprites += n;
+		count -= n;
+	}
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::end() {
+	BOOST_ASSERT_MSG(_mapped, "begin() must be called before end()");
+	submit();
+	_mapped = nullptr;
+	_vertices.fence();
+	_indices.fence();
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::flush() {
+	BOOST_ASSERT_MSG(_mapped, "begin() must be called before flush()");
+	submit();
+	_mapped = static_cast<sprite_vertex*>(_vertices.acquire());
+}
+
+template <typename Device>
+inline uint64_t basic_sprite_batch<Device>::make_key(uint32_t texture, blend_mode blend, float depth, uint32_t index) const noexcept {
+	uint64_t key = 0;
+	switch (_sort) {
+	case sprite_sort::deferred:
+		break;
+	case sprite_sort::texture:
+		key = uint64_t(texture & 0xffffff) << 8 | uint64_t(blend);
+		break;
+	case sprite_sort::blend:
+		key = uint64_t(blend) << 24 | uint64_t(texture & 0xffffff);
+		break;
+	case sprite_sort::back_to_front:
+		key = depth_bits(depth);
+		break;
+	case sprite_sort::front_to_back:
+		key = ~depth_bits(depth);
+		break;
+	}
+	return key << index_bits | index;
+}
+
+template <typename Device>
+inline uint32_t basic_sprite_batch<Device>::depth_bits(float depth) noexcept {
+	// Negative floats are ordered backwards, their bits are inverted
+	uint32_t bits;
+	std::memcpy(&bits, &depth, sizeof(bits));
+	return bits ^ (bits >> 31 ? 0xffffffffu : 0x80000000u);
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::write_quad(sprite_vertex* quad, const sprite_desc& sprite) noexcept {
+	static_assert(sizeof(sprite_vertex) == 6 * sizeof(float), "vertices are written as floats");
+
+	const float width_inv = sprite.texture.width > 0 ? 1.0f / sprite.texture.width : 0.0f;
+	const float height_inv = sprite.texture.height > 0 ? 1.0f / sprite.texture.height : 0.0f;
+	float cosine = 1.0f, sine = 0.0f;
+	if (sprite.rotation != 0.0f) {
+		cosine = std::cos(sprite.rotation);
+		sine = std::sin(sprite.rotation);
+	}
+	// Corners relative to origin
+	const float x0 = -sprite.origin.x * sprite.dest.width;
+	const float y0 = -sprite.origin.y * sprite.dest.height;
+	const float x1 = x0 + sprite.dest.width;
+	const float y1 = y0 + sprite.dest.height;
+	const float u0 = sprite.src.x * width_inv;
+	const float v0 = sprite.src.y * height_inv;
+	const float u1 = (sprite.src.x + sprite.src.width) * width_inv;
+	const float v1 = (sprite.src.y + sprite.src.height) * height_inv;
+
+	// Lanes hold corners in order of quad, x, y, u and v of all corners are
+	// computed at once and interleaved with depth and color into 6 stores.
+	// Vertices are 24 bytes, so stores are unaligned.
+#if BOOST_HW_SIMD_X86 >= BOOST_HW_SIMD_X86_SSE2_VERSION
+	auto out = reinterpret_cast<float*>(quad);
+	const __m128 lx = _mm_setr_ps(x0, x0, x1, x1);
+	const __m128 ly = _mm_setr_ps(y0, y1, y1, y0);
+	const __m128 c = _mm_set1_ps(cosine);
+	const __m128 s = _mm_set1_ps(sine);
+	const __m128 x = _mm_add_ps(_mm_set1_ps(sprite.dest.x), _mm_sub_ps(_mm_mul_ps(lx, c), _mm_mul_ps(ly, s)));
+	const __m128 y = _mm_add_ps(_mm_set1_ps(sprite.dest.y), _mm_add_ps(_mm_mul_ps(lx, s), _mm_mul_ps(ly, c)));
+	const __m128 u = _mm_setr_ps(u0, u0, u1, u1);
+	const __m128 v = _mm_setr_ps(v0, v1, v1, v0);
+	const __m128 zc = _mm_unpacklo_ps(_mm_set1_ps(sprite.depth), _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(sprite.color))));
+
+	const __m128 xy01 = _mm_unpacklo_ps(x, y);
+	const __m128 xy23 = _mm_unpackhi_ps(x, y);
+	const __m128 uv01 = _mm_unpacklo_ps(u, v);
+	const __m128 uv23 = _mm_unpackhi_ps(u, v);
+	_mm_storeu_ps(out, _mm_movelh_ps(xy01, zc));
+	_mm_storeu_ps(out + 4, _mm_shuffle_ps(uv01, xy01, _MM_SHUFFLE(3, 2, 1, 0)));
+	_mm_storeu_ps(out + 8, _mm_shuffle_ps(zc, uv01, _MM_SHUFFLE(3, 2, 1, 0)));
+	_mm_storeu_ps(out + 12, _mm_movelh_ps(xy23, zc));
+	_mm_storeu_ps(out + 16, _mm_shuffle_ps(uv23, xy23, _MM_SHUFFLE(3, 2, 1, 0)));
+	_mm_storeu_ps(out + 20, _mm_shuffle_ps(zc, uv23, _MM_SHUFFLE(3, 2, 1, 0)));
+#elif BOOST_HW_SIMD_ARM >= BOOST_HW_SIMD_ARM_NEON_VERSION
+	auto out = reinterpret_cast<float*>(quad);
+	const float lxs[4] = { x0, x0, x1, x1 };
+	const float lys[4] = { y0, y1, y1, y0 };
+	const float us[4] = { u0, u0, u1, u1 };
+	const float vs[4] = { v0, v1, v1, v0 };
+	const float32x4_t lx = vld1q_f32(lxs);
+	const float32x4_t ly = vld1q_f32(lys);
+	const float32x4_t x = vmlsq_n_f32(vmlaq_n_f32(vdupq_n_f32(sprite.dest.x), lx, cosine), ly, sine);
+	const float32x4_t y = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(sprite.dest.y), lx, sine), ly, cosine);
+	const float32x2_t zc = vzip_f32(vdup_n_f32(sprite.depth), vreinterpret_f32_u32(vdup_n_u32(sprite.color))).val[0];
+
+	const float32x4x2_t xy = vzipq_f32(x, y);
+	const float32x4x2_t uv = vzipq_f32(vld1q_f32(us), vld1q_f32(vs));
+	vst1q_f32(out, vcombine_f32(vget_low_f32(xy.val[0]), zc));
+	vst1q_f32(out + 4, vcombine_f32(vget_low_f32(uv.val[0]), vget_high_f32(xy.val[0])));
+	vst1q_f32(out + 8, vcombine_f32(zc, vget_high_f32(uv.val[0])));
+	vst1q_f32(out + 12, vcombine_f32(vget_low_f32(xy.val[1]), zc));
+	vst1q_f32(out + 16, vcombine_f32(vget_low_f32(uv.val[1]), vget_high_f32(xy.val[1])));
+	vst1q_f32(out + 20, vcombine_f32(zc, vget_high_f32(uv.val[1])));
+#else
+	const float x = sprite.dest.x, y = sprite.dest.y;
+	quad[0] = { x + x0 * cosine - y0 * sine, y + x0 * sine + y0 * cosine, sprite.depth, sprite.color, u0, v0 };
+	quad[1] = { x + x0 * cosine - y1 * sine, y + x0 * sine + y1 * cosine, sprite.depth, sprite.color, u0, v1 };
+	quad[2] = { x + x1 * cosine - y1 * sine, y + x1 * sine + y1 * cosine, sprite.depth, sprite.color, u1, v1 };
+	quad[3] = { x + x1 * cosine - y0 * sine, y + x1 * sine + y0 * cosine, sprite.depth, sprite.color, u1, v0 };
+#endif
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::sort() {
+	if (_sort != sprite_sort::deferred)
+		radix_sort(_keys.data(), _scratch.data(), _keys.size(), index_bits);
+}
+
+template <typename Device>
+inline void basic_sprite_batch<Device>::submit() {
+	if (_materials.empty()) {
+		_vertices.release();
+		return;
+	}
+
+	sort();
+
+	// Indices of the whole vertex ring, persistent segments share one buffer
+	auto indices = static_cast<uint32_t*>(_indices.acquire());
+	auto base = static_cast<uint32_t>(_vertices.offset() / sizeof(sprite_vertex));
+	for (auto key : _keys) {
+		auto v = base + static_cast<uint32_t>(key) * static_cast<uint32_t>(vertices_per_sprite);
+		indices[0] = v;
+		indices[1] = v + 1;
+		indices[2] = v + 2;
+		indices[3] = v;
+		indices[4] = v + 2;
+		indices[5] = v + 3;
+		indices += indices_per_sprite;
+	}
+	_vertices.release();
+	_indices.release();
+
+	auto first_index = _indices.offset() / sizeof(uint32_t);
+	auto material = [this](size_t i) -> const sprite_material& { return _materials[static_cast<uint32_t>(_keys[i])]; };
+	size_t first = 0;
+	for (size_t i = 1, size = _keys.size(); i <= size; ++i) {
+		if (i < size && material(i).texture == material(first).texture && material(i).blend == material(first).blend)
+			continue;
+		_device.draw_sprites(_vertices.buffer(), _indices.buffer(), first_index + first * indices_per_sprite,
+			(i - first) * indices_per_sprite, material(first).texture, material(first).blend);
+		first = i;
+	}
+
+	_keys.clear();
+	_materials.clear();
+}
+
+} // namespace cobalt
+
+#endif // COBALT_SPRITE_BATCH_HPP_INCLUDED
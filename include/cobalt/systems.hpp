@@ -0,0 +1,197 @@
+#ifndef COBALT_SYSTEMS_HPP_INCLUDED
+#define COBALT_SYSTEMS_HPP_INCLUDED
+
+#pragma once
+
+// Classes in this file:
+//     reads
+//     writes
+//     level_update
+
+#include <cobalt/actor.hpp>
+#include <cobalt/command_buffer.hpp>
+#include <cobalt/jobs.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+namespace cobalt {
+
+/// Update phases, systems of the next phase start after all systems of the previous one complete
+enum class update_order : uint32_t {
+	earliest,
+	pre_update,
+	update,
+	post_update,
+	pre_draw,
+	draw,
+	post_draw,
+	latest
+};
+
+/// Data component types system only reads
+template <typename... Ts>
+struct reads {};
+
+/// Data component types system modifies
+template <typename... Ts>
+struct writes {};
+
+///
+/// Update pipeline of level
+///
+/// Systems are callbacks for every data component of a type or for every actor.
+/// Their work is split into chunks which run on thread pool. Systems of the same
+/// phase which access the same component types, where at least one of them
+/// writes, run in the order they were added, others run concurrently.
+///
+/// Systems must not add or remove data components or actors, and may touch only
+/// the components they declared. Structural changes are recorded into `commands()`
+/// instead and applied at the end of each phase.
+///
+class level_update {
+public:
+	explicit level_update(thread_pool& pool, size_t chunk_size = 1024) noexcept
+		: _pool(pool)
+		, _chunk_size(std::max<size_t>(chunk_size, 1))
+	{
+	}
+
+	level_update(const level_update&) = delete;
+	level_update& operator=(const level_update&) = delete;
+
+	/// Adds system calling `function(actor&, T&)` for every component of type T
+	///
+	/// T is passed by const reference if it is listed in reads.
+	template <typename T, typename... Reads, typename... Writes, typename Function>
+	void add_system(update_order order, reads<Reads...>, writes<Writes...>, Function function);
+
+	/// Adds system calling `function(actor&)` for every actor of level
+	template <typename... Reads, typename... Writes, typename Function>
+	void add_actor_system(update_order order, reads<Reads...>, writes<Writes...>, Function function);
+
+	size_t size() const noexcept { return _systems.size(); }
+	
+	/// Changes of level deferred until the end of current phase
+	command_buffer& commands() noexcept { return _commands; }
+
+	/// Runs all systems over level, phase by phase
+	void run(level& level);
+
+private:
+	struct system {
+		update_order order;
+		std::vector<uint32_t> reads;
+		std::vector<uint32_t> writes;
+		/// Returns number of items for level
+		std::function<size_t(level&)> prepare;
+		std::function<void(level&, size_t first, size_t last)> execute;
+	};
+
+	static bool conflicts(const system& lhs, const system& rhs) noexcept;
+
+	void insert(system&& s);
+
+	thread_pool& _pool;
+	size_t _chunk_size;
+	std::vector<system> _systems;       ///< Sorted by phase, stable within phase
+	std::vector<actor*> _actors;        ///< Actors of level being updated
+	job_graph _graph;
+	command_buffer _commands;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// level_update
+//
+
+template <typename T, typename... Reads, typename... Writes, typename Function>
+inline void level_update::add_system(update_order order, reads<Reads...>, writes<Writes...>, Function function) {
+	constexpr bool read_only = (std::is_same_v<T, Reads> || ...);
+	using reference = std::conditional_t<read_only, const T&, T&>;
+
+	system s{ order, { component_type_id<Reads>()... }, { component_type_id<Writes>()... } };
+	if (!read_only && std::find(s.writes.begin(), s.writes.end(), component_type_id<T>()) == s.writes.end())
+		s.writes.push_back(component_type_id<T>());
+
+	s.prepare = [](level& l) -> size_t {
+		auto pool = l.storage().find_pool<T>();
+		return pool ? pool->size() : 0;
+	};
+	s.execute = [function = std::move(function)](level& l, size_t first, size_t last) {
+		auto pool = l.storage().find_pool<T>();
+		auto data = pool->data();
+		auto owners = pool->owners();
+		for (auto i = first; i != last; ++i)
+			function(*owners[i], static_cast<reference>(data[i]));
+	};
+	insert(std::move(s));
+}
+
+template <typename... Reads, typename... Writes, typename Function>
+inline void level_update::add_actor_system(update_order order, reads<Reads...>, writes<Writes...>, Function function) {
+	system s{ order, { component_type_id<Reads>()... }, { component_type_id<Writes>()... } };
+	s.prepare = [this](level&) -> size_t {
+		return _actors.size();
+	};
+	s.execute = [this, function = std::move(function)](level&, size_t first, size_t last) {
+		for (auto i = first; i != last; ++i)
+			function(*_actors[i]);
+	};
+	insert(std::move(s));
+}
+
+inline void level_update::run(level& level) {
+	_actors.clear();
+	for (auto&& a : level.actors())
+		_actors.push_back(const_cast<actor*>(&a));
+
+	for (auto phase = _systems.begin(); phase != _systems.end(); ) {
+		auto phase_end = std::find_if(phase, _systems.end(), [&](const system& s) { return s.order != phase->order; });
+
+		_graph.clear();
+		for (auto it = phase; it != phase_end; ++it) {
+			auto size = it->prepare(level);
+			auto chunk_size = _chunk_size;
+			auto chunks = (size + chunk_size - 1) / chunk_size;
+			auto execute = &it->execute;
+			auto job = _graph.add(chunks, [&level, execute, size, chunk_size](size_t chunk) {
+				auto first = chunk * chunk_size;
+				(*execute)(level, first, std::min(first + chunk_size, size));
+			});
+
+			for (auto prev = phase; prev != it; ++prev) {
+				if (conflicts(*prev, *it))
+					_graph.depend(job, prev - phase);
+			}
+		}
+		_pool.run(_graph);
+
+		if (!_commands.empty()) {
+			_commands.apply(level);
+			// Actors may have been spawned or destroyed
+			_actors.clear();
+			for (auto&& a : level.actors())
+				_actors.push_back(const_cast<actor*>(&a));
+		}
+
+		phase = phase_end;
+	}
+}
+
+inline bool level_update::conflicts(const system& lhs, const system& rhs) noexcept {
+	auto intersects = [](const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+		return std::any_of(a.begin(), a.end(), [&](uint32_t type) { return std::find(b.begin(), b.end(), type) != b.end(); });
+	};
+	return intersects(lhs.writes, rhs.writes) || intersects(lhs.writes, rhs.reads) || intersects(lhs.reads, rhs.writes);
+}
+
+inline void level_update::insert(system&& s) {
+	auto it = std::upper_bound(_systems.begin(), _systems.end(), s.order, [](update_order order, const system& s) { return order < s.order; });
+	_systems.insert(it, std::move(s));
+}
+
+} // namespace cobalt
+
+#endif // COBALT_SYSTEMS_HPP_INCLUDED
@@ -4,8 +4,19 @@
 #pragma once
 
 #include <cobalt/utility/type_index.hpp>
+#include <cobalt/utility/hash.hpp>
 
 #include <boost/intrusive/slist.hpp>
+#include <boost/assert.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace cobalt {
 
@@ -16,6 +27,7 @@ struct factory_key_traits {
 	
 	static bool empty(param_type key) noexcept { return !key; }
 	static bool equal(param_type key1, param_type key2) noexcept { return key1 == key2; }
+	static size_t hash(param_type key) noexcept { return std::hash<key_type>()(key); }
 };
 
 template <>
@@ -25,6 +37,7 @@ struct factory_key_traits<const char*> {
 	
 	static bool empty(param_type key) noexcept { return !key; }
 	static bool equal(param_type key1, param_type key2) noexcept { return !std::strcmp(key1, key2); }
+	static size_t hash(param_type key) noexcept { return murmur3(key, 0); }
 };
 
 template <>
@@ -34,6 +47,14 @@ struct factory_key_traits<type_index> {
 	
 	static bool empty(param_type key) noexcept { return key == type_index(); }
 	static bool equal(param_type key1, param_type key2) noexcept { return key1 == key2; }
+	static size_t hash(param_type key) noexcept { return key.hash_code(); }
+};
+
+/// Constructs instances for factories, specialized to customize how instances are obtained
+template <typename T, typename = void>
+struct factory_construct {
+	template <typename... Args>
+	static T* create(Args&&... args) { return new T(std::forward<Args>(args)...); }
 };
 
 template <typename T, typename Key>
@@ -53,6 +74,18 @@ public:
 			return creator->create(std::forward<Args&&>(args)...);
 		return nullptr;
 	}
+	
+	/// Build lookup table for all registered creators and stop accepting new ones.
+	/// Lookups in frozen factory don't take the lock.
+	static void freeze() {
+		auto&& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		if (r.dirty)
+			rebuild(r);
+		r.frozen.store(true, std::memory_order_release);
+	}
+	
+	static bool frozen() noexcept { return instance().frozen.load(std::memory_order_acquire); }
 
 private:
 	struct creator;
@@ -62,31 +95,123 @@ private:
 	
 	struct creator : list_hook {
 		key_type key = {};
-		creator() noexcept { instances().push_front(*this); }
 		virtual result_type create(Args&&... args) const = 0;
 	};
 	
-	static creators_list& instances() noexcept {
-		static creators_list creators;
-		return creators;
+	struct registry {
+		creators_list creators;
+		// Open addressing table of creators, rebuilt on lookup after registrations
+		std::vector<creator*> table;
+		bool dirty = true;
+		std::atomic<bool> frozen{false};
+		std::mutex mutex;
+	};
+	
+	static registry& instance() noexcept {
+		static registry r;
+		return r;
 	}
 	
-	static creator* find_creator(param_type key) noexcept {
-		for (auto&& creator : instances()) {
-			if (!factory_key_traits<Key>::empty(creator.key) && factory_key_traits<Key>::equal(creator.key, key))
-				return &creator;
+	static void add_creator(creator& c) noexcept {
+		auto&& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		BOOST_ASSERT_MSG(!r.frozen.load(std::memory_order_relaxed), "Factory is frozen");
+		// Checked on the list, checking the table would rebuild it for every registration
+		BOOST_ASSERT_MSG(factory_key_traits<Key>::empty(c.key) || !scan(r, c.key), "Key is already registered");
+		r.creators.push_front(c);
+		r.dirty = true;
+	}
+	
+	static void rebuild(registry& r) {
+		size_t count = 0;
+		for (auto&& creator : r.creators)
+			count += !factory_key_traits<Key>::empty(creator.key);
+		
+		size_t capacity = 8;
+		while (capacity < count * 2)
+			capacity <<= 1;
+		
+		r.table.assign(capacity, nullptr);
+		
+		// Creators registered later come first in the list and take precedence
+		for (auto&& creator : r.creators) {
+			if (factory_key_traits<Key>::empty(creator.key))
+				continue;
+			
+			for (size_t i = factory_key_traits<Key>::hash(creator.key); ; ++i) {
+				auto&& slot = r.table[i & (capacity - 1)];
+				if (!slot) {
+					slot = &creator;
+					break;
+				}
+				if (factory_key_traits<Key>::equal(slot->key, creator.key))
+					break;
+			}
+		}
+		
+		r.dirty = false;
+	}
+	
+	static creator* lookup(const registry& r, param_type key) noexcept {
+		if (factory_key_traits<Key>::empty(key))
+			return nullptr;
+		
+		const size_t mask = r.table.size() - 1;
+		for (size_t i = factory_key_traits<Key>::hash(key); ; ++i) {
+			auto slot = r.table[i & mask];
+			if (!slot || factory_key_traits<Key>::equal(slot->key, key))
+				return slot;
+		}
+	}
+	
+	/// Finds creator in the list without the table, the latest registered one
+	static creator* scan(registry& r, param_type key) noexcept {
+		if (factory_key_traits<Key>::empty(key))
+			return nullptr;
+		
+		for (auto&& c : r.creators) {
+			if (!factory_key_traits<Key>::empty(c.key) && factory_key_traits<Key>::equal(c.key, key))
+				return &c;
 		}
 		return nullptr;
 	}
 	
+	static creator* find_creator(param_type key) noexcept {
+		auto&& r = instance();
+		if (r.frozen.load(std::memory_order_acquire))
+			return lookup(r, key);
+		
+		std::lock_guard<std::mutex> lock(r.mutex);
+		if (r.dirty) {
+			try {
+				rebuild(r);
+			} catch (const std::bad_alloc&) {
+				// Table stays dirty and is rebuilt by the next lookup
+				return scan(r, key);
+			}
+		}
+		return lookup(r, key);
+	}
+	
 public:
+	/// Creator resolved once by `find`, valid for the lifetime of the program
+	using creator_handle = const creator*;
+	
+	/// Looks creator up, so instances of the same type can be created repeatedly without lookups
+	static creator_handle find(param_type key) noexcept { return find_creator(key); }
+	
+	static result_type create(creator_handle creator, Args&&... args) {
+		BOOST_ASSERT(!!creator);
+		return creator->create(std::forward<Args&&>(args)...);
+	}
+	
 	template <typename T, typename I>
 	class registrar {
 		struct creator_impl : creator {
-			creator_impl() { T::set_creator_key(); }			
+			creator_impl() { T::set_creator_key(); add_creator(*this); }
 			virtual result_type create(Args&&... args) const override {
 				static_assert(std::is_base_of<R, I>::value, "Implementation not derived from result type");
-				return new I(std::forward<Args&&>(args)...);
+				return factory_construct<I>::create(std::forward<Args&&>(args)...);
 			}
 		};
 		
@@ -101,7 +226,6 @@ typename auto_factory<R(Args...), Key>::template registrar<T, I>::creator_impl a
 #define REGISTER_FACTORY_WITH_KEY(Factory, Class, Key) \
 	struct Factory##_registrar : Factory::registrar<Factory##_registrar, Class> { \
 		static void set_creator_key() { \
-			BOOST_ASSERT(!Factory::can_create(Key)); \
 			_creator.key = Key; \
 		} \
 	};
@@ -4,6 +4,8 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
+#include <stdexcept>
 
 namespace cobalt {
 namespace compiletime {
@@ -22,13 +24,19 @@ constexpr uint32_t murmur3_32_hashround(uint32_t k, uint32_t hash)
 	return (((hash ^ k) << 13) | ((hash ^ k) >> 19)) * 5ull + 0xe6546b64;
 }
 
+constexpr uint32_t byte(char c)
+{
+	// Read bytes as unsigned to match runtime implementation for non-ASCII strings
+	return static_cast<uint8_t>(c);
+}
+
 constexpr uint32_t word32le(const char* s, uint32_t len)
 {
 	return
-		(len > 0 ? static_cast<uint32_t>(s[0]) : 0)
-		| (len > 1 ? (static_cast<uint32_t>(s[1]) << 8) : 0)
-		| (len > 2 ? (static_cast<uint32_t>(s[2]) << 16) : 0)
-		| (len > 3 ? (static_cast<uint32_t>(s[3]) << 24) : 0);
+		(len > 0 ? byte(s[0]) : 0)
+		| (len > 1 ? (byte(s[1]) << 8) : 0)
+		| (len > 2 ? (byte(s[2]) << 16) : 0)
+		| (len > 3 ? (byte(s[3]) << 24) : 0);
 }
 
 constexpr uint32_t word32le(const char* s)
@@ -38,12 +46,9 @@ constexpr uint32_t word32le(const char* s)
 
 constexpr uint32_t murmur3_32_loop(const char* key, uint32_t len, uint32_t hash)
 {
-	return len == 0 ? hash :
-		murmur3_32_loop(
-			key + 4,
-			len - 1,
-			murmur3_32_hashround(
-				murmur3_32_k(word32le(key)), hash));
+	for (; len > 0; --len, key += 4)
+		hash = murmur3_32_hashround(murmur3_32_k(word32le(key)), hash);
+	return hash;
 }
 
 constexpr uint32_t murmur3_32_end0(uint32_t k)
@@ -54,17 +59,17 @@ constexpr uint32_t murmur3_32_end0(uint32_t k)
 
 constexpr uint32_t murmur3_32_end1(uint32_t k, const char* key)
 {
-	return murmur3_32_end0(k ^ static_cast<uint32_t>(key[0]));
+	return murmur3_32_end0(k ^ byte(key[0]));
 }
 
 constexpr uint32_t murmur3_32_end2(uint32_t k, const char* key)
 {
-	return murmur3_32_end1(k ^ (static_cast<uint32_t>(key[1]) << 8), key);
+	return murmur3_32_end1(k ^ (byte(key[1]) << 8), key);
 }
 
 constexpr uint32_t murmur3_32_end3(uint32_t k, const char* key)
 {
-	return murmur3_32_end2(k ^ (static_cast<uint32_t>(key[2]) << 16), key);
+	return murmur3_32_end2(k ^ (byte(key[2]) << 16), key);
 }
 
 constexpr uint32_t murmur3_32_end(uint32_t hash, const char* key, uint32_t rem)
@@ -110,27 +115,38 @@ constexpr uint32_t murmur3_32_value(const char* key, uint32_t len, uint32_t seed
 
 constexpr uint32_t fnv1_32(uint32_t h, const char* s)
 {
-	return *s == 0 ? h : fnv1_32(h * 0x1000193 ^ static_cast<uint32_t>(*s), s + 1);
+	for (; *s; ++s)
+		h = (h * 0x1000193) ^ static_cast<uint32_t>(*s);
+	return h;
 }
 
 constexpr uint32_t fnv1a_32(uint32_t h, const char* s)
 {
-	return *s == 0 ? h : fnv1_32((h ^ static_cast<uint32_t>(*s)) * 0x1000193, s + 1);
+	for (; *s; ++s)
+		h = (h ^ static_cast<uint32_t>(*s)) * 0x1000193;
+	return h;
 }
 
 constexpr uint64_t fnv1_64(uint64_t h, const char* s)
 {
-	return *s == 0 ? h : fnv1_64((h * 0x100000001b3) ^ static_cast<uint64_t>(*s), s + 1);
+	for (; *s; ++s)
+		h = (h * 0x100000001b3) ^ static_cast<uint64_t>(*s);
+	return h;
 }
 
 constexpr uint64_t fnv1a_64(uint64_t h, const char* s)
 {
-	return *s == 0 ? h : fnv1_64((h ^ static_cast<uint64_t>(*s)) * 0x100000001b3, s + 1);
+	for (; *s; ++s)
+		h = (h ^ static_cast<uint64_t>(*s)) * 0x100000001b3;
+	return h;
 }
 
 constexpr uint32_t length(const char* str)
 {
-	return *str == 0 ? 0 : 1 + length(str + 1);
+	uint32_t len = 0;
+	while (str[len])
+		++len;
+	return len;
 }
 
 } // namespace detail
@@ -164,6 +180,147 @@ constexpr uint64_t fnv1a_64(const char* s)
 {
 	return detail::fnv1a_64(0xcbf29ce484222325, s);
 }
+
+/// Perfect hash table over a fixed set of 32-bit hashes
+///
+/// Maps every key of the set to its position in the original key list, so
+/// a string can be dispatched with one hash and one table lookup:
+///
+///     constexpr auto commands = compiletime::make_perfect_hash_table({ "load"_hash, "save"_hash });
+///     switch (commands.find(murmur3(str, 0))) {
+///     case commands.find("load"_hash): ...
+///     case commands.find("save"_hash): ...
+///     }
+///
+/// Built with hash-and-displace: keys are split into buckets by the first
+/// level hash, then every bucket gets its own seed (or a direct slot if it
+/// has a single key) so that all keys land into distinct slots.
+template <size_t N>
+class perfect_hash_table {
+public:
+	static_assert(N > 0, "Perfect hash table must have at least one key");
+	
+	static constexpr size_t npos = N;
+	
+	constexpr explicit perfect_hash_table(const uint32_t (&keys)[N]) {
+		for (size_t i = 0; i < N; ++i) {
+			for (size_t j = 0; j < i; ++j) {
+				if (keys[i] == keys[j])
+					throw std::invalid_argument("duplicate key in perfect hash table");
+			}
+		}
+		
+		size_t bucket_of[N] = {};
+		size_t bucket_size[capacity] = {};
+		size_t order[capacity] = {};
+		
+		for (size_t i = 0; i < N; ++i) {
+			bucket_of[i] = mix(keys[i], 0) & mask;
+			++bucket_size[bucket_of[i]];
+		}
+		
+		// Place bigger buckets first while the table is still sparse
+		for (size_t i = 0; i < capacity; ++i) {
+			size_t j = i;
+			for (; j > 0 && bucket_size[order[j - 1]] < bucket_size[i]; --j)
+				order[j] = order[j - 1];
+			order[j] = i;
+		}
+		
+		bool used[capacity] = {};
+		
+		for (size_t b = 0; b < capacity && bucket_size[order[b]] > 1; ++b) {
+			const size_t bucket = order[b];
+			
+			for (uint32_t seed = 1; ; ++seed) {
+				if (seed == max_seed)
+					throw std::logic_error("unable to build perfect hash table");
+				
+				size_t slots[N] = {};
+				size_t count = 0;
+				bool ok = true;
+				
+				for (size_t i = 0; i < N && ok; ++i) {
+					if (bucket_of[i] != bucket)
+						continue;
+					size_t slot = mix(keys[i], seed) & mask;
+					ok = !used[slot];
+					for (size_t k = 0; k < count && ok; ++k)
+						ok = slots[k] != slot;
+					slots[count++] = slot;
+				}
+				
+				if (ok) {
+					for (size_t i = 0, k = 0; i < N; ++i) {
+						if (bucket_of[i] == bucket) {
+							used[slots[k]] = true;
+							_slots[slots[k++]] = { keys[i], i };
+						}
+					}
+					_seeds[bucket] = static_cast<int32_t>(seed);
+					break;
+				}
+			}
+		}
+		
+		// Single key buckets go directly into the remaining free slots
+		for (size_t i = 0, slot = 0; i < N; ++i) {
+			if (bucket_size[bucket_of[i]] != 1)
+				continue;
+			while (used[slot])
+				++slot;
+			used[slot] = true;
+			_slots[slot] = { keys[i], i };
+			_seeds[bucket_of[i]] = -static_cast<int32_t>(slot) - 1;
+		}
+	}
+	
+	constexpr size_t size() const noexcept { return N; }
+	
+	/// @return Position of the key in the original key list, or `npos` if not found
+	constexpr size_t find(uint32_t key) const noexcept {
+		const int32_t seed = _seeds[mix(key, 0) & mask];
+		const size_t slot = seed < 0 ? static_cast<size_t>(-seed - 1) : mix(key, static_cast<uint32_t>(seed)) & mask;
+		return _slots[slot].index != npos && _slots[slot].key == key ? _slots[slot].index : npos;
+	}
+	
+	constexpr bool contains(uint32_t key) const noexcept { return find(key) != npos; }
+	
+private:
+	static constexpr size_t round_up_pow2(size_t n) noexcept {
+		size_t p = 1;
+		while (p < n)
+			p <<= 1;
+		return p;
+	}
+	
+	static constexpr uint32_t mix(uint32_t key, uint32_t seed) noexcept {
+		uint32_t h = key ^ (seed * 0x9e3779b9);
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >> 16;
+		return h;
+	}
+	
+	static constexpr size_t capacity = round_up_pow2(N);
+	static constexpr size_t mask = capacity - 1;
+	static constexpr uint32_t max_seed = 1 << 20;
+	
+	struct slot_type {
+		uint32_t key = 0;
+		size_t index = npos;
+	};
+	
+	int32_t _seeds[capacity] = {};
+	slot_type _slots[capacity] = {};
+};
+
+template <size_t N>
+constexpr perfect_hash_table<N> make_perfect_hash_table(const uint32_t (&keys)[N]) {
+	return perfect_hash_table<N>(keys);
+}
 	
 } // namespace compiletime
 
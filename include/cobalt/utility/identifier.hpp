@@ -3,23 +3,154 @@
 
 #pragma once
 
-#include <boost/flyweight.hpp>
+// Classes in this file:
+//     hashed_string
+//     basic_identifier
 
+#include <cobalt/utility/hash.hpp>
+
+#include <atomic>
+#include <functional>
+#include <iosfwd>
 #include <string>
+#include <string_view>
 
 namespace cobalt {
 
+/// String with precomputed hash
+///
+/// Produced by `_id` literal to intern identifiers without hashing them at runtime.
+struct hashed_string {
+	std::string_view str;
+	uint32_t hash = 0;
+};
+
+constexpr hashed_string operator ""_id(const char* str, size_t len) {
+	return { { str, len }, compiletime::murmur3_32(str, len, 0) };
+}
+
+namespace detail {
+
+struct identifier_entry {
+	identifier_entry(std::string_view str, uint32_t hash, const identifier_entry* next)
+		: value(str), hash(hash), next(next)
+	{
+	}
+
+	const std::string value;
+	const uint32_t hash;
+	std::atomic<const identifier_entry*> next;
+};
+
+/// Lock-free intern table
+///
+/// Entries are never removed, so lookups just walk bucket chains and insertions
+/// publish new entries with a single CAS on the bucket head.
+template <typename Tag>
+class identifier_table {
+public:
+	static const identifier_entry* intern(std::string_view str, uint32_t hash) {
+		auto&& head = _buckets[hash & (kBucketCount - 1)];
+
+		auto first = head.load(std::memory_order_acquire);
+		if (auto found = find(first, nullptr, str, hash))
+			return found;
+
+		auto entry = new identifier_entry(str, hash, first);
+
+		// Another thread may have inserted the same string after we looked at the bucket
+		while (!head.compare_exchange_weak(first, entry, std::memory_order_release, std::memory_order_acquire)) {
+			if (auto found = find(first, entry->next.load(std::memory_order_relaxed), str, hash)) {
+				delete entry;
+				return found;
+			}
+			entry->next.store(first, std::memory_order_relaxed);
+		}
+
+		return entry;
+	}
+
+private:
+	static const identifier_entry* find(const identifier_entry* first, const identifier_entry* last, std::string_view str, uint32_t hash) noexcept {
+		for (auto entry = first; entry != last; entry = entry->next.load(std::memory_order_acquire)) {
+			if (entry->hash == hash && entry->value == str)
+				return entry;
+		}
+		return nullptr;
+	}
+
+	static constexpr size_t kBucketCount = 4096;
+
+	inline static std::atomic<const identifier_entry*> _buckets[kBucketCount];
+};
+
+} // namespace detail
+
+/// Interned string
+///
+/// Equal strings share the same immortal table entry, so copying and comparing
+/// identifiers is a single pointer operation. The entry also stores string hash,
+/// which is the same as of `_hash` literal for this string.
 template <typename Tag>
-using basic_identifier = boost::flyweight<
-	std::string,
-	boost::flyweights::tag<Tag>,
-	boost::flyweights::hashed_factory<
-		std::hash<std::string>,
-		std::equal_to<std::string>,
-		std::allocator<boost::mpl::_1>
-	>,
-	boost::flyweights::tracking<boost::flyweights::refcounted>
->;
+class basic_identifier {
+public:
+	using value_type = std::string;
+
+	constexpr basic_identifier() noexcept = default;
+
+	basic_identifier(std::string_view str)
+		: basic_identifier(hashed_string{ str, murmur3(str.data(), str.size(), 0) })
+	{
+	}
+
+	basic_identifier(const char* str)
+		: basic_identifier(std::string_view(str))
+	{
+	}
+
+	basic_identifier(const std::string& str)
+		: basic_identifier(std::string_view(str))
+	{
+	}
+
+	basic_identifier(const hashed_string& str)
+		: _entry(str.str.empty() ? nullptr : detail::identifier_table<Tag>::intern(str.str, str.hash))
+	{
+	}
+
+	const value_type& get() const noexcept { return _entry ? _entry->value : empty_value(); }
+	operator const value_type&() const noexcept { return get(); }
+
+	std::string_view view() const noexcept { return get(); }
+	const char* c_str() const noexcept { return get().c_str(); }
+
+	size_t size() const noexcept { return get().size(); }
+	bool empty() const noexcept { return !_entry; }
+
+	/// Murmur3 hash of the string with zero seed
+	uint32_t hash() const noexcept { return _entry ? _entry->hash : 0; }
+
+	friend bool operator==(const basic_identifier& lhs, const basic_identifier& rhs) noexcept { return lhs._entry == rhs._entry; }
+	friend bool operator!=(const basic_identifier& lhs, const basic_identifier& rhs) noexcept { return lhs._entry != rhs._entry; }
+	friend bool operator<(const basic_identifier& lhs, const basic_identifier& rhs) noexcept { return lhs.get() < rhs.get(); }
+
+	friend size_t hash_value(const basic_identifier& id) noexcept { return id.hash(); }
+
+	template <typename CharT, typename Traits>
+	friend std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const basic_identifier& id) {
+		return os << id.get();
+	}
+
+	friend void swap(basic_identifier& lhs, basic_identifier& rhs) noexcept { std::swap(lhs._entry, rhs._entry); }
+
+private:
+	static const value_type& empty_value() noexcept {
+		static const value_type empty;
+		return empty;
+	}
+
+	const detail::identifier_entry* _entry = nullptr;
+};
 
 struct generic_identifier_tag {};
 
@@ -27,4 +158,13 @@ using identifier = basic_identifier<generic_identifier_tag>;
 
 } // namespace cobalt
 
+namespace std {
+
+template <typename Tag>
+struct hash<cobalt::basic_identifier<Tag>> {
+	size_t operator()(const cobalt::basic_identifier<Tag>& id) const noexcept { return id.hash(); }
+};
+
+} // namespace std
+
 #endif // COBALT_UTILITY_IDENTIFIER_HPP_INCLUDED
@@ -0,0 +1,68 @@
+#ifndef COBALT_UTILITY_RADIX_SORT_HPP_INCLUDED
+#define COBALT_UTILITY_RADIX_SORT_HPP_INCLUDED
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace cobalt {
+
+/// Sorts keys by their bits above `low_bit`, keys equal in them keep their order
+///
+/// LSD radix sort by bytes. Counts of all bytes are gathered in one pass, and
+/// passes over bytes which are the same in all keys are skipped. `scratch` must
+/// have room for `count` keys. Short ranges are sorted by `std::stable_sort`.
+inline void radix_sort(uint64_t* keys, uint64_t* scratch, size_t count, unsigned low_bit = 0) {
+	constexpr size_t digits = sizeof(uint64_t);
+	constexpr size_t radix = 256;
+	constexpr size_t short_range = 64;
+
+	if (count < 2 || low_bit >= 64)
+		return;
+	if (count < short_range) {
+		std::stable_sort(keys, keys + count, [low_bit](uint64_t a, uint64_t b) { return (a >> low_bit) < (b >> low_bit); });
+		return;
+	}
+
+	// Partially covered byte is sorted whole with low bits masked out
+	const size_t first_digit = low_bit / 8;
+	const uint64_t mask = ~uint64_t() << low_bit;
+
+	std::array<std::array<uint32_t, radix>, digits> counts{};
+	for (size_t i = 0; i < count; ++i) {
+		auto key = keys[i] & mask;
+		for (size_t d = first_digit; d < digits; ++d)
+			++counts[d][(key >> (d * 8)) & 0xff];
+	}
+
+	auto source = keys, target = scratch;
+	for (size_t d = first_digit; d < digits; ++d) {
+		auto&& c = counts[d];
+		auto shift = d * 8;
+		if (c[(source[0] & mask) >> shift & 0xff] == count)
+			continue;
+
+		// Counts become offsets of buckets
+		uint32_t offset = 0;
+		for (auto&& n : c) {
+			auto size = n;
+			n = offset;
+			offset += size;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			auto key = source[i];
+			target[c[((key & mask) >> shift) & 0xff]++] = key;
+		}
+		std::swap(source, target);
+	}
+
+	if (source != keys)
+		std::memcpy(keys, source, count * sizeof(uint64_t));
+}
+
+} // namespace cobalt
+
+#endif // COBALT_UTILITY_RADIX_SORT_HPP_INCLUDED
@@ -8,7 +8,9 @@
 
 #include <boost/functional/hash.hpp>
 
+#include <mutex>
 #include <string_view>
+#include <unordered_map>
 
 #define DECLARE_UID_WITH_NAME(Type, Name) \
 	inline constexpr const char* get_uid_name(const Type*) noexcept { return Name; }
@@ -35,6 +37,11 @@ class uid {
 public:
 	const char* name() const noexcept { return _name; }
 	
+	/// Dense ordinal assigned at registration, `null` uid has index 0
+	size_t index() const noexcept { return _index; }
+	/// Number of registered uids, upper bound for indices
+	static size_t count() noexcept { return counter(); }
+	
 	size_t hash_value() const noexcept { return boost::hash_value(this); }
 	friend size_t hash_value(const uid& uid) noexcept { return uid.hash_value(); }
 	
@@ -49,15 +56,31 @@ public:
 	static constexpr const uid& null() noexcept { return data<std::nullptr_t>::instance; }
 	
 	static const uid& from_string(std::string_view name) noexcept {
-		for (auto p = head(); p; p = p->_next) {
-			if (name == p->_name)
-				return *p;
+		static std::mutex mutex;
+		static std::unordered_map<std::string_view, const uid*> index;
+		static size_t indexed_count = 0;
+		
+		std::lock_guard<std::mutex> lock(mutex);
+		
+		// Index uids registered since last lookup, e.g. by loaded modules
+		if (indexed_count != count()) {
+			for (auto p = head(); p; p = p->_next)
+				index.emplace(p->_name, p);
+			indexed_count = count();
 		}
-		return null();
+		
+		auto it = index.find(name);
+		return it != index.end() ? *it->second : null();
 	}
 	
 private:
-	explicit uid(const char* name) noexcept : _name(name), _next(head()) { head() = this; }
+	explicit uid(const char* name) noexcept
+		: _name(name)
+		, _index(this == &null() ? 0 : counter()++)
+		, _next(head())
+	{
+		head() = this;
+	}
 	
 	uid(const uid&) = delete;
 	uid& operator=(const uid&) = delete;
@@ -67,8 +90,15 @@ private:
 		return head;
 	}
 	
+	static size_t& counter() noexcept {
+		// Index 0 is reserved for `null`
+		static size_t counter = 1;
+		return counter;
+	}
+	
 private:
 	const char* _name = nullptr;
+	size_t _index = 0;
 	uid* _next = nullptr;
 	
 	template <typename T>
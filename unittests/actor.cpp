@@ -4,6 +4,9 @@
 
 #include <boost/container/small_vector.hpp>
 
+#include <atomic>
+#include <thread>
+
 using namespace cobalt;
 
 using my_component_factory = auto_factory<actor_component(int), const char*>;
@@ -120,5 +123,340 @@ TEST_CASE("actor", "[actor]") {
 		auto num = actor1->find_components<bone_component>(std::back_inserter(components));
 		REQUIRE(num == 8);
 		REQUIRE(num == components.size());
+		
+		auto range = actor1->find_components<bone_component>();
+		REQUIRE(range.size() == 8);
+		REQUIRE(std::equal(range.begin(), range.end(), components.begin()));
+		REQUIRE(actor1->find_component<bone_component>() == range[0]);
+		REQUIRE(actor1->find_components<sample_component>().empty());
+		
+		// Breadth first order isn't indexed, but finds the same set
+		components.clear();
+		REQUIRE(actor1->find_components<bone_component>(std::back_inserter(components), traverse_order::breadth_first) == 8);
+		REQUIRE(actor1->find_component<bone_component>(traverse_order::breadth_first) == actor1->transform());
+	}
+	
+	SECTION("component index") {
+		auto actor1 = create_actor();
+		auto body = actor1->transform();
+		REQUIRE(actor1->find_components<bone_component>().size() == 8);
+		
+		// Index follows hierarchy changes below the root
+		auto head = &*std::find_if(body->children().begin(), body->children().end(), [](auto&& c) { return c.name() == identifier("head"); });
+		head->add_child(new bone_component("nose"));
+		REQUIRE(actor1->find_components<bone_component>().size() == 9);
+		
+		ref_ptr<transform_component> keep(head);
+		body->remove_child(head);
+		REQUIRE(actor1->find_components<bone_component>().size() == 4);
+		
+		REQUIRE_FALSE(actor1->find_component<sample_component>());
+		auto sample = object::create_instance<sample_component>();
+		actor1->add_component(sample);
+		REQUIRE(actor1->find_component<sample_component>() == sample);
+		actor1->remove_component(sample);
+		REQUIRE_FALSE(actor1->find_component<sample_component>());
+		
+		actor1->transform(nullptr);
+		REQUIRE(actor1->find_components<bone_component>().empty());
+		REQUIRE(actor1->find_component<audio_component>());
+	}
+	
+	SECTION("nested actors") {
+		auto outer = make_ref<actor>();
+		auto inner = make_ref<actor>();
+		outer->transform(new transform_component());
+		inner->transform(new transform_component());
+		auto leaf = new bone_component("leaf");
+		inner->transform()->add_child(leaf);
+		outer->transform()->add_child(inner->transform());
+		REQUIRE(outer->find_components<bone_component>().size() == 1);
+		REQUIRE(inner->find_components<bone_component>().size() == 1);
+		
+		// Changes below inner actor invalidate index of outer one too
+		inner->transform()->remove_child(leaf);
+		REQUIRE(outer->find_components<bone_component>().empty());
+		inner->transform()->add_child(new bone_component("leaf"));
+		REQUIRE(outer->find_components<bone_component>().size() == 1);
+		
+		// Transform outlives its actor as a child of another transform
+		ref_ptr<transform_component> inner_transform(inner->transform());
+		inner.reset();
+		REQUIRE(inner_transform->actor() == outer.get());
+		inner_transform->clear_children();
+		REQUIRE(outer->find_components<bone_component>().empty());
+		outer.reset();
+	}
+}
+
+TEST_CASE("traverse", "[actor]") {
+	auto actor1 = create_actor();
+	auto body = actor1->transform();
+	
+	auto names = [](transform_component* root, traverse_order order) {
+		std::string result;
+		root->traverse(order, [&](transform_component* node) {
+			if (!node->name().empty())
+				result += node->name().get() + " ";
+			return true;
+		});
+		return result;
+	};
+	
+	REQUIRE(names(body, traverse_order::depth_first) == "body head jaw left_eye right_eye left_fin right_fin tail ");
+	REQUIRE(names(body, traverse_order::breadth_first) == "body head left_fin right_fin tail jaw left_eye right_eye ");
+	
+	// Subtree walk doesn't leave its root
+	auto head = body->first_child();
+	REQUIRE(names(head, traverse_order::depth_first) == "head jaw left_eye right_eye ");
+	REQUIRE(names(head, traverse_order::breadth_first) == "head jaw left_eye right_eye ");
+	
+	SECTION("early exit") {
+		int visited = 0;
+		REQUIRE_FALSE(body->traverse(traverse_order::depth_first, [&](transform_component*) { return ++visited < 3; }));
+		REQUIRE(visited == 3);
+	}
+	
+	SECTION("nested") {
+		size_t total = 0;
+		body->traverse(traverse_order::breadth_first, [&](transform_component* node) {
+			node->traverse(traverse_order::breadth_first, [&](transform_component*) { ++total; return true; });
+			return true;
+		});
+		// Every node is counted once per ancestor including itself
+		REQUIRE(total == 1 + 2 * 5 + 3 * 3);
+	}
+	
+	SECTION("visit") {
+		std::string result;
+		int depth = 0, max_depth = 0;
+		body->visit([&](transform_component* node) {
+			max_depth = std::max(max_depth, ++depth);
+			result += "(" + node->name().get();
+			return node != head;
+		}, [&](transform_component*) {
+			--depth;
+			result += ")";
+		});
+		REQUIRE(depth == 0);
+		REQUIRE(max_depth == 2);
+		REQUIRE(result == "(body(head)(left_fin)(right_fin)(tail)())");
+	}
+}
+
+TEST_CASE("world transform", "[actor]") {
+	auto actor1 = create_actor();
+	auto body = actor1->transform();
+	auto head = body->first_child();
+	auto jaw = head->first_child();
+	
+	body->position({10, 0, 0});
+	head->position({0, 1, 0});
+	jaw->position({0, 0, 1});
+	REQUIRE(jaw->dirty());
+	
+	REQUIRE(jaw->world_matrix().transform_point({}) == vec3(10, 1, 1));
+	REQUIRE_FALSE(jaw->dirty());
+	REQUIRE_FALSE(head->dirty());
+	
+	// Change propagates to descendants only
+	head->scale({2, 2, 2});
+	REQUIRE(head->dirty());
+	REQUIRE(jaw->dirty());
+	REQUIRE_FALSE(body->dirty());
+	REQUIRE(jaw->world_matrix().transform_point({}) == vec3(10, 1, 2));
+	
+	SECTION("reparent") {
+		ref_ptr<transform_component> keep(jaw);
+		head->remove_child(jaw);
+		REQUIRE(jaw->world_matrix().transform_point({}) == vec3(0, 0, 1));
+		body->add_child(jaw);
+		REQUIRE(jaw->world_matrix().transform_point({}) == vec3(10, 0, 1));
+	}
+	
+	SECTION("level") {
+		level level1;
+		level1.add_actor(actor1.get());
+		
+		auto actor2 = create_actor();
+		level1.add_actor(actor2.get());
+		actor2->transform()->position({0, 5, 0});
+		
+		level1.update_transforms();
+		for (auto a : { actor1.get(), actor2.get() }) {
+			a->transform()->traverse(traverse_order::depth_first, [](transform_component* node) {
+				REQUIRE_FALSE(node->dirty());
+				return true;
+			});
+		}
+		REQUIRE(actor2->transform()->first_child()->world_matrix().transform_point({}) == vec3(0, 5, 0));
+		
+		// New nodes are picked up by the next update
+		auto nose = new bone_component("nose");
+		head->add_child(nose);
+		nose->position({1, 0, 0});
+		level1.update_transforms();
+		REQUIRE_FALSE(nose->dirty());
+		REQUIRE(nose->world_matrix().transform_point({}) == vec3(12, 1, 0));
+		
+		level1.clear_actors();
+	}
+	
+	SECTION("nested actors") {
+		level level1;
+		level1.add_actor(actor1.get());
+		auto actor2 = make_ref<actor>();
+		actor2->transform(new transform_component());
+		level1.add_actor(actor2.get());
+		head->add_child(actor2->transform());
+		actor2->transform()->position({0, 0, 3});
+		
+		auto leaf = new bone_component("leaf");
+		actor2->transform()->add_child(leaf);
+		level1.update_transforms();
+		REQUIRE_FALSE(leaf->dirty());
+		REQUIRE(leaf->world_matrix().transform_point({}) == vec3(10, 1, 6));
+		
+		// Changes below nested actor rebuild order of the level
+		actor2->transform()->remove_child(leaf);
+		auto leaf2 = new bone_component("leaf2");
+		actor2->transform()->add_child(leaf2);
+		leaf2->position({1, 0, 0});
+		level1.update_transforms();
+		REQUIRE_FALSE(leaf2->dirty());
+		REQUIRE(leaf2->world_matrix().transform_point({}) == vec3(12, 1, 6));
+		
+		// Nested actor is walked on its own once its parent leaves the level
+		level1.remove_actor(actor1.get());
+		body->position({});
+		level1.update_transforms();
+		REQUIRE_FALSE(leaf2->dirty());
+		REQUIRE(leaf2->world_matrix().transform_point({}) == vec3(2, 1, 6));
+		
+		level1.clear_actors();
+	}
+}
+
+TEST_CASE("spatial index", "[actor]") {
+	level level1;
+	auto actor1 = make_ref<actor>();
+	auto actor2 = make_ref<actor>();
+	actor1->bounds({ { 0, 0, 0 }, { 1, 1, 1 } });
+	level1.add_actor(actor1.get());
+	level1.add_actor(actor2.get());
+	REQUIRE(level1.spatial_index().size() == 1);
+	
+	std::vector<actor*> found;
+	REQUIRE(level1.query(aabb({ -1, -1, -1 }, { 0.5f, 0.5f, 0.5f }), found) == 1);
+	REQUIRE(found[0] == actor1.get());
+	
+	// Bounds follow actor
+	actor2->bounds({ { 10, 0, 0 }, { 11, 1, 1 } });
+	actor1->bounds({ { 20, 0, 0 }, { 21, 1, 1 } });
+	found.clear();
+	REQUIRE(level1.raycast({ { 0, 0.5f, 0.5f }, { 1, 0, 0 } }, 15, found) == 1);
+	REQUIRE(found[0] == actor2.get());
+	
+	level1.remove_actor(actor2.get());
+	REQUIRE(level1.spatial_index().size() == 1);
+	actor1->bounds({});
+	REQUIRE(level1.spatial_index().empty());
+	level1.clear_actors();
+}
+
+struct velocity {
+	float x = 0, y = 0;
+};
+
+struct health {
+	int value = 100;
+};
+
+TEST_CASE("data components", "[actor]") {
+	auto actor1 = make_ref<actor>();
+	actor1->add_data<velocity>(velocity{ 1, 2 });
+	REQUIRE(actor1->data<velocity>());
+	REQUIRE(actor1->data<velocity>()->y == 2);
+	REQUIRE(actor1->data<health>() == nullptr);
+	REQUIRE(&actor1->storage() == &component_storage::detached());
+	
+	SECTION("remove") {
+		auto handle = actor1->data_handle<velocity>();
+		REQUIRE(handle);
+		actor1->remove_data<velocity>();
+		REQUIRE(actor1->data<velocity>() == nullptr);
+		REQUIRE_FALSE(component_storage::detached().pool<velocity>().contains(handle));
 	}
+	
+	SECTION("level") {
+		level level1;
+		level1.add_actor(actor1.get());
+		REQUIRE(&actor1->storage() == &level1.storage());
+		REQUIRE(actor1->data<velocity>()->x == 1);
+		REQUIRE(level1.view<velocity>().size() == 1);
+		REQUIRE(level1.view<velocity>().owner(0) == actor1.get());
+		
+		auto actor2 = make_ref<actor>();
+		level1.add_actor(actor2.get());
+		actor2->add_data<velocity>(velocity{ 3, 4 });
+		actor2->add_data<health>();
+		
+		int visited = 0;
+		level1.each<velocity>([&](actor&, velocity& v) {
+			v.x += 10;
+			++visited;
+		});
+		REQUIRE(visited == 2);
+		
+		visited = 0;
+		level1.each<velocity, health>([&](actor& a, velocity& v, health& h) {
+			REQUIRE(&a == actor2.get());
+			h.value -= int(v.x);
+			++visited;
+		});
+		REQUIRE(visited == 1);
+		REQUIRE(actor2->data<health>()->value == 87);
+		
+		// Data follows actor out of level
+		level1.remove_actor(actor2.get());
+		REQUIRE(level1.view<velocity>().size() == 1);
+		REQUIRE(level1.view<health>().empty());
+		REQUIRE(actor2->data<health>()->value == 87);
+		REQUIRE(actor2->data<velocity>()->x == 13);
+		
+		level1.clear_actors();
+		REQUIRE(level1.view<velocity>().empty());
+		REQUIRE(actor1->data<velocity>()->x == 11);
+	}
+	
+	SECTION("detached actors on threads") {
+		// Detached storage is shared by all threads
+		std::vector<std::thread> threads;
+		std::atomic<int> preserved{0};
+		for (int t = 0; t < 4; ++t) {
+			threads.emplace_back([t, &preserved] {
+				level level1;
+				for (int i = 0; i < 100; ++i) {
+					auto a = make_ref<actor>();
+					a->add_data<velocity>(velocity{ float(t), float(i) });
+					a->add_data<health>();
+					level1.add_actor(a.get());
+					level1.remove_actor(a.get());
+					{
+						// Other threads may move detached data meanwhile
+						auto lock = component_storage::lock_if_detached(a->storage());
+						if (a->data<velocity>()->y == float(i))
+							++preserved;
+					}
+					a->remove_data<health>();
+				}
+			});
+		}
+		for (auto&& thread : threads)
+			thread.join();
+		REQUIRE(preserved == 400);
+		REQUIRE(component_storage::detached().pool<health>().size() == 0);
+	}
+	
+	actor1.reset();
 }
@@ -3,6 +3,8 @@
 #include <cobalt/utility/intrusive.hpp>
 
 #include <memory>
+#include <thread>
+#include <vector>
 
 using namespace cobalt;
 
@@ -99,6 +101,13 @@ TEST_CASE("uid", "[com]") {
 	REQUIRE(UIDOF(test::updatable).name() == std::string_view("test::updatable"));
 	REQUIRE(UIDOF(com::any).name() == std::string_view("com::any"));
 	REQUIRE_FALSE(UIDOF(test::updatable) == UIDOF(com::any));
+	REQUIRE(UIDSTR("test::unknown") == uid::null());
+	
+	REQUIRE(uid::null().index() == 0);
+	REQUIRE(UIDOF(test::updatable).index() != 0);
+	REQUIRE(UIDOF(test::updatable).index() != UIDOF(com::any).index());
+	REQUIRE(UIDOF(test::updatable).index() < uid::count());
+	REQUIRE(UIDOF(com::any).index() < uid::count());
 }
 
 TEST_CASE("stack_object/chain_cast", "[com]") {
@@ -120,6 +129,10 @@ TEST_CASE("stack_object/chain_cast", "[com]") {
 		REQUIRE(!ec);
 		REQUIRE(lft);
 		
+		// Interfaces of second base and of chained class are at their own addresses
+		REQUIRE(upd.get() == static_cast<test::updatable*>(&object));
+		REQUIRE(lft.get() == static_cast<test::lifetime*>(&object));
+		
 		REQUIRE(com::identical(upd, lft));
 		
 		guard = lft->guard();
@@ -219,6 +232,9 @@ TEST_CASE("coclass/tear_off", "[com]") {
 		REQUIRE(!ec);
 		REQUIRE(upd);
 		
+		auto object = static_cast<test::my_object2*>(lft.get());
+		REQUIRE(upd.get() == static_cast<test::updatable*>(object));
+		
 		REQUIRE(com::identical(upd, lft));
 		REQUIRE(com::identical(lft, drw));
 		REQUIRE(com::identical(drw, upd));
@@ -585,6 +601,224 @@ TEST_CASE("coclass/autoaggregate_blind", "[com]") {
 
 namespace test {
 
+template <typename ThreadModel>
+class threaded_object
+	: public com::object_base_ex<ThreadModel>
+	, public lifetime_impl
+	, public com::coclass<threaded_object<ThreadModel>>
+{
+public:
+	BEGIN_CAST_MAP(threaded_object)
+		CAST_ENTRY(lifetime)
+	END_CAST_MAP()
+	
+	DECLARE_GET_OUTER_OBJECT()
+};
+
+} // namespace test
+
+TEMPLATE_TEST_CASE("thread models", "[com]", com::single_thread_model, com::multi_thread_model, com::biased_thread_model) {
+	std::error_code ec;
+	
+	auto lft = test::threaded_object<TestType>::template create_instance<test::lifetime>(ec);
+	REQUIRE(!ec);
+	REQUIRE(lft);
+	
+	std::weak_ptr<void> guard = lft->guard();
+	
+	auto copy_refs = [&] {
+		for (int i = 0; i < 10000; ++i) {
+			auto copy = lft;
+			copy.reset();
+		}
+	};
+	
+	if constexpr (std::is_same_v<TestType, com::single_thread_model>) {
+		copy_refs();
+	} else {
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; ++i)
+			threads.emplace_back(copy_refs);
+		copy_refs();
+		for (auto&& thread : threads)
+			thread.join();
+	}
+	
+	REQUIRE_FALSE(guard.expired());
+	
+	lft.reset();
+	REQUIRE(guard.expired());
+}
+
+TEST_CASE("biased thread model", "[com]") {
+	using biased_object = test::threaded_object<com::biased_thread_model>;
+	std::error_code ec;
+	
+	auto lft = biased_object::create_instance<test::lifetime>(ec);
+	REQUIRE(!ec);
+	std::weak_ptr<void> guard = lft->guard();
+	
+	SECTION("release by other thread") {
+		// Reference acquired by owner is queued for owner thread
+		auto moved = lft;
+		std::thread([moved = std::move(moved)]() mutable { moved.reset(); }).join();
+		lft.reset();
+		REQUIRE_FALSE(guard.expired());
+		com::biased_thread_model::release_queued();
+		REQUIRE(guard.expired());
+	}
+	
+	SECTION("last reference moved to other thread") {
+		std::thread([moved = std::move(lft)]() mutable { moved.reset(); }).join();
+		REQUIRE_FALSE(guard.expired());
+		com::biased_thread_model::release_queued();
+		REQUIRE(guard.expired());
+	}
+	
+	SECTION("acquire after merge") {
+		com::ref<test::lifetime> shared, again;
+		std::thread([&] { shared = lft; }).join();
+		
+		// Owner drops its references, counters are merged
+		lft.reset();
+		REQUIRE_FALSE(guard.expired());
+		again = shared;
+		std::thread([&] { shared.reset(); }).join();
+		REQUIRE_FALSE(guard.expired());
+		again.reset();
+		REQUIRE(guard.expired());
+	}
+	
+	SECTION("owner thread exited") {
+		lft.reset();
+		REQUIRE(guard.expired());
+		
+		com::ref<test::lifetime> created, copy;
+		std::thread([&] {
+			created = biased_object::create_instance<test::lifetime>(ec);
+			copy = created;
+		}).join();
+		REQUIRE(!ec);
+		guard = created->guard();
+		created.reset();
+		REQUIRE_FALSE(guard.expired());
+		copy.reset();
+		REQUIRE(guard.expired());
+	}
+}
+
+namespace test {
+
+class pooled_drawable_tear_off_impl
+	: public com::tear_off_object_base<pooled_drawable_tear_off_impl>
+	, public drawable
+{
+public:
+	BEGIN_CAST_MAP(pooled_drawable_tear_off_impl)
+		CAST_ENTRY(drawable)
+	END_CAST_MAP()
+	
+	DECLARE_GET_OUTER_OBJECT()
+	DECLARE_POOL_ALLOCATION()
+	
+	virtual void draw() noexcept override {}
+};
+
+DECLARE_CLASS(test, pooled_object)
+class pooled_object
+	: public com::object_base
+	, public lifetime_impl
+	, public com::coclass<pooled_object>
+{
+public:
+	BEGIN_CAST_MAP(pooled_object)
+		CAST_ENTRY(lifetime)
+		CAST_ENTRY_TEAR_OFF(UIDOF(drawable), pooled_drawable_tear_off_impl)
+	END_CAST_MAP()
+	
+	DECLARE_GET_OUTER_OBJECT()
+	DECLARE_POOL_ALLOCATION()
+};
+
+DECLARE_CLASS(test, arena_object)
+class arena_object
+	: public com::object_base
+	, public lifetime_impl
+	, public com::coclass<arena_object>
+{
+public:
+	BEGIN_CAST_MAP(arena_object)
+		CAST_ENTRY(lifetime)
+	END_CAST_MAP()
+	
+	DECLARE_GET_OUTER_OBJECT()
+	DECLARE_ARENA_ALLOCATION()
+};
+
+} // namespace test
+
+TEST_CASE("allocation", "[com]") {
+	std::error_code ec;
+	
+	SECTION("pool") {
+		auto lft = test::pooled_object::create_instance<test::lifetime>(ec);
+		REQUIRE(!ec);
+		REQUIRE(lft);
+		
+		auto&& pool = com::pool_allocation::pool<com::object<test::pooled_object>>();
+		auto capacity = pool.capacity();
+		REQUIRE(capacity > 0);
+		
+		auto drw = com::cast<test::drawable>(lft, ec);
+		REQUIRE(!ec);
+		REQUIRE(drw);
+		
+		auto p = drw.get();
+		drw.reset();
+		drw = com::cast<test::drawable>(lft, ec);
+		REQUIRE(!ec);
+		REQUIRE(drw.get() == p);
+		
+		auto guard = lft->guard();
+		auto q = lft.get();
+		drw.reset();
+		lft.reset();
+		REQUIRE(guard.expired());
+		
+		lft = test::pooled_object::create_instance<test::lifetime>(ec);
+		REQUIRE(!ec);
+		REQUIRE(lft.get() == q);
+		REQUIRE(pool.capacity() == capacity);
+	}
+	
+	SECTION("arena") {
+		std::weak_ptr<void> guard;
+		
+		{
+			com::object_arena arena;
+			REQUIRE(com::object_arena::current() == &arena);
+			
+			auto lft = test::arena_object::create_instance<test::lifetime>(ec);
+			REQUIRE(!ec);
+			REQUIRE(lft);
+			REQUIRE(arena.live() == 1);
+			
+			guard = lft->guard();
+			lft.reset();
+			REQUIRE(guard.expired());
+			REQUIRE(arena.live() == 0);
+		}
+		
+		REQUIRE_FALSE(com::object_arena::current());
+		
+		auto lft = test::arena_object::create_instance<test::lifetime>(ec);
+		REQUIRE(!ec);
+		REQUIRE(lft);
+	}
+}
+
+namespace test {
+
 class my_module : public com::module<my_module> {
 public:
 	BEGIN_OBJECT_MAP(my_module)
@@ -601,6 +835,20 @@ public:
 
 static my_module m;
 
+class my_module2 : public com::module<my_module2> {
+public:
+	BEGIN_OBJECT_MAP(my_module2)
+		OBJECT_ENTRY(my_object7)
+	END_OBJECT_MAP()
+};
+
+class my_module3 : public com::module<my_module3> {
+public:
+	BEGIN_OBJECT_MAP(my_module3)
+		OBJECT_ENTRY(my_object7)
+	END_OBJECT_MAP()
+};
+
 } // namespace test
 
 TEST_CASE("module", "[com]") {
@@ -647,4 +895,46 @@ TEST_CASE("module", "[com]") {
 		lft.reset();
 		REQUIRE(guard.expired());
 	}
+	
+	SECTION("shadowing") {
+		std::error_code ec;
+		
+		auto cf = com::get_class_object(UIDOF(test::my_object7), ec);
+		REQUIRE(!ec);
+		
+		{
+			test::my_module2 m2;
+			
+			auto cf2 = com::get_class_object(UIDOF(test::my_object7), ec);
+			REQUIRE(!ec);
+			REQUIRE(cf2);
+			REQUIRE(cf2 != cf);
+			REQUIRE(cf2 == m2.get_class_object(UIDOF(test::my_object7), ec));
+			
+			auto lft = com::create_instance<test::lifetime>(UIDOF(test::my_object2), ec);
+			REQUIRE(!ec);
+			REQUIRE(lft);
+		}
+		
+		REQUIRE(com::get_class_object(UIDOF(test::my_object7), ec) == cf);
+	}
+	
+	SECTION("unregister out of order") {
+		std::error_code ec;
+		
+		auto cf = com::get_class_object(UIDOF(test::my_object7), ec);
+		REQUIRE(!ec);
+		
+		auto m2 = std::make_unique<test::my_module2>();
+		auto m3 = std::make_unique<test::my_module3>();
+		auto cf3 = m3->get_class_object(UIDOF(test::my_object7), ec);
+		REQUIRE(com::get_class_object(UIDOF(test::my_object7), ec) == cf3);
+		
+		// Newer module keeps shadowing the class
+		m2.reset();
+		REQUIRE(com::get_class_object(UIDOF(test::my_object7), ec) == cf3);
+		
+		m3.reset();
+		REQUIRE(com::get_class_object(UIDOF(test::my_object7), ec) == cf);
+	}
 }
@@ -0,0 +1,201 @@
+#include "catch2/catch.hpp"
+#include <cobalt/command_buffer.hpp>
+#include <cobalt/systems.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace cobalt;
+
+namespace {
+
+// Allocations on this thread fail while it is zero, negative never fails
+thread_local int allocations_left = -1;
+
+} // namespace
+
+void* operator new(std::size_t size) {
+	if (allocations_left == 0)
+		throw std::bad_alloc();
+	if (allocations_left > 0)
+		--allocations_left;
+	if (auto p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	} catch (const std::bad_alloc&) {
+		return nullptr;
+	}
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+
+class tracked_actor : public actor {
+public:
+	tracked_actor() { ++instances; }
+	~tracked_actor() { ++destroyed; --instances; }
+	
+	static int instances;
+	static int destroyed;
+};
+
+int tracked_actor::instances = 0;
+int tracked_actor::destroyed = 0;
+
+struct health {
+	int value = 0;
+};
+
+struct armor {
+	int value = 0;
+};
+
+} // namespace
+
+TEST_CASE("command_buffer", "[command_buffer]") {
+	level level1;
+	command_buffer commands;
+	
+	for (int i = 0; i < 10; ++i) {
+		auto a = new tracked_actor();
+		a->transform(new transform_component());
+		a->add_data<health>(health{ i });
+		level1.add_actor(a);
+	}
+	REQUIRE(tracked_actor::instances == 10);
+	tracked_actor::destroyed = 0;
+	
+	SECTION("destroy") {
+		// Nothing changes while iterating
+		level1.each<health>([&](actor& a, health& h) {
+			if (h.value % 2)
+				commands.destroy(&a);
+		});
+		REQUIRE(commands.size() == 5);
+		REQUIRE(level1.actors().size() == 10);
+		REQUIRE(tracked_actor::destroyed == 0);
+		
+		commands.apply(level1);
+		REQUIRE(commands.empty());
+		REQUIRE(level1.actors().size() == 5);
+		REQUIRE(level1.view<health>().size() == 5);
+		REQUIRE(tracked_actor::destroyed == 5);
+		
+		// Destroying twice is harmless
+		auto a = &level1.actors().front();
+		commands.destroy(const_cast<actor*>(a));
+		commands.destroy(const_cast<actor*>(a));
+		commands.apply(level1);
+		REQUIRE(level1.actors().size() == 4);
+	}
+	
+	SECTION("spawn and reparent") {
+		auto a = make_ref<actor>();
+		a->transform(new transform_component());
+		auto child = new transform_component();
+		auto first = const_cast<actor*>(&level1.actors().front());
+		first->transform()->add_child(child);
+		
+		commands.spawn(a.get());
+		commands.reparent(child, a->transform());
+		REQUIRE(a->level() == nullptr);
+		REQUIRE(child->parent() == first->transform());
+		
+		commands.apply(level1);
+		REQUIRE(a->level() == &level1);
+		REQUIRE(child->parent() == a->transform());
+		REQUIRE(a->find_components<transform_component>().size() == 2);
+		REQUIRE(first->find_components<transform_component>().size() == 1);
+		
+		commands.reparent(child, nullptr);
+		commands.apply(level1);
+		REQUIRE(a->find_components<transform_component>().size() == 1);
+	}
+	
+	SECTION("components") {
+		auto a = const_cast<actor*>(&level1.actors().back());
+		auto component = new transform_component();
+		commands.add_component(a, component);
+		REQUIRE(a->components().empty());
+		commands.apply(level1);
+		REQUIRE(a->components().size() == 1);
+		
+		commands.remove_component(a, component);
+		commands.apply(level1);
+		REQUIRE(a->components().empty());
+	}
+	
+	SECTION("failed command") {
+		auto first = ref_ptr<actor>(const_cast<actor*>(&level1.actors().front()));
+		auto last = const_cast<actor*>(&level1.actors().back());
+		// Level has no storage for armor yet, creating it fails
+		auto spawned = make_ref<actor>();
+		spawned->add_data<armor>(armor{ 5 });
+		
+		commands.destroy(first.get());
+		commands.spawn(spawned.get());
+		commands.destroy(last);
+		
+		REQUIRE_THROWS_AS([&] {
+			allocations_left = 0;
+			try {
+				commands.apply(level1);
+			} catch (...) {
+				allocations_left = -1;
+				throw;
+			}
+			allocations_left = -1;
+		}(), std::bad_alloc);
+		
+		// Commands before the failed one are done, the rest is kept
+		REQUIRE(first->level() == nullptr);
+		REQUIRE(first->data<health>());
+		REQUIRE(spawned->level() == nullptr);
+		REQUIRE(spawned->data<armor>()->value == 5);
+		REQUIRE(commands.size() == 2);
+		REQUIRE(level1.actors().size() == 9);
+		
+		commands.apply(level1);
+		REQUIRE(commands.empty());
+		REQUIRE(spawned->level() == &level1);
+		REQUIRE(level1.view<armor>().size() == 1);
+		REQUIRE(level1.actors().size() == 9);
+		REQUIRE(tracked_actor::destroyed == 1);
+	}
+	
+	SECTION("level_update") {
+		thread_pool pool(2);
+		level_update update(pool, 2);
+		update.add_system<health>(update_order::update, reads<health>{}, writes<>{}, [&](actor& a, const health& h) {
+			if (h.value < 5)
+				update.commands().destroy(&a);
+		});
+		std::atomic<int> later{0};
+		update.add_actor_system(update_order::post_update, reads<>{}, writes<>{}, [&](actor&) {
+			++later;
+		});
+		
+		update.run(level1);
+		// Commands are applied at the end of phase, the next one sees the result
+		REQUIRE(later == 5);
+		REQUIRE(level1.actors().size() == 5);
+		REQUIRE(tracked_actor::destroyed == 5);
+	}
+	
+	level1.clear_actors();
+	REQUIRE(tracked_actor::instances == 0);
+}
@@ -0,0 +1,101 @@
+#include "catch2/catch.hpp"
+#include <cobalt/component_storage.hpp>
+
+#include <string>
+
+using namespace cobalt;
+
+namespace {
+
+struct position {
+	float x = 0, y = 0;
+};
+
+struct named {
+	named() = default;
+	explicit named(std::string name) : name(std::move(name)) {}
+	std::string name;
+};
+
+} // namespace
+
+TEST_CASE("component_pool", "[component_storage]") {
+	REQUIRE(component_type_id<position>() == component_type_id<position>());
+	REQUIRE(component_type_id<position>() != component_type_id<named>());
+	
+	component_pool<named> pool;
+	auto a = pool.create(nullptr, "a");
+	auto b = pool.create(nullptr, "b");
+	auto c = pool.create(nullptr, "c");
+	REQUIRE(pool.size() == 3);
+	REQUIRE(pool.get(b)->name == "b");
+	
+	SECTION("swap remove") {
+		pool.destroy(a);
+		REQUIRE(pool.size() == 2);
+		REQUIRE_FALSE(pool.contains(a));
+		REQUIRE(pool.get(a) == nullptr);
+		
+		// Last component fills the hole, handles stay valid
+		REQUIRE(pool.data()[0].name == "c");
+		REQUIRE(pool.get(b)->name == "b");
+		REQUIRE(pool.get(c)->name == "c");
+		REQUIRE(pool.handle(0) == c);
+	}
+	
+	SECTION("generation") {
+		pool.destroy(b);
+		auto d = pool.create(nullptr, "d");
+		
+		// Slot is reused, stale handle doesn't resolve
+		REQUIRE(d.index == b.index);
+		REQUIRE(d.generation != b.generation);
+		REQUIRE(pool.get(b) == nullptr);
+		REQUIRE(pool.get(d)->name == "d");
+	}
+	
+	SECTION("move") {
+		component_pool<named> target;
+		auto moved = pool.move_to(b, target);
+		REQUIRE(pool.size() == 2);
+		REQUIRE_FALSE(pool.contains(b));
+		REQUIRE(target.get(moved)->name == "b");
+	}
+	
+	SECTION("copy") {
+		actor* owners[3] = {};
+		component_handle handles[3];
+		pool.copy_to(c, owners, 3, pool, handles);
+		REQUIRE(pool.size() == 6);
+		REQUIRE(pool.get(c)->name == "c");
+		for (auto&& h : handles)
+			REQUIRE(pool.get(h)->name == "c");
+	}
+}
+
+TEST_CASE("component_storage", "[component_storage]") {
+	component_storage storage;
+	REQUIRE(storage.find_pool<position>() == nullptr);
+	REQUIRE(storage.view<position>().empty());
+	
+	auto&& pool = storage.pool<position>();
+	REQUIRE(storage.find_pool<position>() == &pool);
+	
+	for (int i = 0; i < 100; ++i)
+		pool.create(nullptr, position{ float(i), float(-i) });
+	
+	auto view = storage.view<position>();
+	REQUIRE(view.size() == 100);
+	
+	float sum = 0;
+	for (auto&& p : view)
+		sum += p.x + p.y;
+	REQUIRE(sum == 0);
+	
+	// Untyped access creates pool of the same type
+	component_storage other;
+	auto&& copy = other.pool(component_type_id<position>(), pool);
+	auto handle = pool.move_to(pool.handle(10), copy);
+	REQUIRE(other.find_pool<position>()->get(handle)->x == 10);
+	REQUIRE(pool.size() == 99);
+}
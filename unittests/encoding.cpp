@@ -0,0 +1,383 @@
+#include "catch2/catch.hpp"
+#include <cobalt/encoding.hpp>
+
+using namespace cobalt;
+
+namespace test {
+
+DECLARE_INTERFACE(test, player_state)
+struct player_state : com::any {
+	float x = 0, y = 0, z = 0;
+	float angle = 0;
+	int health = 100;
+	int ammo = 0;
+	bool alive = true;
+};
+
+DECLARE_CLASS(test, player)
+class player
+	: public com::object_base
+	, public player_state
+	, public com::encodable
+	, public com::decodable
+	, public com::coclass<player, UIDOF(player)>
+{
+public:
+	BEGIN_CAST_MAP(player)
+		CAST_ENTRY(player_state)
+		CAST_ENTRY(com::encodable)
+		CAST_ENTRY(com::decodable)
+	END_CAST_MAP()
+
+	DECLARE_GET_OUTER_OBJECT()
+
+	virtual void encode(com::encoder* encoder, std::error_code& ec) const noexcept override {
+		auto self = const_cast<player*>(this);
+		encoder->encode("x", self->x, -1000.0f, 1000.0f, 0.01f);
+		encoder->encode("y", self->y, -1000.0f, 1000.0f, 0.01f);
+		encoder->encode("z", self->z, -1000.0f, 1000.0f, 0.01f);
+		encoder->encode("angle", self->angle, 0.0f, 360.0f, 0.1f);
+		encoder->encode("health", self->health, 0, 100);
+		encoder->encode("ammo", self->ammo, 0, 999);
+		encoder->encode("alive", self->alive);
+		ec.clear();
+	}
+
+	virtual void init(com::decoder* decoder, std::error_code& ec) noexcept override {
+		decoder->decode("x", x, -1000.0f, 1000.0f, 0.01f);
+		decoder->decode("y", y, -1000.0f, 1000.0f, 0.01f);
+		decoder->decode("z", z, -1000.0f, 1000.0f, 0.01f);
+		decoder->decode("angle", angle, 0.0f, 360.0f, 0.1f);
+		decoder->decode("health", health, 0, 100);
+		decoder->decode("ammo", ammo, 0, 999);
+		decoder->decode("alive", alive);
+		ec.clear();
+	}
+};
+
+DECLARE_CLASS(test, computed)
+class computed
+	: public com::object_base
+	, public com::encodable
+	, public com::coclass<computed, UIDOF(computed)>
+{
+public:
+	BEGIN_CAST_MAP(computed)
+		CAST_ENTRY(com::encodable)
+	END_CAST_MAP()
+
+	DECLARE_GET_OUTER_OBJECT()
+
+	virtual void encode(com::encoder* encoder, std::error_code& ec) const noexcept override {
+		// Temporary value can't be compiled into schema
+		int sum = a + b;
+		encoder->encode("sum", sum, 0, 1000);
+		ec.clear();
+	}
+
+	int a = 0;
+	int b = 0;
+};
+
+DECLARE_CLASS(test, averaged)
+class averaged
+	: public com::object_base
+	, public com::encodable
+	, public com::coclass<averaged, UIDOF(averaged)>
+{
+public:
+	BEGIN_CAST_MAP(averaged)
+		CAST_ENTRY(com::encodable)
+	END_CAST_MAP()
+
+	DECLARE_GET_OUTER_OBJECT()
+
+	virtual void encode(com::encoder* encoder, std::error_code& ec) const noexcept override {
+		float average = (a + b) * 0.5f;
+		encoder->encode("average", average);
+		ec.clear();
+	}
+
+	float a = 0;
+	float b = 0;
+};
+
+DECLARE_CLASS(test, pickup)
+class pickup
+	: public com::object_base
+	, public com::encodable
+	, public com::coclass<pickup, UIDOF(pickup)>
+{
+public:
+	BEGIN_CAST_MAP(pickup)
+		CAST_ENTRY(com::encodable)
+	END_CAST_MAP()
+
+	DECLARE_GET_OUTER_OBJECT()
+
+	virtual void encode(com::encoder* encoder, std::error_code& ec) const noexcept override {
+		auto self = const_cast<pickup*>(this);
+		encoder->encode("taken", self->taken);
+		// Conditional field can't be described by schema
+		if (!taken)
+			encoder->encode("amount", self->amount, 0, 100);
+		ec.clear();
+	}
+
+	bool taken = false;
+	int amount = 0;
+};
+
+} // namespace test
+
+static size_t encode(com::encodable* object, io::bit_snapshot& snapshot, const io::bit_snapshot* baseline, io::memory_stream& stream) {
+	std::error_code ec;
+	com::stack_object<io::bit_encoder> encoder;
+	{
+		io::bit_writer writer(stream);
+		encoder.begin(writer, baseline);
+		object->encode(&encoder, ec);
+		REQUIRE(!ec);
+		REQUIRE(!encoder.error());
+	}
+	snapshot = encoder.snapshot();
+	return stream.buffer().second;
+}
+
+static void decode(com::decodable* object, io::bit_snapshot& snapshot, const io::bit_snapshot* baseline, io::memory_stream& stream) {
+	std::error_code ec;
+	stream.seek(0, seek_origin::begin, ec);
+	REQUIRE(!ec);
+
+	com::stack_object<io::bit_decoder> decoder;
+	io::bit_reader reader(stream);
+	decoder.begin(reader, baseline);
+	object->init(&decoder, ec);
+	REQUIRE(!ec);
+	REQUIRE(!decoder.error());
+	reader.read_align(ec);
+	REQUIRE(!ec);
+	snapshot = decoder.snapshot();
+}
+
+TEST_CASE("bits_required", "[encoding]") {
+	static_assert(io::bits_required_for(0, 0) == io::bits_required<0, 0>::value);
+	static_assert(io::bits_required_for(0, 1) == io::bits_required<0, 1>::value);
+	static_assert(io::bits_required_for(-100, 100) == io::bits_required<-100, 100>::value);
+	static_assert(io::bits_required_for(0, 255) == 8);
+	static_assert(io::bits_required_for(0, 256) == 9);
+
+	io::memory_stream stream;
+	{
+		io::bit_writer writer(stream);
+		writer.write_bits(5, 3);
+		writer.write_bits(0xdeadbeef, 32);
+		writer.write_bits(1, 1);
+	}
+	REQUIRE(stream.buffer().second == 5);
+
+	std::error_code ec;
+	stream.seek(0, seek_origin::begin, ec);
+	REQUIRE(!ec);
+	io::bit_reader reader(stream);
+	REQUIRE(reader.read_bits(3) == 5);
+	REQUIRE(reader.read_bits(32) == 0xdeadbeef);
+	REQUIRE(reader.read_bits(1) == 1);
+	reader.read_align();
+}
+
+TEST_CASE("bit_encoder", "[encoding]") {
+	std::error_code ec;
+
+	auto source = test::player::create_instance<test::player_state>(ec);
+	REQUIRE(!ec);
+	source->x = 12.34f;
+	source->y = -500.0f;
+	source->z = 999.99f;
+	source->angle = 90.5f;
+	source->health = 42;
+	source->ammo = 300;
+	source->alive = true;
+
+	auto target = test::player::create_instance<test::player_state>(ec);
+	REQUIRE(!ec);
+
+	io::bit_snapshot sent, received;
+	io::memory_stream stream;
+	auto size = encode(com::cast<com::encodable>(source, ec).get(), sent, nullptr, stream);
+	decode(com::cast<com::decodable>(target, ec).get(), received, nullptr, stream);
+	REQUIRE(sent == received);
+
+	REQUIRE(target->x == Approx(source->x).margin(0.005f));
+	REQUIRE(target->y == Approx(source->y).margin(0.005f));
+	REQUIRE(target->z == Approx(source->z).margin(0.005f));
+	REQUIRE(target->angle == Approx(source->angle).margin(0.05f));
+	REQUIRE(target->health == source->health);
+	REQUIRE(target->ammo == source->ammo);
+	REQUIRE(target->alive == source->alive);
+
+	SECTION("bandwidth") {
+		io::memory_stream raw;
+		io::binary_writer writer(raw);
+		writer.write(source->x);
+		writer.write(source->y);
+		writer.write(source->z);
+		writer.write(source->angle);
+		writer.write(static_cast<int32_t>(source->health));
+		writer.write(static_cast<int32_t>(source->ammo));
+		writer.write(source->alive);
+
+		// 3 * 18 + 12 + 7 + 10 + 1 bits against 25 bytes
+		REQUIRE(raw.buffer().second == 25);
+		REQUIRE(size == 11);
+	}
+
+	SECTION("delta") {
+		source->x += 1.0f;
+		source->ammo -= 1;
+
+		io::bit_snapshot delta_sent, delta_received;
+		io::memory_stream delta;
+		auto delta_size = encode(com::cast<com::encodable>(source, ec).get(), delta_sent, &sent, delta);
+		decode(com::cast<com::decodable>(target, ec).get(), delta_received, &received, delta);
+		REQUIRE(delta_sent == delta_received);
+
+		// 6 change bits, 18 + 10 changed bits and 1 bit as is
+		REQUIRE(delta_size == 5);
+		REQUIRE(delta_size < size);
+
+		REQUIRE(target->x == Approx(source->x).margin(0.005f));
+		REQUIRE(target->y == Approx(source->y).margin(0.005f));
+		REQUIRE(target->ammo == source->ammo);
+		REQUIRE(target->health == source->health);
+	}
+
+	SECTION("raw data") {
+		char text[] = "hello world";
+		char copy[sizeof(text)] = {};
+
+		io::memory_stream data;
+		com::stack_object<io::bit_encoder> encoder;
+		{
+			io::bit_writer writer(data);
+			encoder.begin(writer);
+			encoder.encode("text", text, sizeof(text));
+		}
+		REQUIRE(data.buffer().second == sizeof(text));
+
+		data.seek(0, seek_origin::begin, ec);
+		REQUIRE(!ec);
+		com::stack_object<io::bit_decoder> decoder;
+		io::bit_reader reader(data);
+		decoder.begin(reader);
+		decoder.decode("text", copy, sizeof(copy));
+		REQUIRE(!decoder.error());
+		REQUIRE(std::string(copy) == text);
+	}
+}
+
+TEST_CASE("schema", "[encoding]") {
+	std::error_code ec;
+
+	auto source = test::player::create_instance<test::player_state>(ec);
+	REQUIRE(!ec);
+	source->x = -1.5f;
+	source->angle = 180.0f;
+	source->health = 7;
+	source->ammo = 999;
+	source->alive = false;
+
+	auto&& player = static_cast<test::player&>(*source);
+	auto compiled = io::schema::of(player);
+	REQUIRE(compiled);
+	REQUIRE(compiled->fields().size() == 7);
+	REQUIRE(compiled->fields()[0].type == io::schema_field_type::ranged_real);
+	REQUIRE(compiled->fields()[0].offset == static_cast<size_t>(reinterpret_cast<char*>(&player.x) - reinterpret_cast<char*>(&player)));
+	REQUIRE(compiled->fields()[0].bits == 18);
+	REQUIRE(compiled->fields()[4].type == io::schema_field_type::ranged_integer);
+	REQUIRE(compiled->fields()[4].bits == 7);
+	REQUIRE(compiled->fields()[6].type == io::schema_field_type::boolean);
+
+	// Compiled path produces the same output as keyed one
+	io::bit_snapshot keyed;
+	io::memory_stream keyed_stream;
+	encode(&player, keyed, nullptr, keyed_stream);
+
+	io::memory_stream stream;
+	com::stack_object<io::bit_encoder> encoder;
+	{
+		io::bit_writer writer(stream);
+		encoder.begin(writer);
+		encoder.encode(player, ec);
+		REQUIRE(!ec);
+	}
+	REQUIRE(encoder.snapshot() == keyed);
+	REQUIRE(stream.buffer().second == keyed_stream.buffer().second);
+	REQUIRE(std::equal(stream.buffer().first, stream.buffer().first + stream.buffer().second, keyed_stream.buffer().first));
+
+	auto target = test::player::create_instance<test::player_state>(ec);
+	REQUIRE(!ec);
+
+	stream.seek(0, seek_origin::begin, ec);
+	REQUIRE(!ec);
+	{
+		com::stack_object<io::bit_decoder> decoder;
+		io::bit_reader reader(stream);
+		decoder.begin(reader);
+		decoder.decode(static_cast<test::player&>(*target), ec);
+		REQUIRE(!ec);
+		reader.read_align(ec);
+		REQUIRE(!ec);
+	}
+	REQUIRE(target->x == Approx(source->x).margin(0.005f));
+	REQUIRE(target->angle == Approx(source->angle).margin(0.05f));
+	REQUIRE(target->health == source->health);
+	REQUIRE(target->ammo == source->ammo);
+	REQUIRE(target->alive == source->alive);
+
+	SECTION("fallback") {
+		auto object = test::computed::create_instance<com::encodable>(ec);
+		REQUIRE(!ec);
+		auto&& computed = static_cast<test::computed&>(*object);
+		computed.a = 20;
+		computed.b = 22;
+		REQUIRE_FALSE(io::schema::of(computed));
+
+		io::memory_stream data;
+		com::stack_object<io::bit_encoder> encoder;
+		{
+			io::bit_writer writer(data);
+			encoder.begin(writer);
+			encoder.encode(computed, ec);
+			REQUIRE(!ec);
+		}
+		REQUIRE(encoder.snapshot() == io::bit_snapshot{ 42 });
+	}
+	
+	SECTION("fallback error") {
+		auto object = test::averaged::create_instance<com::encodable>(ec);
+		REQUIRE(!ec);
+		REQUIRE_FALSE(io::schema::of(static_cast<test::averaged&>(*object)));
+
+		// Stream is too small for the 32 bit value
+		uint8_t buffer[2];
+		io::memory_stream data(buffer, sizeof(buffer), access_mode::read_write);
+		com::stack_object<io::bit_encoder> encoder;
+		io::bit_writer writer(data);
+		encoder.begin(writer);
+		encoder.encode(static_cast<test::averaged&>(*object), ec);
+		REQUIRE(ec == std::errc::result_out_of_range);
+	}
+
+	SECTION("conditional fields") {
+		auto object = test::pickup::create_instance<com::encodable>(ec);
+		REQUIRE(!ec);
+		auto&& pickup = static_cast<test::pickup&>(*object);
+		auto compiled = io::schema::of(pickup);
+		REQUIRE(compiled);
+		REQUIRE(compiled->matches(pickup));
+		
+		pickup.taken = true;
+		REQUIRE_FALSE(compiled->matches(pickup));
+	}
+}
@@ -55,3 +55,33 @@ TEST_CASE("factory", "[factory]") {
 	std::unique_ptr<component> c3(component_factory::create("my_component3", "comp3"));
 	REQUIRE_FALSE(c3);
 }
+
+//
+using frozen_factory = auto_factory<component(const char*), type_index>;
+
+class frozen_component : public component {
+	REGISTER_FACTORY_WITH_KEY(frozen_factory, frozen_component, type_id<frozen_component>())
+public:
+	explicit frozen_component(const char* name) : _name(name) {}
+	
+	virtual const std::string& name() const noexcept override { return _name.get(); }
+	
+private:
+	identifier _name;
+};
+
+TEST_CASE("frozen factory", "[factory]") {
+	REQUIRE_FALSE(frozen_factory::frozen());
+	REQUIRE(frozen_factory::can_create(type_id<frozen_component>()));
+	
+	frozen_factory::freeze();
+	
+	REQUIRE(frozen_factory::frozen());
+	REQUIRE(frozen_factory::can_create(type_id<frozen_component>()));
+	REQUIRE_FALSE(frozen_factory::can_create(type_id<my_component>()));
+	REQUIRE_FALSE(frozen_factory::can_create(type_index()));
+	
+	std::unique_ptr<component> c(frozen_factory::create(type_id<frozen_component>(), "frozen"));
+	REQUIRE(c);
+	REQUIRE(c->name() == "frozen");
+}
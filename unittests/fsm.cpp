@@ -104,3 +104,362 @@ TEST_CASE("fsm", "[fsm]") {
 			machine.current_state()->update();
 	}
 }
+
+class static_a;
+class static_b;
+class static_c;
+
+using static_machine = fsm::static_state_machine<updatable,
+	fsm::states<static_a, static_b, static_c>,
+	fsm::transitions<
+		fsm::row<static_a, event_next, static_b>,
+		fsm::row<static_a, event_prev, static_c>,
+		fsm::row<static_b, event_next, static_c>,
+		fsm::row<static_b, event_prev, static_a>,
+		fsm::row<static_c, event_next, static_a>,
+		fsm::row<static_c, event_prev, static_b>
+	>>;
+
+class static_a : public updatable, public fsm::static_state<static_machine> {
+public:
+	void enter(updatable* from) { ++entered; }
+	void leave(updatable* to) { ++left; }
+	
+	virtual void update() override;
+	
+	int entered = 0;
+	int left = 0;
+};
+
+class static_b : public updatable, public fsm::static_state<static_machine> {
+public:
+	virtual void update() override;
+};
+
+class static_c : public updatable, public fsm::static_state<static_machine> {
+public:
+	void leave(updatable* to) { terminated = !to; }
+	
+	virtual void update() override;
+	
+	bool terminated = false;
+};
+
+void static_a::update() { machine()->enter<static_b>(); }
+void static_b::update() { machine()->enter<static_c>(); }
+void static_c::update() { machine()->terminate(); }
+
+TEST_CASE("static fsm", "[fsm]") {
+	static_assert(static_machine::event_count == 2);
+	static_assert(static_machine::event_index<event_prev>() == 1);
+	static_assert(static_machine::event_index<event_up>() == static_machine::npos);
+	
+	static_machine machine;
+	REQUIRE(machine.terminated());
+	
+	SECTION("events") {
+		REQUIRE(machine.enter<static_a>());
+		REQUIRE(machine.current_state() == machine.state_for<static_a>());
+		
+		REQUIRE(machine.send<event_next>());
+		REQUIRE(machine.send<event_next>());
+		REQUIRE(machine.send<event_next>());
+		REQUIRE(machine.send<event_next>());
+		REQUIRE(machine.current_index() == static_machine::index_of<static_b>());
+		
+		REQUIRE(!machine.send<event_up>());
+		REQUIRE(!machine.send<event_up>());
+		
+		REQUIRE(machine.send<event_prev>());
+		REQUIRE(machine.send<event_prev>());
+		REQUIRE(machine.send<event_prev>());
+		REQUIRE(machine.send<event_prev>());
+		REQUIRE(machine.current_state() == machine.state_for<static_a>());
+		
+		REQUIRE(machine.state_for<static_a>()->entered == 4);
+		REQUIRE(machine.state_for<static_a>()->left == 3);
+		
+		REQUIRE(machine.send<event_prev>());
+		REQUIRE(machine.terminate());
+		REQUIRE(!machine.terminate());
+		REQUIRE(!machine.send<event_next>());
+		REQUIRE(machine.state_for<static_c>()->terminated);
+	}
+	
+	SECTION("enter") {
+		REQUIRE(machine.can_enter<static_b>());
+		REQUIRE(machine.enter<static_b>());
+		REQUIRE(machine.can_enter<static_a>());
+		REQUIRE(!machine.can_enter<static_b>());
+		REQUIRE(!machine.enter<static_b>());
+	}
+	
+	SECTION("interface") {
+		machine.enter<static_a>();
+		while (!machine.terminated())
+			machine.current_state()->update();
+		REQUIRE(machine.state_for<static_c>()->terminated);
+	}
+}
+
+class agent {
+public:
+	virtual ~agent() = default;
+};
+
+class batched_idle;
+class batched_walk;
+class batched_run;
+
+using batched_machine = fsm::batched_state_machine<agent,
+	fsm::states<batched_idle, batched_walk, batched_run>,
+	fsm::transitions<
+		fsm::row<batched_idle, event_next, batched_walk>,
+		fsm::row<batched_walk, event_next, batched_run>,
+		fsm::row<batched_run, event_next, batched_idle>,
+		fsm::row<batched_walk, event_prev, batched_idle>
+	>>;
+
+class batched_idle : public agent {
+public:
+	void enter(fsm::instance_batch instances, agent* from) {
+		++batches;
+		entered.insert(entered.end(), instances.begin(), instances.end());
+	}
+	
+	int batches = 0;
+	std::vector<uint32_t> entered;
+};
+
+class batched_walk : public agent {
+public:
+	void leave(fsm::instance_batch instances, agent* to) {
+		++batches;
+		left += instances.size();
+		terminated += !to;
+	}
+	
+	int batches = 0;
+	size_t left = 0;
+	int terminated = 0;
+};
+
+class batched_run : public agent, public fsm::static_state<batched_machine> {
+};
+
+TEST_CASE("batched fsm", "[fsm]") {
+	batched_machine machine;
+	REQUIRE(machine.add(10) == 0);
+	REQUIRE(machine.size() == 10);
+	REQUIRE(machine.terminated(3));
+	REQUIRE(machine.state_for<batched_run>()->machine() == &machine);
+	
+	REQUIRE(machine.enter<batched_idle>() == 10);
+	REQUIRE(machine.count<batched_idle>() == 10);
+	REQUIRE(machine.state_for<batched_idle>()->batches == 1);
+	REQUIRE(machine.state_for<batched_idle>()->entered.size() == 10);
+	
+	SECTION("events") {
+		REQUIRE(machine.send<event_next>() == 10);
+		REQUIRE(machine.count<batched_walk>() == 10);
+		REQUIRE(machine.current_state(0) == machine.state_for<batched_walk>());
+		REQUIRE(machine.send<event_up>() == 0);
+		
+		// Half of instances run, others go back to idle
+		uint8_t mask[10] = { 1, 0, 1, 0, 1, 0, 1, 0, 1, 0 };
+		REQUIRE(machine.send<event_next>(mask) == 5);
+		REQUIRE(machine.send<event_prev>() == 5);
+		REQUIRE(machine.count<batched_run>() == 5);
+		REQUIRE(machine.count<batched_idle>() == 5);
+		REQUIRE(machine.current_index(1) == batched_machine::index_of<batched_idle>());
+		REQUIRE(machine.current_index(2) == batched_machine::index_of<batched_run>());
+		REQUIRE(machine.state_for<batched_walk>()->batches == 2);
+		REQUIRE(machine.state_for<batched_walk>()->left == 10);
+		
+		// Idle and running instances move in separate groups
+		machine.state_for<batched_idle>()->entered.clear();
+		REQUIRE(machine.send<event_next>() == 10);
+		REQUIRE(machine.state_for<batched_idle>()->entered == std::vector<uint32_t>{ 0, 2, 4, 6, 8 });
+		REQUIRE(machine.count<batched_walk>() == 5);
+	}
+	
+	SECTION("enter") {
+		REQUIRE(machine.can_enter<batched_walk>(0));
+		REQUIRE(!machine.can_enter<batched_run>(0));
+		REQUIRE(machine.enter<batched_run>() == 0);
+		REQUIRE(machine.add(2) == 10);
+		REQUIRE(machine.enter<batched_run>() == 2);
+		REQUIRE(machine.count<batched_run>() == 2);
+	}
+	
+	SECTION("terminate") {
+		machine.send<event_next>();
+		uint8_t mask[10] = { 1, 1, 1 };
+		REQUIRE(machine.terminate(mask) == 3);
+		REQUIRE(machine.terminated(0));
+		REQUIRE(!machine.terminated(3));
+		REQUIRE(machine.state_for<batched_walk>()->terminated == 1);
+		REQUIRE(machine.terminate() == 7);
+		REQUIRE(machine.terminate() == 0);
+		REQUIRE(machine.send<event_next>() == 0);
+	}
+}
+
+TEST_CASE("batched fsm without hooks", "[fsm]") {
+	struct idle : agent {};
+	struct walk : agent {};
+	using machine_type = fsm::batched_state_machine<agent,
+		fsm::states<idle, walk>,
+		fsm::transitions<fsm::row<idle, event_next, walk>, fsm::row<walk, event_next, idle>>>;
+	
+	machine_type machine;
+	machine.add(1000);
+	REQUIRE(machine.enter<walk>() == 1000);
+	REQUIRE(machine.send<event_next>() == 1000);
+	REQUIRE(machine.count<idle>() == 1000);
+	
+	std::vector<uint8_t> mask(1000);
+	mask[999] = 1;
+	REQUIRE(machine.send<event_next>(mask.data()) == 1);
+	REQUIRE(machine.current_index(999) == machine_type::index_of<walk>());
+	REQUIRE(machine.terminate() == 1000);
+	REQUIRE(machine.terminated(999));
+}
+
+struct event_seen {};
+struct event_lost {};
+struct event_killed {};
+struct event_revived {};
+
+std::string hierarchy_log;
+
+template <char Name>
+class logged_state : public agent {
+public:
+	void enter(agent* from) { hierarchy_log += '+'; hierarchy_log += Name; }
+	void leave(agent* to) { hierarchy_log += '-'; hierarchy_log += Name; }
+};
+
+// Alive(Patrol(Walk, Look), Combat(Approach, Attack)), Dead
+class alive : public logged_state<'A'> {};
+class patrol : public logged_state<'P'> {};
+class walk : public logged_state<'w'> {};
+class look : public logged_state<'l'> {};
+class combat : public logged_state<'C'> {};
+class approach : public logged_state<'a'> {};
+class attack : public logged_state<'x'> {};
+class dead : public logged_state<'D'> {};
+
+using hierarchical_machine = fsm::hierarchical_state_machine<agent,
+	fsm::states<alive, patrol, walk, look, combat, approach, attack, dead>,
+	fsm::hierarchy<
+		fsm::substate<patrol, alive>,
+		fsm::substate<combat, alive>,
+		fsm::substate<walk, patrol>,
+		fsm::substate<look, patrol>,
+		fsm::substate<approach, combat>,
+		fsm::substate<attack, combat>
+	>,
+	fsm::transitions<
+		fsm::row<walk, event_next, look>,
+		fsm::row<look, event_next, walk>,
+		fsm::row<approach, event_next, attack>,
+		fsm::row<attack, event_next, attack>,
+		fsm::row<patrol, event_seen, combat>,
+		fsm::row<combat, event_lost, fsm::deep_history<patrol>>,
+		fsm::row<alive, event_killed, dead>,
+		fsm::row<dead, event_revived, fsm::shallow_history<alive>>,
+		fsm::row<dead, event_next, alive>
+	>>;
+
+TEST_CASE("hierarchical fsm", "[fsm]") {
+	static_assert(hierarchical_machine::depth_count == 3);
+	
+	hierarchical_machine machine;
+	hierarchy_log.clear();
+	
+	SECTION("initial states") {
+		REQUIRE(machine.enter<alive>());
+		REQUIRE(hierarchy_log == "+A+P+w");
+		REQUIRE(machine.current_state() == machine.state_for<walk>());
+		REQUIRE(machine.is_in<alive>());
+		REQUIRE(machine.is_in<patrol>());
+		REQUIRE(!machine.is_in<combat>());
+		REQUIRE(!machine.is_in<dead>());
+		
+		REQUIRE(machine.terminate());
+		REQUIRE(hierarchy_log == "+A+P+w-w-P-A");
+		REQUIRE(!machine.is_in<alive>());
+	}
+	
+	SECTION("parent fallback") {
+		machine.enter<alive>();
+		REQUIRE(machine.send<event_next>());
+		REQUIRE(machine.current_index() == hierarchical_machine::index_of<look>());
+		
+		// Handled by patrol, alive stays active
+		hierarchy_log.clear();
+		REQUIRE(machine.send<event_seen>());
+		REQUIRE(hierarchy_log == "-l-P+C+a");
+		REQUIRE(machine.current_index() == hierarchical_machine::index_of<approach>());
+		REQUIRE(!machine.send<event_seen>());
+		
+		// Self transition leaves and enters state again
+		machine.send<event_next>();
+		hierarchy_log.clear();
+		REQUIRE(machine.send<event_next>());
+		REQUIRE(hierarchy_log == "-x+x");
+		
+		// Handled by alive from any depth
+		hierarchy_log.clear();
+		REQUIRE(machine.send<event_killed>());
+		REQUIRE(hierarchy_log == "-x-C-A+D");
+		REQUIRE(!machine.send<event_seen>());
+	}
+	
+	SECTION("history") {
+		machine.enter<alive>();
+		machine.send<event_next>();
+		machine.send<event_seen>();
+		
+		// Deep history restores look instead of initial walk
+		hierarchy_log.clear();
+		REQUIRE(machine.send<event_lost>());
+		REQUIRE(hierarchy_log == "-a-C+P+l");
+		
+		machine.send<event_seen>();
+		machine.send<event_next>();
+		machine.send<event_killed>();
+		
+		// Shallow history restores combat, but its initial substate
+		hierarchy_log.clear();
+		REQUIRE(machine.send<event_revived>());
+		REQUIRE(hierarchy_log == "-D+A+C+a");
+		
+		// Transition to state itself ignores history
+		machine.send<event_killed>();
+		hierarchy_log.clear();
+		REQUIRE(machine.send<event_next>());
+		REQUIRE(hierarchy_log == "-D+A+P+w");
+		
+		// Termination forgets history
+		machine.terminate();
+		machine.enter<dead>();
+		machine.send<event_revived>();
+		REQUIRE(machine.current_index() == hierarchical_machine::index_of<walk>());
+	}
+	
+	SECTION("enter") {
+		REQUIRE(machine.can_enter<look>());
+		REQUIRE(machine.enter<look>());
+		REQUIRE(hierarchy_log == "+A+P+l");
+		
+		REQUIRE(machine.can_enter<walk>());
+		REQUIRE(machine.can_enter<dead>());
+		REQUIRE(!machine.can_enter<attack>());
+		REQUIRE(!machine.enter<attack>());
+		
+		REQUIRE(machine.enter<combat>());
+		REQUIRE(machine.current_index() == hierarchical_machine::index_of<approach>());
+	}
+}
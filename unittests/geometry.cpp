@@ -35,3 +35,19 @@ TEST_CASE("geometry", "[geometry]") {
 		REQUIRE(r == (rect(1, 1, 10, 10)));
 	}
 }
+
+TEST_CASE("transform", "[geometry]") {
+	REQUIRE(mat4::compose({}, {}, {1, 1, 1}) == mat4::identity());
+	
+	auto m = mat4::compose({1, 2, 3}, quat::angle_axis(3.14159265f / 2, {0, 0, 1}), {2, 2, 2});
+	
+	// Scaled, then rotated by 90 degrees around z, then moved
+	auto p = m.transform_point({1, 0, 0});
+	REQUIRE(p.x == Approx(1).margin(1e-5));
+	REQUIRE(p.y == Approx(4).margin(1e-5));
+	REQUIRE(p.z == Approx(3).margin(1e-5));
+	
+	auto moved = mat4::compose({10, 0, 0}, {}, {1, 1, 1}) * m;
+	REQUIRE(moved.transform_point({1, 0, 0}).x == Approx(11).margin(1e-5));
+	REQUIRE((m * mat4::identity()) == m);
+}
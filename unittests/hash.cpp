@@ -20,4 +20,66 @@ TEST_CASE("hash", "[hash]") {
 		REQUIRE(murmur3(str.c_str(), str.size(), 0) == 3224780355);
 		REQUIRE(murmur3("Hello, world!", 0) == 3224780355);
 	}
+	
+	SECTION("long keys") {
+		#define KEY16 "0123456789abcdef"
+		#define KEY256 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16 KEY16
+		#define KEY4K KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256 KEY256
+		
+		constexpr uint32_t hash = compiletime::murmur3_32(KEY4K "!", 0);
+		static_assert(hash == KEY4K "!"_hash, "");
+		
+		REQUIRE(hash == murmur3(KEY4K "!", 0));
+		REQUIRE(compiletime::fnv1a_64(KEY4K) != 0);
+		
+		#undef KEY4K
+		#undef KEY256
+		#undef KEY16
+	}
+	
+	SECTION("fnv") {
+		static_assert(compiletime::fnv1_32("") == 0x811c9dc5, "");
+		static_assert(compiletime::fnv1_32("a") == 0x050c5d7e, "");
+		static_assert(compiletime::fnv1a_32("a") == 0xe40c292c, "");
+		static_assert(compiletime::fnv1a_32("foobar") == 0xbf9cf968, "");
+		static_assert(compiletime::fnv1_64("a") == 0xaf63bd4c8601b7be, "");
+		static_assert(compiletime::fnv1a_64("a") == 0xaf63dc4c8601ec8c, "");
+		static_assert(compiletime::fnv1a_64("foobar") == 0x85944171f73967e8, "");
+	}
+}
+
+TEST_CASE("perfect hash table", "[hash]") {
+	constexpr auto table = compiletime::make_perfect_hash_table({
+		"load"_hash, "save"_hash, "quit"_hash, "open"_hash, "close"_hash,
+		"undo"_hash, "redo"_hash, "copy"_hash, "paste"_hash, "cut"_hash
+	});
+	
+	static_assert(table.size() == 10, "");
+	static_assert(table.find("load"_hash) == 0, "");
+	static_assert(table.find("cut"_hash) == 9, "");
+	static_assert(!table.contains("help"_hash), "");
+	
+	auto dispatch = [&](const char* command) {
+		switch (table.find(murmur3(command, 0))) {
+		case table.find("load"_hash): return 1;
+		case table.find("save"_hash): return 2;
+		case table.find("paste"_hash): return 3;
+		default: return 0;
+		}
+	};
+	
+	REQUIRE(dispatch("load") == 1);
+	REQUIRE(dispatch("save") == 2);
+	REQUIRE(dispatch("paste") == 3);
+	REQUIRE(dispatch("quit") == 0);
+	REQUIRE(dispatch("help") == 0);
+	
+	uint32_t keys[256] = {};
+	for (uint32_t i = 0; i < 256; ++i)
+		keys[i] = murmur3(reinterpret_cast<const char*>(&i), sizeof(i), 0);
+	
+	auto large = compiletime::make_perfect_hash_table(keys);
+	for (size_t i = 0; i < 256; ++i)
+		REQUIRE(large.find(keys[i]) == i);
+	REQUIRE(large.find(0xdeadbeef) == large.npos);
 }
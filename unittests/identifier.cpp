@@ -0,0 +1,75 @@
+#include "catch2/catch.hpp"
+#include <cobalt/utility/identifier.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace cobalt;
+
+TEST_CASE("identifier", "[identifier]") {
+	SECTION("empty") {
+		identifier id;
+		
+		REQUIRE(id.empty());
+		REQUIRE(id.get() == "");
+		REQUIRE(id.hash() == 0);
+		REQUIRE(id == identifier(""));
+		REQUIRE(sizeof(identifier) == sizeof(void*));
+	}
+	
+	SECTION("interning") {
+		identifier id1("foo");
+		identifier id2(std::string("foo"));
+		identifier id3(std::string_view("foobar", 3));
+		identifier id4("bar");
+		
+		REQUIRE(id1 == id2);
+		REQUIRE(id1 == id3);
+		REQUIRE(id1 != id4);
+		REQUIRE(&id1.get() == &id2.get());
+		REQUIRE(id1.get() == "foo");
+		REQUIRE(id4 < id1);
+	}
+	
+	SECTION("hash") {
+		identifier id("Hello, world!");
+		
+		REQUIRE(id.hash() == "Hello, world!"_hash);
+		REQUIRE(std::hash<identifier>()(id) == "Hello, world!"_hash);
+		
+		switch (id.hash()) {
+		case "Hello, world!"_hash: break;
+		default: FAIL();
+		}
+	}
+	
+	SECTION("literal") {
+		static_assert("Hello, world!"_id.hash == "Hello, world!"_hash, "");
+		
+		REQUIRE(identifier("Hello, world!"_id) == identifier("Hello, world!"));
+		REQUIRE(identifier(""_id).empty());
+	}
+	
+	SECTION("concurrent interning") {
+		constexpr int kThreads = 4;
+		constexpr int kNames = 1000;
+		
+		std::vector<std::vector<identifier>> ids(kThreads);
+		std::vector<std::thread> threads;
+		
+		for (int t = 0; t < kThreads; ++t) {
+			threads.emplace_back([&, t] {
+				for (int i = 0; i < kNames; ++i)
+					ids[t].emplace_back("name" + std::to_string(i));
+			});
+		}
+		
+		for (auto&& thread : threads)
+			thread.join();
+		
+		for (int t = 1; t < kThreads; ++t)
+			REQUIRE(ids[t] == ids[0]);
+		
+		REQUIRE(ids[0][42] == identifier("name42"));
+	}
+}
@@ -147,6 +147,29 @@ TEST_CASE("io", "[io]") {
 		}
 	}
 	
+	SECTION("bit stream") {
+		io::memory_stream stream;
+		{
+			io::bit_writer writer(stream);
+			writer.write_bits(0xabc, 12);
+			writer.write_bits(0x12345, 20);
+			writer.write_bits(0x55, 7);
+		}
+		
+		// Layout of bit_stream_version 2, values are packed from the lowest bit
+		const uint8_t expected[] = { 0xbc, 0x5a, 0x34, 0x12, 0x55 };
+		auto buffer = stream.buffer();
+		REQUIRE(static_cast<size_t>(buffer.second) == sizeof(expected));
+		REQUIRE(std::memcmp(buffer.first, expected, sizeof(expected)) == 0);
+		
+		io::memory_stream input(buffer.first, buffer.second);
+		io::bit_reader reader(input);
+		REQUIRE(reader.read_bits(12) == 0xabc);
+		REQUIRE(reader.read_bits(20) == 0x12345);
+		REQUIRE(reader.read_bits(7) == 0x55);
+		reader.read_align();
+	}
+	
 	SECTION("functions") {
 		char buffer[] = "Hello, world!";
 		io::memory_stream stream(buffer, sizeof(buffer) - 1);
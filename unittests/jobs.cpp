@@ -0,0 +1,68 @@
+#include "catch2/catch.hpp"
+#include <cobalt/jobs.hpp>
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace cobalt;
+
+TEST_CASE("thread_pool", "[jobs]") {
+	auto workers = GENERATE(0, 3);
+	thread_pool pool(workers);
+	REQUIRE(pool.concurrency() == workers + 1);
+	
+	SECTION("chunks") {
+		std::vector<int> values(1000);
+		job_graph graph;
+		graph.add(10, [&](size_t chunk) {
+			for (size_t i = chunk * 100; i < (chunk + 1) * 100; ++i)
+				values[i] = int(i);
+		});
+		pool.run(graph);
+		for (size_t i = 0; i < values.size(); ++i)
+			REQUIRE(values[i] == int(i));
+	}
+	
+	SECTION("dependencies") {
+		std::atomic<int> first_done{0};
+		std::atomic<int> second_done{0};
+		std::atomic<bool> ordered{true};
+		
+		job_graph graph;
+		auto first = graph.add(8, [&](size_t) { ++first_done; });
+		auto empty = graph.add(0, [&](size_t) { ordered = false; });
+		auto second = graph.add(8, [&](size_t) {
+			if (first_done != 8)
+				ordered = false;
+			++second_done;
+		});
+		auto third = graph.add(1, [&](size_t) {
+			if (second_done != 8)
+				ordered = false;
+		});
+		graph.depend(second, first);
+		graph.depend(second, empty);
+		graph.depend(third, second);
+		
+		// Graph can be run again
+		for (int i = 0; i < 3; ++i) {
+			first_done = second_done = 0;
+			pool.run(graph);
+			REQUIRE(ordered);
+			REQUIRE(second_done == 8);
+		}
+	}
+	
+	SECTION("exception") {
+		std::atomic<int> runs{0};
+		job_graph graph;
+		auto failing = graph.add(4, [&](size_t chunk) {
+			++runs;
+			if (chunk == 2)
+				throw std::runtime_error("chunk failed");
+		});
+		graph.depend(graph.add(1, [&](size_t) { ++runs; }), failing);
+		REQUIRE_THROWS_AS(pool.run(graph), std::runtime_error);
+		REQUIRE(runs == 5);
+	}
+}
@@ -0,0 +1,134 @@
+#include "catch2/catch.hpp"
+#include <cobalt/actor.hpp>
+
+using namespace cobalt;
+
+namespace {
+
+class bullet : public object {
+	IMPLEMENT_OBJECT_TYPE(bullet)
+public:
+	bullet() { ++constructed; }
+	~bullet() { ++destroyed; }
+	
+	virtual void reset() noexcept override {
+		++resets;
+		speed = 0;
+		object::reset();
+	}
+	
+	virtual void reuse() noexcept override {
+		++reuses;
+	}
+	
+	float speed = 0;
+	
+	static int constructed, destroyed, resets, reuses;
+};
+
+int bullet::constructed = 0;
+int bullet::destroyed = 0;
+int bullet::resets = 0;
+int bullet::reuses = 0;
+
+class tracer : public bullet {
+};
+
+class pickup_component : public actor_component {
+	IMPLEMENT_OBJECT_TYPE(pickup_component)
+};
+
+} // namespace
+
+TEST_CASE("object_pool", "[object]") {
+	using pool = object_pool<bullet>;
+	REQUIRE(pool::capacity() == 0);
+	
+	SECTION("disabled") {
+		ref_ptr<bullet> b = object::create_instance<bullet>();
+		b.reset();
+		REQUIRE(bullet::destroyed == bullet::constructed);
+		REQUIRE(pool::stats().misses == 0);
+	}
+	
+	SECTION("recycling") {
+		pool::capacity(2);
+		pool::reset_stats();
+		
+		ref_ptr<bullet> b1 = object::create_instance<bullet>();
+		ref_ptr<bullet> b2 = static_cast<bullet*>(object::create_instance(bullet::class_type()));
+		ref_ptr<bullet> b3 = object::create_instance<bullet>();
+		REQUIRE(pool::stats().misses == 3);
+		REQUIRE(pool::stats().hits == 0);
+		
+		auto p1 = b1.get();
+		b1->speed = 10;
+		b1->name("first");
+		auto destroyed = bullet::destroyed;
+		b1.reset();
+		b2.reset();
+		b3.reset();
+		REQUIRE(pool::size() == 2);
+		REQUIRE(pool::stats().recycled == 2);
+		REQUIRE(pool::stats().discarded == 1);
+		REQUIRE(bullet::destroyed == destroyed + 1);
+		
+		// Warm object is handed out reset
+		ref_ptr<bullet> b4 = object::create_instance<bullet>();
+		ref_ptr<bullet> b5 = object::create_instance<bullet>();
+		REQUIRE(pool::stats().hits == 2);
+		REQUIRE((b4.get() == p1 || b5.get() == p1));
+		REQUIRE(p1->speed == 0);
+		REQUIRE(p1->name().empty());
+		REQUIRE(p1->use_count() == 1);
+		REQUIRE(bullet::reuses >= 2);
+		
+		// Derived class without its own pool is never put into base class pool
+		b4.reset();
+		REQUIRE(pool::size() == 1);
+		ref_ptr<bullet> t = new tracer();
+		t.reset();
+		REQUIRE(pool::size() == 1);
+		
+		pool::clear();
+		REQUIRE(pool::size() == 0);
+		pool::capacity(0);
+	}
+	
+	SECTION("actor") {
+		object_pool<actor>::capacity(4);
+		object_pool<pickup_component>::capacity(4);
+		
+		auto a = object::create_instance<actor>();
+		retain(a);
+		a->transform(object::create_instance<transform_component>());
+		a->transform()->position({ 1, 2, 3 });
+		a->add_component(object::create_instance<pickup_component>());
+		a->add_data<float>(1.0f);
+		a->bounds({ { 0, 0, 0 }, { 1, 1, 1 } });
+		release(a);
+		
+		REQUIRE(object_pool<actor>::size() == 1);
+		REQUIRE(object_pool<pickup_component>::size() == 1);
+		
+		auto b = object::create_instance<actor>();
+		REQUIRE(b == a);
+		REQUIRE(b->components().empty());
+		REQUIRE(!b->transform());
+		REQUIRE(!b->data<float>());
+		REQUIRE(b->bounds().empty());
+		
+		auto t = object::create_instance<transform_component>();
+		REQUIRE(t->position() == vec3());
+		retain(t);
+		release(t);
+		retain(b);
+		release(b);
+		
+		object_pool<actor>::clear();
+		object_pool<pickup_component>::clear();
+		object_pool<transform_component>::clear();
+		object_pool<actor>::capacity(0);
+		object_pool<pickup_component>::capacity(0);
+	}
+}
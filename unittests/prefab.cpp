@@ -0,0 +1,196 @@
+#include "catch2/catch.hpp"
+#include <cobalt/prefab.hpp>
+
+#include <stdexcept>
+#include <string>
+
+using namespace cobalt;
+
+namespace {
+
+class weapon_component : public actor_component {
+	IMPLEMENT_OBJECT_TYPE(weapon_component)
+public:
+	virtual void assign(const actor_component& other) override {
+		ammo = static_cast<const weapon_component&>(other).ammo;
+		assign_base(other);
+	}
+
+	int ammo = 0;
+};
+
+class socket_component : public transform_component {
+	IMPLEMENT_OBJECT_TYPE(socket_component)
+};
+
+// Doesn't implement assign, so its state can't be copied
+class team_component : public actor_component {
+	IMPLEMENT_OBJECT_TYPE(team_component)
+public:
+	int team = 0;
+};
+
+struct stats {
+	int health;
+	float speed;
+};
+
+struct inventory {
+	std::vector<std::string> items;
+};
+
+// Throws once given number of copies were made
+struct fragile {
+	static inline int copies_left = -1;
+
+	fragile() = default;
+	fragile(const fragile&) {
+		if (copies_left == 0)
+			throw std::runtime_error("copy failed");
+		--copies_left;
+	}
+	fragile& operator=(const fragile&) = default;
+	fragile(fragile&&) noexcept = default;
+	fragile& operator=(fragile&&) noexcept = default;
+};
+
+ref_ptr<actor> create_enemy() {
+	auto enemy = make_ref<actor>();
+	enemy->name(identifier("enemy"));
+
+	auto root = object::create_instance<transform_component>();
+	root->position({ 1, 2, 3 });
+	enemy->transform(root);
+
+	auto hand = object::create_instance<socket_component>();
+	hand->name(identifier("hand"));
+	hand->position({ 0, 1, 0 });
+	root->add_child(hand);
+	auto muzzle = object::create_instance<socket_component>();
+	muzzle->name(identifier("muzzle"));
+	hand->add_child(muzzle);
+	auto head = object::create_instance<socket_component>();
+	head->name(identifier("head"));
+	root->add_child(head);
+
+	auto weapon = object::create_instance<weapon_component>();
+	weapon->ammo = 30;
+	enemy->add_component(weapon);
+
+	enemy->add_data<stats>(stats{ 100, 2.5f });
+	enemy->add_data<inventory>(inventory{ { "key", "potion" } });
+	enemy->bounds({ { -1, -1, -1 }, { 1, 1, 1 } });
+	return enemy;
+}
+
+std::string hierarchy(transform_component* root) {
+	std::string result;
+	root->visit([&](transform_component* node) {
+		result += node->name().empty() ? "root" : node->name().get();
+		result += "(";
+		return true;
+	}, [&](transform_component*) {
+		result += ")";
+	});
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("prefab", "[prefab]") {
+	auto source = create_enemy();
+	prefab enemy(*source);
+	REQUIRE(enemy.components() == 5);
+	REQUIRE(enemy.transforms() == 4);
+	REQUIRE(enemy.data_components() == 2);
+
+	// Prefab keeps its own copy of source state
+	source->find_component<weapon_component>()->ammo = 0;
+	source->data<stats>()->health = 0;
+
+	SECTION("instantiate") {
+		auto a = enemy.instantiate();
+		REQUIRE(a->name() == identifier("enemy"));
+		REQUIRE(a->level() == nullptr);
+		REQUIRE(a->transform() != source->transform());
+		REQUIRE(hierarchy(a->transform()) == "root(hand(muzzle())head())");
+		REQUIRE(a->transform()->first_child()->actor() == a.get());
+		REQUIRE(a->find_component<weapon_component>()->ammo == 30);
+		REQUIRE(a->data<stats>()->health == 100);
+		REQUIRE(a->data<inventory>()->items.size() == 2);
+
+		auto muzzle = a->transform()->first_child()->first_child();
+		REQUIRE(muzzle->world_matrix().transform_point({}) == vec3{ 1, 3, 3 });
+	}
+
+	SECTION("instantiate many") {
+		level level1;
+		std::vector<actor*> enemies;
+		enemy.instantiate(level1, 100, enemies);
+		REQUIRE(enemies.size() == 100);
+		REQUIRE(level1.view<stats>().size() == 100);
+		REQUIRE(level1.view<inventory>().size() == 100);
+		REQUIRE(level1.spatial_index().size() == 100);
+
+		for (auto a : enemies) {
+			REQUIRE(a->level() == &level1);
+			REQUIRE(a->data<stats>()->speed == 2.5f);
+			REQUIRE(a->data<inventory>()->items[1] == "potion");
+			REQUIRE(a->find_component<weapon_component>()->ammo == 30);
+			REQUIRE(hierarchy(a->transform()) == "root(hand(muzzle())head())");
+		}
+
+		// Instances are independent of each other
+		enemies[0]->data<stats>()->health = 1;
+		enemies[0]->find_component<weapon_component>()->ammo = 1;
+		REQUIRE(enemies[1]->data<stats>()->health == 100);
+		REQUIRE(enemies[1]->find_component<weapon_component>()->ammo == 30);
+
+		level1.remove_actor(enemies[0]);
+		REQUIRE(level1.view<stats>().size() == 99);
+	}
+
+	SECTION("failed instantiate") {
+		level level1;
+		auto placed = enemy.instantiate();
+		level1.add_actor(placed.get());
+		std::vector<actor*> enemies{ placed.get() };
+
+		source->add_data<fragile>();
+		prefab brittle(*source);
+		// Prototype copy and first 5 instances succeed
+		fragile::copies_left = 6;
+		REQUIRE_THROWS_AS(brittle.instantiate(level1, 10, enemies), std::runtime_error);
+		fragile::copies_left = -1;
+
+		REQUIRE(enemies.size() == 1);
+		REQUIRE(level1.actors().size() == 1);
+		REQUIRE(level1.spatial_index().size() == 1);
+		REQUIRE(level1.view<stats>().size() == 1);
+		REQUIRE(level1.view<inventory>().size() == 1);
+		REQUIRE(level1.view<fragile>().size() == 0);
+
+		brittle.instantiate(level1, 10, enemies);
+		REQUIRE(enemies.size() == 11);
+		REQUIRE(level1.view<fragile>().size() == 10);
+	}
+
+	SECTION("pooled components") {
+		object_pool<socket_component>::capacity(8);
+		object_pool<socket_component>::prewarm(3);
+		object_pool<socket_component>::reset_stats();
+
+		auto a = enemy.instantiate();
+		REQUIRE(object_pool<socket_component>::stats().hits == 3);
+		REQUIRE(hierarchy(a->transform()) == "root(hand(muzzle())head())");
+
+		object_pool<socket_component>::capacity(0);
+		object_pool<socket_component>::clear();
+	}
+	
+	SECTION("component without assign") {
+		auto a = create_enemy();
+		a->add_component(object::create_instance<team_component>());
+		REQUIRE_THROWS_AS(prefab(*a), std::system_error);
+	}
+}
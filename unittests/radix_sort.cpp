@@ -0,0 +1,50 @@
+#include "catch2/catch.hpp"
+#include <cobalt/utility/radix_sort.hpp>
+
+#include <random>
+#include <vector>
+
+using namespace cobalt;
+
+TEST_CASE("radix sort", "[radix_sort]") {
+	std::mt19937_64 rng(1);
+	
+	SECTION("keys") {
+		for (size_t count : { 0, 1, 10, 1000 }) {
+			std::vector<uint64_t> keys(count), scratch(count);
+			for (auto&& key : keys)
+				key = rng();
+			auto expected = keys;
+			std::sort(expected.begin(), expected.end());
+			
+			radix_sort(keys.data(), scratch.data(), keys.size());
+			REQUIRE(keys == expected);
+		}
+	}
+	
+	SECTION("same bytes") {
+		// Only the second byte differs, other passes are skipped
+		std::vector<uint64_t> keys(1000), scratch(1000);
+		for (auto&& key : keys)
+			key = 0x1100000000000022 | (rng() & 0xff) << 8;
+		auto expected = keys;
+		std::sort(expected.begin(), expected.end());
+		
+		radix_sort(keys.data(), scratch.data(), keys.size());
+		REQUIRE(keys == expected);
+	}
+	
+	SECTION("stable") {
+		for (size_t count : { 10, 1000 }) {
+			// Low bits are order of keys, which is kept for equal high bits
+			std::vector<uint64_t> keys(count), scratch(count);
+			for (size_t i = 0; i < count; ++i)
+				keys[i] = (rng() % 7) << 36 | (count - i);
+			auto expected = keys;
+			std::stable_sort(expected.begin(), expected.end(), [](uint64_t a, uint64_t b) { return a >> 36 < b >> 36; });
+			
+			radix_sort(keys.data(), scratch.data(), keys.size(), 36);
+			REQUIRE(keys == expected);
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#include "catch2/catch.hpp"
+#include <cobalt/spatial_index.hpp>
+
+#include <algorithm>
+#include <random>
+
+using namespace cobalt;
+
+namespace {
+
+aabb random_box(std::mt19937& rng, float world = 1000, float size = 10) {
+	std::uniform_real_distribution<float> pos(0, world), ext(0.1f, size);
+	vec3 min{ pos(rng), pos(rng), pos(rng) };
+	return { min, min + vec3(ext(rng), ext(rng), ext(rng)) };
+}
+
+template <typename Predicate>
+std::vector<int> brute_force(const std::vector<aabb>& boxes, const std::vector<bool>& alive, Predicate predicate) {
+	std::vector<int> result;
+	for (size_t i = 0; i < boxes.size(); ++i) {
+		if (alive[i] && predicate(boxes[i]))
+			result.push_back(int(i));
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("aabb_tree", "[spatial_index]") {
+	std::mt19937 rng(42);
+	aabb_tree<int> tree(1.0f);
+	
+	std::vector<aabb> boxes;
+	std::vector<bool> alive;
+	std::vector<aabb_tree<int>::proxy_id> proxies;
+	for (int i = 0; i < 2000; ++i) {
+		boxes.push_back(random_box(rng));
+		alive.push_back(true);
+		proxies.push_back(tree.insert(boxes.back(), i));
+	}
+	REQUIRE(tree.size() == 2000);
+	// Balanced, perfectly balanced tree would be 11 levels high
+	REQUIRE(tree.height() < 30);
+	
+	// Move some boxes a little and some far, remove every tenth
+	std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+	size_t reinserted = 0;
+	for (int i = 0; i < 2000; ++i) {
+		if (i % 10 == 0) {
+			tree.remove(proxies[i]);
+			alive[i] = false;
+		} else if (i % 2) {
+			auto offset = vec3(jitter(rng), jitter(rng), jitter(rng));
+			boxes[i] = { boxes[i].min + offset, boxes[i].max + offset };
+			reinserted += tree.move(proxies[i], boxes[i]);
+		} else {
+			boxes[i] = random_box(rng);
+			reinserted += tree.move(proxies[i], boxes[i]);
+		}
+	}
+	REQUIRE(tree.size() == 1800);
+	// Small moves mostly stay within fat bounds
+	REQUIRE(reinserted < 1400);
+	REQUIRE(tree.height() < 30);
+	
+	auto check = [&](std::vector<int> found, std::vector<int> expected) {
+		std::sort(found.begin(), found.end());
+		REQUIRE(found == expected);
+	};
+	
+	SECTION("range") {
+		for (int i = 0; i < 50; ++i) {
+			auto box = random_box(rng, 1000, 200);
+			std::vector<int> found;
+			auto count = tree.query(box, found);
+			REQUIRE(count == found.size());
+			check(found, brute_force(boxes, alive, [&](const aabb& b) { return b.intersects(box); }));
+		}
+	}
+	
+	SECTION("ray") {
+		for (int i = 0; i < 50; ++i) {
+			std::uniform_real_distribution<float> dir(-1, 1);
+			ray r{ random_box(rng).min, { dir(rng), dir(rng), dir(rng) } };
+			std::vector<int> found;
+			tree.raycast(r, 500, found);
+			check(found, brute_force(boxes, alive, [&](const aabb& b) { return r.intersect(b, 500) >= 0; }));
+		}
+	}
+	
+	SECTION("frustum") {
+		// Box shaped frustum of orthographic projection
+		auto ortho = mat4::compose({ -1, -1, -1 }, {}, { 2.0f / 300, 2.0f / 300, 2.0f / 300 });
+		auto f = frustum::from_matrix(ortho);
+		std::vector<int> found;
+		tree.query(f, found);
+		check(found, brute_force(boxes, alive, [&](const aabb& b) { return b.intersects(aabb({ 0, 0, 0 }, { 300, 300, 300 })); }));
+		REQUIRE(!found.empty());
+	}
+	
+	SECTION("clear") {
+		tree.clear();
+		REQUIRE(tree.empty());
+		std::vector<int> found;
+		REQUIRE(tree.query(aabb({ 0, 0, 0 }, { 1000, 1000, 1000 }), found) == 0);
+	}
+}
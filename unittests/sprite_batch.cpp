@@ -0,0 +1,410 @@
+#include "catch2/catch.hpp"
+#include <cobalt/sprite_batch.hpp>
+
+#include <cstring>
+
+using namespace cobalt;
+
+namespace {
+
+// Graphics API recording calls, buffers live in system memory
+class mock_device {
+public:
+	using buffer_type = uint32_t;
+	using fence_type = uint32_t;
+
+	struct draw_call {
+		uint32_t texture;
+		blend_mode blend;
+		std::vector<sprite_vertex> vertices;    ///< Vertices referenced by indices in order
+	};
+
+	explicit mock_device(bool persistent) noexcept : persistent(persistent) {}
+
+	bool persistent_mapping() const { return persistent; }
+
+	buffer_type create_buffer(buffer_target target, size_t size, buffer_storage storage) {
+		REQUIRE(storage == (persistent ? buffer_storage::persistent : buffer_storage::orphaned));
+		buffers.push_back({ target, std::vector<uint8_t>(size), false });
+		return static_cast<buffer_type>(buffers.size());
+	}
+
+	void destroy_buffer(buffer_type buffer) {
+		REQUIRE(!get(buffer).mapped);
+		++destroyed;
+	}
+
+	void orphan_buffer(buffer_type buffer, size_t size) {
+		REQUIRE(!get(buffer).mapped);
+		get(buffer).data.assign(size, 0);
+		++orphans;
+	}
+
+	void* map_buffer(buffer_type buffer, size_t offset, size_t size, buffer_storage) {
+		auto&& b = get(buffer);
+		REQUIRE(!b.mapped);
+		REQUIRE(offset + size <= b.data.size());
+		b.mapped = true;
+		++maps;
+		return b.data.data() + offset;
+	}
+
+	void unmap_buffer(buffer_type buffer) {
+		REQUIRE(get(buffer).mapped);
+		get(buffer).mapped = false;
+	}
+
+	fence_type insert_fence() {
+		pending.push_back(++fences);
+		return fences;
+	}
+
+	void wait_fence(fence_type fence) {
+		REQUIRE(std::find(pending.begin(), pending.end(), fence) != pending.end());
+		waited.push_back(fence);
+	}
+
+	void delete_fence(fence_type fence) {
+		auto it = std::find(pending.begin(), pending.end(), fence);
+		REQUIRE(it != pending.end());
+		pending.erase(it);
+	}
+
+	void draw_sprites(buffer_type vertices, buffer_type indices, size_t first_index, size_t index_count, uint32_t texture, blend_mode blend) {
+		auto&& vb = get(vertices);
+		auto&& ib = get(indices);
+		REQUIRE(vb.target == buffer_target::vertex);
+		REQUIRE(ib.target == buffer_target::index);
+		REQUIRE((persistent || (!vb.mapped && !ib.mapped)));
+		REQUIRE((first_index + index_count) * sizeof(uint32_t) <= ib.data.size());
+
+		draw_call call{ texture, blend };
+		for (size_t i = 0; i < index_count; ++i) {
+			uint32_t index;
+			std::memcpy(&index, ib.data.data() + (first_index + i) * sizeof(uint32_t), sizeof(index));
+			REQUIRE((index + 1) * sizeof(sprite_vertex) <= vb.data.size());
+			sprite_vertex v;
+			std::memcpy(&v, vb.data.data() + index * sizeof(sprite_vertex), sizeof(v));
+			call.vertices.push_back(v);
+		}
+		draws.push_back(std::move(call));
+	}
+
+	bool persistent;
+	size_t maps = 0;
+	size_t orphans = 0;
+	size_t destroyed = 0;
+	uint32_t fences = 0;
+	std::vector<fence_type> pending;
+	std::vector<fence_type> waited;
+	std::vector<draw_call> draws;
+
+private:
+	struct buffer {
+		buffer_target target;
+		std::vector<uint8_t> data;
+		bool mapped;
+	};
+
+	buffer& get(buffer_type handle) {
+		REQUIRE(handle > 0);
+		REQUIRE(handle <= buffers.size());
+		return buffers[handle - 1];
+	}
+
+	std::vector<buffer> buffers;
+};
+
+using sprite_batch = basic_sprite_batch<mock_device>;
+
+const sprite_texture texture1{ 1, 64, 32 };
+const sprite_texture texture2{ 2, 16, 16 };
+
+} // namespace
+
+TEST_CASE("sprite batch", "[sprite_batch]") {
+	auto persistent = GENERATE(false, true);
+	mock_device device(persistent);
+
+	SECTION("vertices") {
+		{
+			sprite_batch batch(device, 16);
+			batch.begin();
+			batch.draw(texture1, blend_mode::modulate, { 16, 8, 32, 16 }, { 10, 20, 100, 50 }, 0xff00ff00, 0.5f);
+			REQUIRE(batch.size() == 1);
+			batch.end();
+			REQUIRE(batch.size() == 0);
+		}
+		REQUIRE(device.destroyed == (persistent ? 2 : 6));
+		REQUIRE(device.pending.empty());
+
+		REQUIRE(device.draws.size() == 1);
+		auto&& call = device.draws[0];
+		REQUIRE(call.texture == 1);
+		REQUIRE(call.blend == blend_mode::modulate);
+		REQUIRE(call.vertices.size() == 6);
+
+		auto&& v = call.vertices;
+		REQUIRE(v[0].x == 10);
+		REQUIRE(v[0].y == 20);
+		REQUIRE(v[0].z == 0.5f);
+		REQUIRE(v[0].color == 0xff00ff00);
+		REQUIRE(v[0].u == 0.25f);
+		REQUIRE(v[0].v == 0.25f);
+		REQUIRE(v[2].x == 110);
+		REQUIRE(v[2].y == 70);
+		REQUIRE(v[2].u == 0.75f);
+		REQUIRE(v[2].v == 0.75f);
+		REQUIRE(v[3].x == v[0].x);
+		REQUIRE(v[5].x == 110);
+		REQUIRE(v[5].y == 20);
+	}
+
+	SECTION("batches") {
+		sprite_batch batch(device, 16);
+		batch.begin();
+		batch.draw(texture1, blend_mode::none, {}, { 0, 0, 1, 1 });
+		batch.draw(texture1, blend_mode::none, {}, { 1, 0, 1, 1 });
+		batch.draw(texture2, blend_mode::none, {}, { 2, 0, 1, 1 });
+		batch.draw(texture1, blend_mode::add, {}, { 3, 0, 1, 1 });
+		batch.draw_rect(blend_mode::add, { 4, 0, 1, 1 });
+		batch.end();
+
+		REQUIRE(device.draws.size() == 4);
+		REQUIRE(device.draws[0].vertices.size() == 12);
+		REQUIRE(device.draws[0].vertices[6].x == 1);
+		REQUIRE(device.draws[1].texture == 2);
+		REQUIRE(device.draws[2].blend == blend_mode::add);
+		REQUIRE(device.draws[3].texture == 0);
+		REQUIRE(device.draws[3].vertices[0].u == 0);
+	}
+
+	SECTION("sorting") {
+		sprite_batch batch(device, 16);
+		batch.begin(sprite_sort::texture);
+		batch.draw(texture2, blend_mode::none, {}, { 0, 0, 1, 1 });
+		batch.draw(texture1, blend_mode::none, {}, { 1, 0, 1, 1 });
+		batch.draw(texture2, blend_mode::none, {}, { 2, 0, 1, 1 });
+		batch.draw(texture1, blend_mode::none, {}, { 3, 0, 1, 1 });
+		batch.end();
+
+		// Sorting is stable
+		REQUIRE(device.draws.size() == 2);
+		REQUIRE(device.draws[0].texture == 1);
+		REQUIRE(device.draws[0].vertices[0].x == 1);
+		REQUIRE(device.draws[0].vertices[6].x == 3);
+		REQUIRE(device.draws[1].vertices[0].x == 0);
+		REQUIRE(device.draws[1].vertices[6].x == 2);
+
+		device.draws.clear();
+		batch.begin(sprite_sort::front_to_back);
+		batch.draw(texture1, blend_mode::none, {}, { 0, 0, 1, 1 }, 0xffffffff, 0.1f);
+		batch.draw(texture1, blend_mode::none, {}, { 1, 0, 1, 1 }, 0xffffffff, 0.9f);
+		batch.draw(texture1, blend_mode::none, {}, { 2, 0, 1, 1 }, 0xffffffff, 0.5f);
+		batch.end();
+
+		REQUIRE(device.draws.size() == 1);
+		REQUIRE(device.draws[0].vertices[0].z == 0.9f);
+		REQUIRE(device.draws[0].vertices[6].z == 0.5f);
+		REQUIRE(device.draws[0].vertices[12].z == 0.1f);
+	}
+
+	SECTION("ring") {
+		sprite_batch batch(device, 4, 3);
+		batch.begin();
+		for (int i = 0; i < 10; ++i)
+			batch.draw(texture1, blend_mode::none, {}, { float(i), 0, 1, 1 });
+		batch.end();
+
+		// Full segments are flushed, the batch continues in the next ones
+		REQUIRE(device.draws.size() == 3);
+		REQUIRE(device.draws[0].vertices.size() == 24);
+		REQUIRE(device.draws[2].vertices.size() == 12);
+		REQUIRE(device.draws[1].vertices[0].x == 4);
+		REQUIRE(device.draws[2].vertices[6].x == 9);
+
+		if (persistent) {
+			// Vertices and indices are mapped only once
+			REQUIRE(device.maps == 2);
+			REQUIRE(device.waited.empty());
+
+			// Segments of frames in flight aren't reused, rings grow by a segment per frame
+			for (int frame = 2; frame <= 3; ++frame) {
+				batch.begin();
+				batch.draw(texture1, blend_mode::none, {}, { 0, 0, 1, 1 });
+				batch.end();
+			}
+			REQUIRE(device.waited.empty());
+			REQUIRE(device.maps == 6);
+
+			// The fourth frame reuses segments of the first one, its fences are waited for
+			batch.begin();
+			batch.draw(texture1, blend_mode::none, {}, { 0, 0, 1, 1 });
+			batch.end();
+			REQUIRE(device.waited.size() == 2);
+			REQUIRE(device.maps == 6);
+			REQUIRE(device.draws.size() == 6);
+		} else {
+			// Every segment is written into new storage
+			REQUIRE(device.orphans == 6);
+			REQUIRE(device.maps == 6);
+			REQUIRE(device.fences == 0);
+		}
+	}
+
+	SECTION("flushes per frame") {
+		// More flushes per frame than segments, like 50000 sprites in batch of 16384
+		sprite_batch batch(device, 4, 3);
+		for (uint32_t frame = 1; frame <= 6; ++frame) {
+			batch.begin();
+			for (int i = 0; i < 20; ++i)
+				batch.draw(texture1, blend_mode::none, {}, { float(i), 0, 1, 1 });
+			batch.end();
+			REQUIRE(device.draws.size() == frame * 5);
+
+			if (frame <= 3) {
+				// Nothing is waited for while frames are in flight
+				REQUIRE(device.waited.empty());
+			} else if (persistent) {
+				// Only fences of vertices and indices of the frame 3 behind are waited for
+				REQUIRE(device.waited.size() == (frame - 3) * 2);
+				REQUIRE(device.waited.back() == (frame - 3) * 2);
+			}
+		}
+
+		if (persistent) {
+			// Rings hold 5 segments of 3 frames
+			REQUIRE(device.maps == 2 + 2 * 12);
+		}
+	}
+
+	SECTION("empty") {
+		sprite_batch batch(device, 4);
+		batch.begin();
+		batch.end();
+		batch.begin();
+		batch.end();
+		REQUIRE(device.draws.empty());
+	}
+}
+
+TEST_CASE("sprite batch sort keys", "[sprite_batch]") {
+	mock_device device(true);
+	sprite_batch batch(device, 1024);
+	
+	SECTION("depth") {
+		const float depths[] = { 0.5f, -2.0f, 0.0f, 100.0f, -0.25f, 0.5f, 3.0f };
+		batch.begin(sprite_sort::back_to_front);
+		for (size_t i = 0; i < 200; ++i)
+			batch.draw(texture1, blend_mode::none, {}, { float(i), 0, 1, 1 }, 0xffffffff, depths[i % 7]);
+		batch.end();
+		
+		REQUIRE(device.draws.size() == 1);
+		auto&& v = device.draws[0].vertices;
+		REQUIRE(v.size() == 1200);
+		for (size_t i = 6; i < v.size(); i += 6) {
+			REQUIRE(v[i - 6].z <= v[i].z);
+			// Sprites of the same depth are drawn in order of submission
+			if (v[i - 6].z == v[i].z)
+				REQUIRE(v[i - 6].x < v[i].x);
+		}
+	}
+	
+	SECTION("blend") {
+		batch.begin(sprite_sort::blend);
+		for (size_t i = 0; i < 300; ++i)
+			batch.draw(i % 2 ? texture1 : texture2, i % 3 ? blend_mode::add : blend_mode::modulate, {}, { float(i), 0, 1, 1 });
+		batch.end();
+		
+		// Grouped by blend mode, then by texture
+		REQUIRE(device.draws.size() == 4);
+		REQUIRE(device.draws[0].blend == blend_mode::modulate);
+		REQUIRE(device.draws[0].texture == 1);
+		REQUIRE(device.draws[1].texture == 2);
+		REQUIRE(device.draws[2].blend == blend_mode::add);
+		REQUIRE(device.draws[3].texture == 2);
+		REQUIRE(device.draws[3].vertices.size() == 100 * 6);
+	}
+}
+
+TEST_CASE("sprite batch draw_many", "[sprite_batch]") {
+	auto persistent = GENERATE(false, true);
+	mock_device device(persistent);
+
+	SECTION("same as draw") {
+		std::vector<sprite_desc> sprites;
+		for (int i = 0; i < 10; ++i) {
+			sprite_desc s;
+			s.texture = i % 3 ? texture1 : texture2;
+			s.src = { float(i), 2, 8, 4 };
+			s.dest = { float(i * 10), 5, 20, 30 };
+			s.color = 0xff000000 | i;
+			s.depth = 0.1f * i;
+			s.blend = i % 2 ? blend_mode::add : blend_mode::modulate;
+			sprites.push_back(s);
+		}
+
+		sprite_batch batch(device, 4);
+		batch.begin(sprite_sort::texture);
+		for (auto&& s : sprites)
+			batch.draw(s.texture, s.blend, s.src, s.dest, s.color, s.depth);
+		batch.end();
+		auto expected = std::move(device.draws);
+
+		// Sprites continue in the next segments when current one is full
+		device.draws.clear();
+		batch.begin(sprite_sort::texture);
+		batch.draw(sprites[0].texture, sprites[0].blend, sprites[0].src, sprites[0].dest, sprites[0].color, sprites[0].depth);
+		batch.draw_many(sprites.data() + 1, sprites.size() - 1);
+		REQUIRE(batch.size() == 2);
+		batch.end();
+
+		REQUIRE(device.draws.size() == expected.size());
+		for (size_t i = 0; i < expected.size(); ++i) {
+			REQUIRE(device.draws[i].texture == expected[i].texture);
+			REQUIRE(device.draws[i].blend == expected[i].blend);
+			REQUIRE(device.draws[i].vertices.size() == expected[i].vertices.size());
+			REQUIRE(std::memcmp(device.draws[i].vertices.data(), expected[i].vertices.data(), expected[i].vertices.size() * sizeof(sprite_vertex)) == 0);
+		}
+	}
+
+	SECTION("transform") {
+		sprite_desc s;
+		s.texture = texture1;
+		s.src = { 0, 0, 64, 32 };
+		s.dest = { 100, 50, 40, 20 };
+		s.origin = { 0.5f, 0.5f };
+		s.rotation = 3.14159265f / 2;
+		s.color = 0x12345678;
+		s.depth = -1;
+
+		sprite_batch batch(device, 16);
+		batch.begin();
+		batch.draw_many(&s, 1);
+		batch.draw_many(&s, 0);
+		batch.end();
+
+		// Quarter turn clockwise around center, top left corner goes to top right
+		REQUIRE(device.draws.size() == 1);
+		auto&& v = device.draws[0].vertices;
+		REQUIRE(v.size() == 6);
+		REQUIRE(v[0].x == Approx(110));
+		REQUIRE(v[0].y == Approx(30));
+		REQUIRE(v[1].x == Approx(90));
+		REQUIRE(v[1].y == Approx(30));
+		REQUIRE(v[2].x == Approx(90));
+		REQUIRE(v[2].y == Approx(70));
+		REQUIRE(v[5].x == Approx(110));
+		REQUIRE(v[5].y == Approx(70));
+		for (auto&& vertex : v) {
+			REQUIRE(vertex.z == -1);
+			REQUIRE(vertex.color == 0x12345678);
+		}
+		REQUIRE(v[0].u == 0);
+		REQUIRE(v[0].v == 0);
+		REQUIRE(v[2].u == 1);
+		REQUIRE(v[2].v == 1);
+		REQUIRE(v[5].u == 1);
+		REQUIRE(v[5].v == 0);
+	}
+}
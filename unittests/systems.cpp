@@ -0,0 +1,77 @@
+#include "catch2/catch.hpp"
+#include <cobalt/systems.hpp>
+
+#include <atomic>
+
+using namespace cobalt;
+
+namespace {
+
+struct position {
+	float x = 0;
+};
+
+struct velocity {
+	float x = 1;
+};
+
+struct bounds {
+	float max = 0;
+};
+
+} // namespace
+
+TEST_CASE("level_update", "[systems]") {
+	thread_pool pool(3);
+	level_update update(pool, 64);
+	
+	level level1;
+	std::vector<ref_ptr<actor>> actors;
+	for (int i = 0; i < 1000; ++i) {
+		auto a = make_ref<actor>();
+		level1.add_actor(a.get());
+		a->add_data<position>();
+		a->add_data<velocity>(velocity{ float(i % 10) });
+		if (i % 2)
+			a->add_data<bounds>();
+		actors.push_back(a);
+	}
+	
+	std::atomic<int> late{0};
+	std::atomic<int> integrated{0};
+	
+	// Added out of phase order
+	update.add_actor_system(update_order::post_update, reads<position>{}, writes<bounds>{}, [&](actor& a) {
+		if (integrated != 1000)
+			++late;
+		if (auto b = a.data<bounds>())
+			b->max = std::max(b->max, a.data<position>()->x);
+	});
+	update.add_system<velocity>(update_order::update, reads<velocity>{}, writes<position>{}, [&](actor& a, const velocity& v) {
+		a.data<position>()->x += v.x;
+		++integrated;
+	});
+	// Reads position written by the previous system of the same phase, so runs after it
+	update.add_system<position>(update_order::update, reads<position>{}, writes<>{}, [&](actor& a, const position& p) {
+		if (p.x != a.data<velocity>()->x)
+			++late;
+	});
+	// Independent of the rest
+	update.add_system<velocity>(update_order::pre_update, reads<>{}, writes<>{}, [&](actor&, velocity& v) {
+		v.x *= 2;
+	});
+	REQUIRE(update.size() == 4);
+	
+	update.run(level1);
+	REQUIRE(integrated == 1000);
+	REQUIRE(late == 0);
+	
+	for (int i = 0; i < 1000; ++i) {
+		auto&& a = actors[i];
+		REQUIRE(a->data<position>()->x == float(i % 10) * 2);
+		if (i % 2)
+			REQUIRE(a->data<bounds>()->max == float(i % 10) * 2);
+	}
+	
+	level1.clear_actors();
+}